@@ -0,0 +1,39 @@
+#define STB_SPRINTF_IMPLEMENTATION
+#include "benchmark.h"
+
+#include "../src/os.h"
+
+#include <stdio.h>
+
+// The game defines these in main.cpp.
+Globals globals = {};
+Arena frame_arena;
+double global_time_rate = 1.0;
+
+void count_heap_allocation() {
+}
+
+void init_benchmark() {
+    init_arena(&frame_arena, FRAME_ARENA_SIZE);
+}
+
+f64 run_benchmark(char *name, Benchmark_Proc proc, void *data, s64 items_per_run, int runs) {
+    proc(data);
+
+    f64 best = 0.0;
+    for (int i = 0; i < runs; i++) {
+        f64 start = os_get_time();
+        proc(data);
+        f64 elapsed = os_get_time() - start;
+
+        if (!i || elapsed < best) best = elapsed;
+        reset_arena(&frame_arena);
+    }
+
+    printf("%-44s %10.3f ms %10.2f ns/item\n", name, best * 1000.0, best / Max(items_per_run, (s64)1) * 1000000000.0);
+    return best;
+}
+
+void report_speedup(char *name, f64 before, f64 after) {
+    printf("%-44s %10.2fx\n", name, after > 0.0 ? before / after : 0.0);
+}
@@ -0,0 +1,28 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Shared by the targets under benchmarks/. Each one is a plain executable
+// that prints a line per case; run them from run_tree so they find data/.
+//
+// They link benchmarks/os_std.cpp instead of os_windows.cpp: the standard
+// library versions of the threads, locks, clock and files that the engine
+// modules use, and nothing that needs a window. That lets the same targets
+// build on Linux with g++; each main.cpp has its command line at the top.
+// Targets that need the renderer build with RENDER_NULL and link
+// benchmarks/headless_draw.cpp for the few things draw_null.cpp expects.
+
+#include "../src/general.h"
+
+typedef void (*Benchmark_Proc)(void *data);
+
+// Sets up what general.h expects main() to (frame_arena).
+void init_benchmark();
+
+// Calls proc once to warm up, then 'runs' times, and prints the fastest run
+// with its cost per item. Returns the fastest run in seconds.
+f64 run_benchmark(char *name, Benchmark_Proc proc, void *data, s64 items_per_run, int runs = 10);
+
+// Before/after line for two results of run_benchmark.
+void report_speedup(char *name, f64 before, f64 after);
+
+#endif
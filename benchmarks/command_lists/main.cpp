@@ -0,0 +1,165 @@
+// Times recording draws into command lists, on one thread and split across
+// the job workers, and replaying them, against issuing the same draws
+// straight to the backend as the renderer did before command lists.
+//
+//     command_lists_benchmark [num_draws]
+//
+// Builds with the null renderer, so what's timed is the recording and replay
+// themselves rather than the driver. Builds on Linux too:
+//     g++ -O2 -std=c++14 -mssse3 -pthread -Wno-write-strings -DRENDER_NULL -I../../external/include main.cpp ../benchmark.cpp ../os_std.cpp ../headless_draw.cpp ../../src/draw_commands.cpp ../../src/draw_null.cpp ../../src/jobs.cpp ../../src/pixel_convert.cpp ../../src/memory_tags.cpp -o command_lists_benchmark
+
+#include "../benchmark.h"
+#include "../../src/draw.h"
+#include "../../src/mesh.h"
+#include "../../src/jobs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+const int DEFAULT_NUM_DRAWS = 160 * 1000;
+const int NUM_MESHES = 64;
+const int MAX_RECORDING_LISTS = 64;
+
+// Lists are split into slices of the draws, one job each.
+struct Recording {
+    Mesh *meshes;
+    Vector3 *positions;
+    int num_draws;
+
+    Command_List lists[MAX_RECORDING_LISTS];
+    Command_List *list_pointers[MAX_RECORDING_LISTS];
+    int num_lists;
+};
+
+struct Recording_Slice {
+    Recording *recording;
+    int list_index;
+};
+
+static void record_slice(Recording *recording, Command_List *list, int first_draw, int num_draws) {
+    begin_command_list(list);
+    record_set_shader(list, shader_basic_3d);
+
+    for (int i = first_draw; i < first_draw + num_draws; i++) {
+        Mesh *mesh = &recording->meshes[i % NUM_MESHES];
+        record_set_diffuse_texture(list, mesh->map);
+        record_draw_mesh(list, mesh, recording->positions[i], make_vector3(0, (f32)i, 0), 1.0f);
+    }
+}
+
+static void get_slice_range(Recording *recording, int list_index, int *first_draw, int *num_draws) {
+    int per_list = (recording->num_draws + recording->num_lists - 1) / recording->num_lists;
+    *first_draw = Min(list_index * per_list, recording->num_draws);
+    *num_draws = Min(per_list, recording->num_draws - *first_draw);
+}
+
+static void record_slice_job_proc(void *data, int worker_index) {
+    Recording_Slice *slice = (Recording_Slice *)data;
+
+    int first_draw, num_draws;
+    get_slice_range(slice->recording, slice->list_index, &first_draw, &num_draws);
+    record_slice(slice->recording, &slice->recording->lists[slice->list_index], first_draw, num_draws);
+}
+
+// What draw_game_3d did before command lists.
+static void immediate_draws(void *data) {
+    Recording *recording = (Recording *)data;
+
+    set_shader(shader_basic_3d);
+    for (int i = 0; i < recording->num_draws; i++) {
+        Mesh *mesh = &recording->meshes[i % NUM_MESHES];
+        set_diffuse_texture(mesh->map);
+        draw_mesh(mesh, recording->positions[i], make_vector3(0, (f32)i, 0), 1.0f);
+    }
+}
+
+static void record_one_thread(void *data) {
+    Recording *recording = (Recording *)data;
+    recording->num_lists = 1;
+    record_slice(recording, &recording->lists[0], 0, recording->num_draws);
+}
+
+static void record_on_workers(void *data) {
+    Recording *recording = (Recording *)data;
+    recording->num_lists = Min(get_num_job_workers() + 1, MAX_RECORDING_LISTS);
+
+    Recording_Slice slices[MAX_RECORDING_LISTS];
+    Job_Counter counter;
+    for (int i = 0; i < recording->num_lists; i++) {
+        slices[i].recording = recording;
+        slices[i].list_index = i;
+        add_job(record_slice_job_proc, &slices[i], &counter, JOB_PRIORITY_FRAME);
+    }
+
+    wait_for_counter(&counter);
+}
+
+static void submit(void *data) {
+    Recording *recording = (Recording *)data;
+    submit_command_lists(recording->list_pointers, recording->num_lists);
+}
+
+static void record_on_workers_and_submit(void *data) {
+    record_on_workers(data);
+    submit(data);
+}
+
+static s64 count_commands(Recording *recording) {
+    s64 result = 0;
+    for (int i = 0; i < recording->num_lists; i++) {
+        result += recording->lists[i].commands.count;
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    init_benchmark();
+    init_jobs();
+    init_draw(false, false, 1);
+
+    int num_draws = DEFAULT_NUM_DRAWS;
+    if (argc > 1) num_draws = Max(atoi(argv[1]), 1);
+
+    Texture_Map *maps = new Texture_Map[NUM_MESHES / 4];
+    Mesh *meshes = new Mesh[NUM_MESHES];
+    for (int i = 0; i < NUM_MESHES; i++) {
+        meshes[i] = {};
+        meshes[i].vertex_count = 36 + i * 12;
+        meshes[i].map = &maps[i / 4];
+    }
+
+    Recording *recording = new Recording();
+    recording->meshes = meshes;
+    recording->num_draws = num_draws;
+    recording->positions = new Vector3[num_draws];
+    for (int i = 0; i < MAX_RECORDING_LISTS; i++) {
+        recording->list_pointers[i] = &recording->lists[i];
+    }
+
+    srand(1);
+    for (int i = 0; i < num_draws; i++) {
+        recording->positions[i] = make_vector3((f32)(rand() % 1000), 0, (f32)(rand() % 1000));
+    }
+
+    printf("%d draws of %d meshes, %d job workers\n\n", num_draws, NUM_MESHES, get_num_job_workers());
+
+    f64 immediate_time = run_benchmark("immediate draws", immediate_draws, recording, num_draws);
+
+    f64 one_list_time = run_benchmark("record, one list", record_one_thread, recording, num_draws);
+    s64 one_list_commands = count_commands(recording);
+    run_benchmark("submit, one list", submit, recording, num_draws);
+
+    f64 workers_time = run_benchmark("record, list per worker", record_on_workers, recording, num_draws);
+    if (count_commands(recording) != one_list_commands + recording->num_lists - 1) {
+        printf("Recording on the workers gave %lld commands, one list gave %lld!\n", (long long)count_commands(recording), (long long)one_list_commands);
+    }
+
+    run_benchmark("submit, list per worker", submit, recording, num_draws);
+    f64 total_time = run_benchmark("record on workers + submit", record_on_workers_and_submit, recording, num_draws);
+
+    printf("\n");
+    report_speedup("recording, list per worker vs one list", one_list_time, workers_time);
+    report_speedup("record + submit vs immediate", immediate_time, total_time);
+
+    return 0;
+}
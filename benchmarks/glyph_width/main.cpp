@@ -0,0 +1,159 @@
+// Times get_string_width_in_pixels against the FreeType lookups it used to do
+// for every pair of characters, on long strings.
+//
+//     glyph_width_benchmark [font path] [size]
+//
+// The old path is copied here as it was: advances come from the glyph cache
+// either way, the difference is the glyph index and kerning lookups. Widths
+// are printed to check both paths agree. The font needs a kerning table for
+// the comparison to mean anything; the default one has one. Builds on Linux
+// too, with the null renderer standing in for D3D11:
+//     g++ -O2 -std=c++14 -mssse3 -pthread -Wno-write-strings -DRENDER_NULL -I../../external/include main.cpp ../benchmark.cpp ../os_std.cpp ../headless_draw.cpp ../../src/font.cpp ../../src/draw_null.cpp ../../src/jobs.cpp ../../src/pixel_convert.cpp ../../src/memory_tags.cpp ../../src/atom.cpp ../../src/assets.cpp ../../src/text_file_handler.cpp -lfreetype -o glyph_width_benchmark
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "../benchmark.h"
+#include "../../src/font.h"
+#include "../../src/jobs.h"
+#include "../../src/os.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const int TEXT_REPEATS = 2000;
+const int MEASURES_PER_RUN = 10;
+
+// Pairs with kerning in most Latin fonts: AV, To, Wa, LT, "y.
+static char *ascii_text = "AVAST! To Wally: \"Yes, we've LT-typed 47 reports by Tuesday.\" ";
+static char *latin1_text = "Très élégant: façade, naïve, Ærø, Übergröße, señor Ñúñez à la crème. ";
+// Latin Extended-A, which goes through the glyph index hash instead of the direct table.
+static char *latin_extended_text = "Łódź, Kraków, Dubrovnik, Œuvre, İstanbul, Ŝablono, Ħamrun. ";
+
+struct Measure {
+    Font *font;
+    char *text;
+    s64 width;
+};
+
+//
+// The measuring loop from before the glyph index and kerning caches
+//
+
+static int old_get_kerning_in_pixels(Font *font, int codepoint, int next_codepoint) {
+    unsigned long glyph_index = FT_Get_Char_Index(font->face, codepoint);
+    unsigned long next_glyph_index = FT_Get_Char_Index(font->face, next_codepoint);
+
+    FT_Vector kern;
+    FT_Get_Kerning(font->face, glyph_index, next_glyph_index, FT_KERNING_DEFAULT, &kern);
+
+    return kern.x >> 6;
+}
+
+static int old_get_string_width_in_pixels(Font *font, char *text) {
+    if (!text) return 0;
+    
+    int width = 0;
+    for (char *at = text; *at;) {
+        int codepoint_byte_count = 0;
+        int codepoint = get_codepoint(at, &codepoint_byte_count);
+        Glyph *glyph = get_or_load_glyph(font, codepoint);
+        
+        width += glyph->advance;
+        
+        if (font->has_kerning) {
+            int next_codepoint_byte_count = 0;
+            int next_codepoint = get_codepoint(at + codepoint_byte_count, &next_codepoint_byte_count);
+            width += old_get_kerning_in_pixels(font, codepoint, next_codepoint);
+        }
+        
+        at += codepoint_byte_count;
+    }
+    
+    return width;
+}
+
+static void old_measure(void *data) {
+    Measure *measure = (Measure *)data;
+    measure->width = 0;
+    for (int i = 0; i < MEASURES_PER_RUN; i++) {
+        measure->width += old_get_string_width_in_pixels(measure->font, measure->text);
+    }
+}
+
+static void new_measure(void *data) {
+    Measure *measure = (Measure *)data;
+    measure->width = 0;
+    for (int i = 0; i < MEASURES_PER_RUN; i++) {
+        measure->width += get_string_width_in_pixels(measure->font, measure->text);
+    }
+}
+
+static char *repeat_text(char *text, int repeats) {
+    int length = get_string_length(text);
+    char *result = new char[length * repeats + 1];
+    for (int i = 0; i < repeats; i++) {
+        memcpy(result + i * length, text, length);
+    }
+    result[length * repeats] = 0;
+    return result;
+}
+
+static s64 count_codepoints(char *text) {
+    s64 count = 0;
+    for (char *at = text; *at;) {
+        int byte_count = 0;
+        get_codepoint(at, &byte_count);
+        at += byte_count;
+        count++;
+    }
+    return count;
+}
+
+static void run_case(char *name, Font *font, char *text) {
+    Measure measure = {};
+    measure.font = font;
+    measure.text = repeat_text(text, TEXT_REPEATS);
+    defer { delete [] measure.text; };
+
+    s64 num_codepoints = count_codepoints(measure.text) * MEASURES_PER_RUN;
+
+    char *old_name = tprint("%s, old", name);
+    f64 old_time = run_benchmark(old_name, old_measure, &measure, num_codepoints);
+    s64 old_width = measure.width;
+
+    char *new_name = tprint("%s, cached", name);
+    f64 new_time = run_benchmark(new_name, new_measure, &measure, num_codepoints);
+    if (measure.width != old_width) {
+        printf("%s: width %lld differs from the old path's %lld!\n", name, (long long)measure.width, (long long)old_width);
+    }
+
+    report_speedup(name, old_time, new_time);
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    init_benchmark();
+    init_jobs();
+
+    char *font_path = "data/fonts/KarminaRegular.otf";
+    if (argc > 1) font_path = argv[1];
+    int size = (argc > 2) ? atoi(argv[2]) : 24;
+
+    if (!os_file_exists(font_path)) {
+        fprintf(stderr, "Can't find font '%s'; run from run_tree or pass a font path.\n", font_path);
+        return 1;
+    }
+
+    Font *font = load_font(font_path, size);
+    if (!font->has_kerning) printf("'%s' has no kerning table, both paths skip kerning.\n", font_path);
+
+    printf("%s at %d, %d repeats of each text, measured %d times a run\n\n", font_path, size, TEXT_REPEATS, MEASURES_PER_RUN);
+
+    run_case("ASCII", font, ascii_text);
+    run_case("Latin-1", font, latin1_text);
+    run_case("Latin Extended-A", font, latin_extended_text);
+
+    return 0;
+}
@@ -0,0 +1,433 @@
+// Times Hash_Table against the table it replaced and std::unordered_map, on
+// int keys and on string keys.
+//
+//     hash_table_benchmark [num_keys]
+//
+// The old table is copied here as it was. It only grows once completely full,
+// so probes run longest right before each grow, and it has no remove. Hit
+// counts are printed to check the tables agree. Builds on Linux too:
+//     g++ -O2 -std=c++14 -pthread -Wno-write-strings -I../../external/include main.cpp ../benchmark.cpp ../os_std.cpp ../../src/memory_tags.cpp -o hash_table_benchmark
+
+#include "../benchmark.h"
+#include "../../src/hash_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+
+//
+// The old table, from before the rewrite
+//
+
+static int old_hash(int x) {
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = (x >> 16) ^ x;
+    return x;
+}
+
+static int old_hash(char *str) {
+    int hash = 5381;
+
+    int len = get_string_length(str);
+    for (int i = 0; i < len; i++) {
+        hash = ((hash << 5) + hash) + str[i];
+    }
+    return hash;
+}
+
+template <typename Key, typename Value>
+struct Old_Hash_Table {
+    struct Bucket {
+        Key key;
+        Value value;
+    };
+
+    Bucket *buckets = nullptr;
+    bool *occupancy_mask = nullptr;
+    int allocated = 0;
+    int count = 0;
+
+    inline void grow() {
+        const int HASH_TABLE_INITIAL_CAPACITY = 256;
+
+        if (!buckets) {
+            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
+            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
+            allocated = HASH_TABLE_INITIAL_CAPACITY;
+            count = 0;
+        } else {
+            Old_Hash_Table <Key, Value> new_hash_table = {
+                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
+                (bool *)calloc(allocated * 2, sizeof(bool)),
+                allocated * 2,
+                0,
+            };
+
+            for (int i = 0; i < count; i++) {
+                if (occupancy_mask[i]) {
+                    new_hash_table.add(buckets[i].key, buckets[i].value);
+                }
+            }
+
+            free(buckets);
+            free(occupancy_mask);
+
+            *this = new_hash_table;
+        }
+    }
+
+    inline void add(Key key, Value value) {
+        if (count >= allocated) {
+            grow();
+        }
+
+        auto hk = old_hash(key) & (allocated - 1);
+        while (occupancy_mask[hk] && buckets[hk].key != key) {
+            hk = (hk + 1) & (allocated - 1);
+        }
+
+        occupancy_mask[hk] = true;
+        buckets[hk].key = key;
+        buckets[hk].value = value;
+        count++;
+    }
+
+    inline Value *get(Key key) {
+        auto hk = old_hash(key) & (allocated - 1);
+        for (int i = 0; i < allocated && occupancy_mask[hk] && buckets[hk].key != key; i++) {
+            hk = (hk + 1) & (allocated - 1);
+        }
+
+        if (buckets && occupancy_mask[hk] && buckets[hk].key == key) {
+            return &buckets[hk].value;
+        } else {
+            return nullptr;
+        }
+    }
+
+    inline void deinit() {
+        free(buckets);
+        free(occupancy_mask);
+        *this = {};
+    }
+};
+
+template <typename Value>
+struct Old_String_Hash_Table {
+    struct Bucket {
+        char *key;
+        Value value;
+    };
+
+    Bucket *buckets = nullptr;
+    bool *occupancy_mask = nullptr;
+    int allocated = 0;
+    int count = 0;
+
+    inline void grow() {
+        const int HASH_TABLE_INITIAL_CAPACITY = 256;
+
+        if (!buckets) {
+            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
+            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
+            allocated = HASH_TABLE_INITIAL_CAPACITY;
+            count = 0;
+        } else {
+            Old_String_Hash_Table <Value> new_hash_table = {
+                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
+                (bool *)calloc(allocated * 2, sizeof(bool)),
+                allocated * 2,
+                0,
+            };
+
+            for (int i = 0; i < count; i++) {
+                if (occupancy_mask[i]) {
+                    new_hash_table.add(buckets[i].key, buckets[i].value);
+                }
+            }
+
+            free(buckets);
+            free(occupancy_mask);
+
+            *this = new_hash_table;
+        }
+    }
+
+    inline void add(char *key, Value value) {
+        if (count >= allocated) {
+            grow();
+        }
+
+        auto hk = old_hash(key) & (allocated - 1);
+        while (occupancy_mask[hk] && !strings_match(buckets[hk].key, key)) {
+            hk = (hk + 1) & (allocated - 1);
+        }
+
+        occupancy_mask[hk] = true;
+        buckets[hk].key = copy_string(key);
+        buckets[hk].value = value;
+        count++;
+    }
+
+    inline Value *get(char *key) {
+        auto hk = old_hash(key) & (allocated - 1);
+        for (int i = 0; i < allocated && occupancy_mask[hk] && !strings_match(buckets[hk].key, key); i++) {
+            hk = (hk + 1) & (allocated - 1);
+        }
+
+        if (buckets && occupancy_mask[hk] && strings_match(buckets[hk].key, key)) {
+            return &buckets[hk].value;
+        } else {
+            return nullptr;
+        }
+    }
+
+    // The old table never freed anything; this is only so the benchmark
+    // doesn't pile up copies between runs.
+    inline void deinit() {
+        for (int i = 0; i < allocated; i++) {
+            if (occupancy_mask[i]) delete [] buckets[i].key;
+        }
+        free(buckets);
+        free(occupancy_mask);
+        *this = {};
+    }
+};
+
+//
+// Cases
+//
+
+struct Keys {
+    int count;
+
+    // The second half of each array is never inserted, for the misses.
+    int *ints;
+    char **strings;
+    std::string *std_strings;
+
+    int num_found; // Set by the lookup cases, to check them against each other.
+};
+
+static Old_Hash_Table <int, int> old_int_table;
+static Hash_Table <int, int> new_int_table;
+static std::unordered_map <int, int> std_int_table;
+
+static Old_String_Hash_Table <int> old_string_table;
+static Hash_Table <char *, int> new_string_table; // Keys live in Keys::strings.
+static std::unordered_map <std::string, int> std_string_table;
+
+// Int keys
+
+static void old_int_insert(void *data) {
+    Keys *keys = (Keys *)data;
+    old_int_table.deinit();
+    for (int i = 0; i < keys->count; i++) old_int_table.add(keys->ints[i], i);
+}
+
+static void new_int_insert(void *data) {
+    Keys *keys = (Keys *)data;
+    new_int_table.deinit();
+    for (int i = 0; i < keys->count; i++) new_int_table.add(keys->ints[i], i);
+}
+
+static void new_int_insert_reserved(void *data) {
+    Keys *keys = (Keys *)data;
+    new_int_table.deinit();
+    new_int_table.reserve(keys->count);
+    for (int i = 0; i < keys->count; i++) new_int_table.add(keys->ints[i], i);
+}
+
+static void std_int_insert(void *data) {
+    Keys *keys = (Keys *)data;
+    std_int_table = std::unordered_map <int, int>();
+    for (int i = 0; i < keys->count; i++) std_int_table[keys->ints[i]] = i;
+}
+
+static void old_int_lookup_hits(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += old_int_table.get(keys->ints[i]) != nullptr;
+}
+
+static void new_int_lookup_hits(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += new_int_table.get(keys->ints[i]) != nullptr;
+}
+
+static void std_int_lookup_hits(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += std_int_table.find(keys->ints[i]) != std_int_table.end();
+}
+
+static void old_int_lookup_misses(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += old_int_table.get(keys->ints[keys->count + i]) != nullptr;
+}
+
+static void new_int_lookup_misses(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += new_int_table.get(keys->ints[keys->count + i]) != nullptr;
+}
+
+static void std_int_lookup_misses(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += std_int_table.find(keys->ints[keys->count + i]) != std_int_table.end();
+}
+
+// Removes every other key, then puts them back, so each run leaves the table
+// as it found it. The old table has no remove.
+static void new_int_remove_and_reinsert(void *data) {
+    Keys *keys = (Keys *)data;
+    for (int i = 0; i < keys->count; i += 2) new_int_table.remove(keys->ints[i]);
+    for (int i = 0; i < keys->count; i += 2) new_int_table.add(keys->ints[i], i);
+}
+
+static void std_int_remove_and_reinsert(void *data) {
+    Keys *keys = (Keys *)data;
+    for (int i = 0; i < keys->count; i += 2) std_int_table.erase(keys->ints[i]);
+    for (int i = 0; i < keys->count; i += 2) std_int_table[keys->ints[i]] = i;
+}
+
+// String keys
+
+static void old_string_insert(void *data) {
+    Keys *keys = (Keys *)data;
+    old_string_table.deinit();
+    for (int i = 0; i < keys->count; i++) old_string_table.add(keys->strings[i], i);
+}
+
+static void new_string_insert(void *data) {
+    Keys *keys = (Keys *)data;
+    new_string_table.deinit();
+    for (int i = 0; i < keys->count; i++) new_string_table.add(keys->strings[i], i);
+}
+
+static void std_string_insert(void *data) {
+    Keys *keys = (Keys *)data;
+    std_string_table = std::unordered_map <std::string, int>();
+    for (int i = 0; i < keys->count; i++) std_string_table[keys->std_strings[i]] = i;
+}
+
+static void old_string_lookup_hits(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += old_string_table.get(keys->strings[i]) != nullptr;
+}
+
+static void new_string_lookup_hits(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += new_string_table.get(keys->strings[i]) != nullptr;
+}
+
+static void std_string_lookup_hits(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += std_string_table.find(keys->std_strings[i]) != std_string_table.end();
+}
+
+static void old_string_lookup_misses(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += old_string_table.get(keys->strings[keys->count + i]) != nullptr;
+}
+
+static void new_string_lookup_misses(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += new_string_table.get(keys->strings[keys->count + i]) != nullptr;
+}
+
+static void std_string_lookup_misses(void *data) {
+    Keys *keys = (Keys *)data;
+    keys->num_found = 0;
+    for (int i = 0; i < keys->count; i++) keys->num_found += std_string_table.find(keys->std_strings[keys->count + i]) != std_string_table.end();
+}
+
+static void new_string_remove_and_reinsert(void *data) {
+    Keys *keys = (Keys *)data;
+    for (int i = 0; i < keys->count; i += 2) new_string_table.remove(keys->strings[i]);
+    for (int i = 0; i < keys->count; i += 2) new_string_table.add(keys->strings[i], i);
+}
+
+static void std_string_remove_and_reinsert(void *data) {
+    Keys *keys = (Keys *)data;
+    for (int i = 0; i < keys->count; i += 2) std_string_table.erase(keys->std_strings[i]);
+    for (int i = 0; i < keys->count; i += 2) std_string_table[keys->std_strings[i]] = i;
+}
+
+static void run_case(char *name, Benchmark_Proc proc, Keys *keys, bool report_found = false) {
+    run_benchmark(name, proc, keys, keys->count);
+    if (report_found) printf("%-44s %10d of %d found\n", "", keys->num_found, keys->count);
+}
+
+int main(int argc, char **argv) {
+    init_benchmark();
+
+    Keys keys = {};
+    keys.count = (argc > 1) ? atoi(argv[1]) : 50000;
+    if (keys.count <= 0) keys.count = 50000;
+
+    // Unique ints in a random order: a shuffled range, spread out by a large
+    // odd multiplier so they aren't consecutive.
+    int num_keys = keys.count * 2;
+    keys.ints = new int[num_keys];
+    for (int i = 0; i < num_keys; i++) keys.ints[i] = (int)((u32)i * 2654435761u);
+
+    srand(1);
+    for (int i = num_keys - 1; i > 0; i--) {
+        int j = (int)(((u32)rand() * (u32)(RAND_MAX + 1u) + (u32)rand()) % (u32)(i + 1));
+        int swap = keys.ints[i];
+        keys.ints[i] = keys.ints[j];
+        keys.ints[j] = swap;
+    }
+
+    // Names like the ones the catalog and asset registry hash.
+    keys.strings = new char *[num_keys];
+    keys.std_strings = new std::string[num_keys];
+    for (int i = 0; i < num_keys; i++) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "data/textures/terrain_%08x.png", (u32)keys.ints[i]);
+        keys.strings[i] = copy_string(buffer);
+        keys.std_strings[i] = buffer;
+    }
+
+    printf("%d keys, as many missing keys for the misses\n\n", keys.count);
+
+    printf("int keys\n");
+    run_case("  insert, old table", old_int_insert, &keys);
+    run_case("  insert, Hash_Table", new_int_insert, &keys);
+    run_case("  insert, Hash_Table after reserve", new_int_insert_reserved, &keys);
+    run_case("  insert, std::unordered_map", std_int_insert, &keys);
+    run_case("  lookup hits, old table", old_int_lookup_hits, &keys, true);
+    run_case("  lookup hits, Hash_Table", new_int_lookup_hits, &keys, true);
+    run_case("  lookup hits, std::unordered_map", std_int_lookup_hits, &keys, true);
+    run_case("  lookup misses, old table", old_int_lookup_misses, &keys);
+    run_case("  lookup misses, Hash_Table", new_int_lookup_misses, &keys);
+    run_case("  lookup misses, std::unordered_map", std_int_lookup_misses, &keys);
+    run_case("  remove + reinsert half, Hash_Table", new_int_remove_and_reinsert, &keys);
+    run_case("  remove + reinsert half, std::unordered_map", std_int_remove_and_reinsert, &keys);
+
+    printf("\nstring keys\n");
+    run_case("  insert, old table", old_string_insert, &keys);
+    run_case("  insert, Hash_Table", new_string_insert, &keys);
+    run_case("  insert, std::unordered_map", std_string_insert, &keys);
+    run_case("  lookup hits, old table", old_string_lookup_hits, &keys, true);
+    run_case("  lookup hits, Hash_Table", new_string_lookup_hits, &keys, true);
+    run_case("  lookup hits, std::unordered_map", std_string_lookup_hits, &keys, true);
+    run_case("  lookup misses, old table", old_string_lookup_misses, &keys);
+    run_case("  lookup misses, Hash_Table", new_string_lookup_misses, &keys);
+    run_case("  lookup misses, std::unordered_map", std_string_lookup_misses, &keys);
+    run_case("  remove + reinsert half, Hash_Table", new_string_remove_and_reinsert, &keys);
+    run_case("  remove + reinsert half, std::unordered_map", std_string_remove_and_reinsert, &keys);
+
+    return 0;
+}
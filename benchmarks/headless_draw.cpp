@@ -0,0 +1,28 @@
+// What draw.cpp and display_windows.cpp would give the null backend, for
+// benchmarks that link draw_null.cpp without the rest of the renderer or a
+// window. Build these with RENDER_NULL.
+
+#include "../src/draw.h"
+#include "../src/display.h"
+
+const int HEADLESS_DISPLAY_WIDTH = 1280;
+const int HEADLESS_DISPLAY_HEIGHT = 720;
+
+Shader *shader_color;
+Shader *shader_texture;
+Shader *shader_basic_3d;
+Shader *shader_msaa_2x;
+Shader *shader_msaa_4x;
+Shader *shader_msaa_8x;
+Shader *shader_text;
+Shader *shader_terrain;
+Shader *shader_terrain_one_layer;
+Shader *shader_terrain_two_layers;
+
+int display_get_width() {
+    return HEADLESS_DISPLAY_WIDTH;
+}
+
+int display_get_height() {
+    return HEADLESS_DISPLAY_HEIGHT;
+}
@@ -0,0 +1,96 @@
+// Times build_light_clusters binning random point lights into the cluster
+// grid, from 1k lights up to 10k.
+//
+//     light_clusters_benchmark
+//
+// The lights are scattered over the ground in front of a camera set up like
+// the game's. They're smaller than the lamps in game_init, a few tens of
+// units across, since thousands of those would overflow the light index
+// list. The cluster boxes are built on the warm-up call, so the timed runs
+// are binning only. Builds on Linux too:
+//     g++ -O2 -std=c++14 -mssse3 -pthread -Wno-write-strings -DRENDER_NULL -I../../external/include main.cpp ../benchmark.cpp ../os_std.cpp ../../src/lighting.cpp -o light_clusters_benchmark
+
+#include "../benchmark.h"
+#include "../../src/lighting.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+const int RENDER_TARGET_WIDTH = 1280;
+const int RENDER_TARGET_HEIGHT = 720;
+
+// Clamped to MAX_CLUSTERED_LIGHTS by build_light_clusters; counts past it
+// time the dropping too.
+const int LIGHT_COUNTS[] = { 1000, 2000, 4000, 10000 };
+
+struct Binning {
+    Light_Clusters *clusters;
+    Point_Light *lights;
+    int num_lights;
+    Matrix4 world_to_view;
+    Matrix4 view_to_proj;
+};
+
+static f32 random_range(f32 low, f32 high) {
+    return low + (high - low) * (rand() / (f32)RAND_MAX);
+}
+
+static void bin_lights(void *data) {
+    Binning *binning = (Binning *)data;
+    build_light_clusters(binning->clusters, binning->lights, binning->num_lights, binning->world_to_view, binning->view_to_proj, RENDER_TARGET_WIDTH, RENDER_TARGET_HEIGHT);
+}
+
+int main() {
+    init_benchmark();
+
+    int max_lights = 0;
+    for (int i = 0; i < (int)ArrayCount(LIGHT_COUNTS); i++) max_lights = Max(max_lights, LIGHT_COUNTS[i]);
+
+    // Scattered over the ground in front of the camera and a little past the
+    // edges of the view, in the colors of the lamps in game_init.
+    Vector3 colors[] = {
+        make_vector3(3.0f, 0.8f, 0.4f),
+        make_vector3(0.4f, 1.0f, 3.0f),
+        make_vector3(0.6f, 3.0f, 0.8f),
+        make_vector3(3.0f, 2.4f, 1.2f),
+    };
+
+    srand(1);
+    Point_Light *lights = new Point_Light[max_lights];
+    for (int i = 0; i < max_lights; i++) {
+        Point_Light *light = &lights[i];
+        *light = {};
+        light->position = make_vector3(random_range(-600.0f, 600.0f), random_range(2.0f, 12.0f), random_range(-1000.0f, 50.0f));
+        light->color = colors[i % ArrayCount(colors)];
+        light->attenuation = make_vector3(1.0f, 0.1f, random_range(0.5f, 2.0f));
+        light->radius = get_point_light_radius(light->color, light->attenuation);
+    }
+
+    Binning binning = {};
+    binning.clusters = new Light_Clusters();
+    binning.lights = lights;
+
+    f32 aspect_ratio = (f32)RENDER_TARGET_WIDTH / (f32)RENDER_TARGET_HEIGHT;
+    binning.view_to_proj = make_perspective_projection(aspect_ratio, 70.0f * (PI / 180.0f), 0.1f, 1000.0f);
+    binning.world_to_view = make_look_at_matrix(make_vector3(0, 10, 0), make_vector3(0, 5, -100), make_vector3(0, 1, 0));
+
+    printf("%dx%dx%d clusters, %dx%d render target\n\n", LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y, LIGHT_CLUSTERS_Z, RENDER_TARGET_WIDTH, RENDER_TARGET_HEIGHT);
+
+    for (int i = 0; i < (int)ArrayCount(LIGHT_COUNTS); i++) {
+        binning.num_lights = LIGHT_COUNTS[i];
+
+        // Not tprint: run_benchmark resets frame_arena between runs.
+        char name[64];
+        snprintf(name, sizeof(name), "%d lights, per light", binning.num_lights);
+        f64 time = run_benchmark(name, bin_lights, &binning, binning.num_lights);
+
+        snprintf(name, sizeof(name), "%d lights, per cluster", binning.num_lights);
+        printf("%-44s %10.3f ms %10.2f ns/cluster\n", name, time * 1000.0, time / NUM_LIGHT_CLUSTERS * 1000000000.0);
+
+        Light_Clustering_Stats *stats = &binning.clusters->stats;
+        printf("    %d binned, %d dropped, %d indices (%d dropped), at most %d lights in a cluster\n\n",
+               stats->num_lights_binned, stats->num_lights_dropped, stats->num_light_indices, stats->num_indices_dropped, stats->max_lights_in_cluster);
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+// os.h for the benchmarks: threads, locks, the clock and file reads on the
+// C++ standard library, and a directory walk for the asset registry. Anything
+// that needs a window is left out, so a benchmark that links one of those
+// fails to link rather than half working.
+
+#include "../src/os.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+struct Thread {
+    std::thread thread;
+};
+
+struct Mutex {
+    std::mutex mutex;
+};
+
+struct Semaphore {
+    std::mutex mutex;
+    std::condition_variable condition;
+    int count;
+    int max_count;
+};
+
+double os_get_time() {
+    static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration <double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+char *os_read_entire_file(char *filepath, s64 *out_length) {
+    if (out_length) *out_length = 0;
+
+    FILE *file = fopen(filepath, "rb");
+    if (!file) return nullptr;
+    defer { fclose(file); };
+
+    fseek(file, 0, SEEK_END);
+    s64 length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *result = new char[length + 1];
+    if (fread(result, 1, length, file) != (size_t)length) {
+        delete [] result;
+        return nullptr;
+    }
+    result[length] = 0;
+
+    if (out_length) *out_length = length;
+    return result;
+}
+
+bool os_file_exists(char *filepath) {
+    FILE *file = fopen(filepath, "rb");
+    if (!file) return false;
+    fclose(file);
+    return true;
+}
+
+// Modification times are in seconds, not the FILETIME units os_windows.cpp
+// uses; the benchmarks only compare them with each other.
+void os_visit_files(char *directory, Visit_File_Proc proc, void *data, bool recursive) {
+#ifdef _WIN32
+    char *pattern = mprintf("%s/*", directory);
+    defer { delete [] pattern; };
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE handle = FindFirstFileA(pattern, &find_data);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    defer { FindClose(handle); };
+
+    do {
+        char *name = find_data.cFileName;
+#else
+    DIR *dir = opendir(directory);
+    if (!dir) return;
+    defer { closedir(dir); };
+
+    while (dirent *entry = readdir(dir)) {
+        char *name = entry->d_name;
+#endif
+
+        if (strings_match(name, ".") || strings_match(name, "..")) continue;
+
+        char *full_path = mprintf("%s/%s", directory, name);
+        defer { delete [] full_path; };
+
+        struct stat stat_info;
+        if (stat(full_path, &stat_info) != 0) continue;
+
+        if (stat_info.st_mode & S_IFDIR) {
+            if (recursive) os_visit_files(full_path, proc, data, true);
+            continue;
+        }
+
+        File_Info info;
+        info.full_path = full_path;
+        info.size = (s64)stat_info.st_size;
+        info.modification_time = (u64)stat_info.st_mtime;
+        proc(&info, data);
+#ifdef _WIN32
+    } while (FindNextFileA(handle, &find_data));
+#else
+    }
+#endif
+}
+
+static void thread_entry(Thread_Proc proc, void *data) {
+    proc(data);
+}
+
+Thread *os_create_thread(Thread_Proc proc, void *data) {
+    Thread *result = new Thread();
+    result->thread = std::thread(thread_entry, proc, data);
+    result->thread.detach();
+    return result;
+}
+
+int os_get_processor_count() {
+    return Max((int)std::thread::hardware_concurrency(), 1);
+}
+
+void os_sleep(u32 milliseconds) {
+    if (milliseconds) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+void os_enable_fine_sleep() {
+}
+
+Mutex *os_create_mutex() {
+    return new Mutex();
+}
+
+void os_lock_mutex(Mutex *mutex) {
+    mutex->mutex.lock();
+}
+
+void os_unlock_mutex(Mutex *mutex) {
+    mutex->mutex.unlock();
+}
+
+Semaphore *os_create_semaphore(int initial_count, int max_count) {
+    Semaphore *result = new Semaphore();
+    result->count = initial_count;
+    result->max_count = max_count;
+    return result;
+}
+
+void os_wait_semaphore(Semaphore *semaphore) {
+    std::unique_lock <std::mutex> lock(semaphore->mutex);
+    while (!semaphore->count) semaphore->condition.wait(lock);
+    semaphore->count--;
+}
+
+void os_signal_semaphore(Semaphore *semaphore, int count) {
+    {
+        std::lock_guard <std::mutex> lock(semaphore->mutex);
+        semaphore->count = Min(semaphore->count + count, semaphore->max_count);
+    }
+    semaphore->condition.notify_all();
+}
+
+s32 os_atomic_add(volatile s32 *value, s32 addend) {
+#ifdef _MSC_VER
+    return _InterlockedExchangeAdd((volatile long *)value, addend) + addend;
+#else
+    return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+#endif
+}
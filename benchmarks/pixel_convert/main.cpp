@@ -0,0 +1,166 @@
+// Times the pixel_convert kernels against the scalar loops they replaced.
+//
+//     pixel_convert_benchmark
+//
+// The old loops are copied here as they were, so the comparison keeps
+// working after the engine code moves on. Builds on Linux too:
+//     g++ -O2 -std=c++14 -mssse3 -pthread -Wno-write-strings -I../../external/include main.cpp ../benchmark.cpp ../os_std.cpp ../../src/pixel_convert.cpp ../../src/jobs.cpp -o pixel_convert_benchmark
+
+#include "../benchmark.h"
+#include "../../src/pixel_convert.h"
+#include "../../src/jobs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const int IMAGE_SIZE = 2048;
+const s64 NUM_PIXELS = (s64)IMAGE_SIZE * IMAGE_SIZE;
+
+// A glyph row, the size pack_glyph converts at a time.
+const int GLYPH_WIDTH = 48;
+const int GLYPH_ROWS_PER_RUN = 64 * 1024;
+
+struct Images {
+    u8 *rgb;
+    u8 *rgba;
+    u8 *coverage;
+    u32 *packed;
+};
+
+//
+// The loops from before pixel_convert
+//
+
+// init_texture's RGB8 -> RGBA8 expansion.
+static void old_rgb_to_rgba(void *data) {
+    Images *images = (Images *)data;
+    for (int y = 0; y < IMAGE_SIZE; y++) {
+        for (int x = 0; x < IMAGE_SIZE; x++) {
+            u8 *source = &images->rgb[(y * IMAGE_SIZE + x) * 3];
+            u8 *dest = &images->rgba[(y * IMAGE_SIZE + x) * 4];
+
+            dest[0] = source[0];
+            dest[1] = source[1];
+            dest[2] = source[2];
+            dest[3] = 255;
+        }
+    }
+}
+
+// pack_glyph's coverage copy, one row at a time.
+static void old_a8_to_rgba(void *data) {
+    Images *images = (Images *)data;
+    for (int row = 0; row < GLYPH_ROWS_PER_RUN; row++) {
+        u8 *source = images->coverage + (s64)row * GLYPH_WIDTH;
+        u8 *dest = images->rgba + (s64)row * GLYPH_WIDTH * 4;
+
+        for (int x = 0; x < GLYPH_WIDTH; x++) {
+            dest[0] = 255;
+            dest[1] = 255;
+            dest[2] = 255;
+            dest[3] = source[x];
+            dest += 4;
+        }
+    }
+}
+
+// Bitmap::get_rgb, called per pixel by terrain generation.
+static u32 old_get_rgb(u8 *data, int width, int channels, int x, int y) {
+    u32 bytes_per_pixel = channels;
+    u8 *pixel_offset = data + ((y * width + x) * bytes_per_pixel);
+    u8 r = pixel_offset[0];
+    u8 g = pixel_offset[1];
+    u8 b = pixel_offset[2];
+    u8 a = 0x00;
+    return (a << 24) | (r << 16) | (g << 8) | (b << 0);
+}
+
+static void old_packed_rgb(void *data) {
+    Images *images = (Images *)data;
+    for (int y = 0; y < IMAGE_SIZE; y++) {
+        for (int x = 0; x < IMAGE_SIZE; x++) {
+            images->packed[y * IMAGE_SIZE + x] = old_get_rgb(images->rgb, IMAGE_SIZE, 3, x, y);
+        }
+    }
+}
+
+//
+// pixel_convert
+//
+
+// Split below PIXEL_CONVERT_PARALLEL_THRESHOLD, so this is the kernel alone
+// on one thread.
+static void new_rgb_to_rgba_one_thread(void *data) {
+    Images *images = (Images *)data;
+    s64 chunk = PIXEL_CONVERT_PARALLEL_THRESHOLD - 16;
+    for (s64 first = 0; first < NUM_PIXELS; first += chunk) {
+        s64 count = Min(chunk, NUM_PIXELS - first);
+        convert_rgb_to_rgba(images->rgb + first * 3, images->rgba + first * 4, count);
+    }
+}
+
+static void new_rgb_to_rgba(void *data) {
+    Images *images = (Images *)data;
+    convert_rgb_to_rgba(images->rgb, images->rgba, NUM_PIXELS);
+}
+
+static void new_a8_to_rgba(void *data) {
+    Images *images = (Images *)data;
+    for (int row = 0; row < GLYPH_ROWS_PER_RUN; row++) {
+        convert_a8_to_rgba(images->coverage + (s64)row * GLYPH_WIDTH, images->rgba + (s64)row * GLYPH_WIDTH * 4, GLYPH_WIDTH);
+    }
+}
+
+static void new_packed_rgb(void *data) {
+    Images *images = (Images *)data;
+    convert_to_packed_rgb(images->rgb, 3, images->packed, NUM_PIXELS);
+}
+
+int main() {
+    init_benchmark();
+    init_jobs();
+
+    Images images = {};
+    images.rgb = new u8[NUM_PIXELS * 3];
+    images.rgba = new u8[NUM_PIXELS * 4];
+    images.coverage = new u8[(s64)GLYPH_ROWS_PER_RUN * GLYPH_WIDTH];
+    images.packed = new u32[NUM_PIXELS];
+
+    srand(1);
+    for (s64 i = 0; i < NUM_PIXELS * 3; i++) images.rgb[i] = (u8)rand();
+    for (s64 i = 0; i < (s64)GLYPH_ROWS_PER_RUN * GLYPH_WIDTH; i++) images.coverage[i] = (u8)rand();
+
+    printf("%d job workers, %dx%d RGB image, %d glyph rows of %d pixels\n\n", get_num_job_workers(), IMAGE_SIZE, IMAGE_SIZE, GLYPH_ROWS_PER_RUN, GLYPH_WIDTH);
+
+    f64 old_time = run_benchmark("RGB -> RGBA, old loop", old_rgb_to_rgba, &images, NUM_PIXELS);
+    u8 *expected = new u8[NUM_PIXELS * 4];
+    memcpy(expected, images.rgba, NUM_PIXELS * 4);
+
+    f64 one_thread_time = run_benchmark("RGB -> RGBA, kernel, one thread", new_rgb_to_rgba_one_thread, &images, NUM_PIXELS);
+    f64 banded_time = run_benchmark("RGB -> RGBA, kernel, banded", new_rgb_to_rgba, &images, NUM_PIXELS);
+    if (memcmp(expected, images.rgba, NUM_PIXELS * 4)) printf("RGB -> RGBA output differs from the old loop!\n");
+
+    report_speedup("RGB -> RGBA, one thread", old_time, one_thread_time);
+    report_speedup("RGB -> RGBA, banded", old_time, banded_time);
+    printf("\n");
+
+    old_time = run_benchmark("A8 -> RGBA glyph rows, old loop", old_a8_to_rgba, &images, (s64)GLYPH_ROWS_PER_RUN * GLYPH_WIDTH);
+    memcpy(expected, images.rgba, (s64)GLYPH_ROWS_PER_RUN * GLYPH_WIDTH * 4);
+
+    f64 new_time = run_benchmark("A8 -> RGBA glyph rows, kernel", new_a8_to_rgba, &images, (s64)GLYPH_ROWS_PER_RUN * GLYPH_WIDTH);
+    if (memcmp(expected, images.rgba, (s64)GLYPH_ROWS_PER_RUN * GLYPH_WIDTH * 4)) printf("A8 -> RGBA output differs from the old loop!\n");
+
+    report_speedup("A8 -> RGBA", old_time, new_time);
+    printf("\n");
+
+    old_time = run_benchmark("Packed height, Bitmap::get_rgb", old_packed_rgb, &images, NUM_PIXELS);
+    memcpy(expected, images.packed, NUM_PIXELS * 4);
+
+    new_time = run_benchmark("Packed height, kernel, banded", new_packed_rgb, &images, NUM_PIXELS);
+    if (memcmp(expected, images.packed, NUM_PIXELS * 4)) printf("Packed height output differs from the old loop!\n");
+
+    report_speedup("Packed height", old_time, new_time);
+
+    return 0;
+}
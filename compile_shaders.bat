@@ -1,3 +1,3 @@
 @echo off
 
-run_tree\shader_compiler color texture basic_3d msaa_2x msaa_4x msaa_8x text terrain
+run_tree\shader_compiler color texture basic_3d msaa_2x msaa_4x msaa_8x text terrain terrain_one_layer terrain_two_layers
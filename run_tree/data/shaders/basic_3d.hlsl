@@ -1,10 +1,13 @@
 // @NoAlphaBlend
 
+#include "lighting.hlsli"
+
 struct VSOutput {
     float4 position : SV_POSITION;
     float4 world_position : POSITION;
     float2 uv : UV;
     float3 world_normal : NORMAL;
+    float view_depth : VIEW_DEPTH;
 };
 
 cbuffer Transform : register(b0) {
@@ -20,6 +23,7 @@ VSOutput vertex_main(float3 position : POSITION, float2 uv : UV, float3 normal :
     output.world_position = mul(world, float4(position, 1.0));
     output.position = mul(view, output.world_position);
     output.position = mul(projection, output.position);
+    output.view_depth = output.position.w;
     output.uv = uv;
     output.world_normal = mul(world, float4(normal, 0.0)).xyz;
     
@@ -39,9 +43,12 @@ PSOutput pixel_main(VSOutput input) {
     float3 light_pos = float3(0.0, 0.0, 0.0);
     
     float3 light_dir = normalize(light_pos - input.world_position.xyz);
-    float dot_result = dot(normalize(input.world_normal), light_dir);
+    float3 normal = normalize(input.world_normal);
+    float dot_result = dot(normal, light_dir);
     float brightness = max(0.0, dot_result);
     float3 diffuse = brightness;
+
+    diffuse += get_point_lighting(input.world_position.xyz, normal, input.position.xy, input.view_depth);
     
     float4 sampled_color = diffuse_texture.Sample(diffuse_sampler_state, input.uv);
     output.color = sampled_color * float4(diffuse, 1.0);
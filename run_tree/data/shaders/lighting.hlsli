@@ -0,0 +1,61 @@
+// Clustered point lights, binned on the CPU by build_light_clusters in
+// lighting.cpp. Slots b2 and t4 to t6 are kept for these and set once a frame
+// by set_light_clusters.
+
+// Must match Light_Cluster_Constants in lighting.h.
+cbuffer Lighting : register(b2) {
+    float2 tiles_per_pixel;
+    float first_slice_depth;
+    float slices_per_log2_depth;
+    uint3 num_clusters;
+    uint num_lights;
+};
+
+// Three float4s per light: position and radius, color, attenuation.
+Buffer<float4> point_lights : register(t4);
+
+// Per cluster, the first of its entries in light_indices and how many.
+Buffer<uint2> light_clusters : register(t5);
+Buffer<uint> light_indices : register(t6);
+
+// Must match get_slice in lighting.cpp. Tiles count down from the top of the
+// screen, the same way pixel positions do.
+uint get_cluster_index(float2 pixel_position, float view_depth) {
+    uint2 tile = min((uint2)(pixel_position * tiles_per_pixel), num_clusters.xy - 1);
+
+    uint slice = 0;
+    if (view_depth >= first_slice_depth) {
+        slice = min(1 + (uint)(log2(view_depth / first_slice_depth) * slices_per_log2_depth), num_clusters.z - 1);
+    }
+
+    return (slice * num_clusters.y + tile.y) * num_clusters.x + tile.x;
+}
+
+float3 get_point_lighting(float3 world_position, float3 normal, float2 pixel_position, float view_depth) {
+    uint2 range = light_clusters[get_cluster_index(pixel_position, view_depth)];
+
+    float3 result = 0;
+
+    [loop]
+    for (uint i = 0; i < range.y; i++) {
+        uint light = light_indices[range.x + i] * 3;
+        float4 position_radius = point_lights[light + 0];
+        float3 color = point_lights[light + 1].rgb;
+        float3 attenuation = point_lights[light + 2].xyz;
+
+        float3 to_light = position_radius.xyz - world_position;
+        float light_distance = length(to_light);
+        float brightness = max(0.0, dot(normal, to_light / max(light_distance, 0.0001)));
+
+        // Fades out by the radius the light was binned with, so it never
+        // stops short at a cluster boundary.
+        float ratio = light_distance / position_radius.w;
+        float falloff = saturate(1.0 - ratio * ratio * ratio * ratio);
+        falloff *= falloff;
+
+        float attenuation_factor = attenuation.x + attenuation.y * light_distance + attenuation.z * light_distance * light_distance;
+        result += color * (brightness * falloff / max(attenuation_factor, 0.0001));
+    }
+
+    return result;
+}
@@ -0,0 +1,81 @@
+// Shared by the terrain shader variants. Which one a chunk uses depends on how
+// many of the layers its part of the blend map actually uses; see
+// find_chunk_layers in terrain.cpp.
+
+#include "lighting.hlsli"
+
+struct VSOutput {
+    float4 position : SV_POSITION;
+    float4 world_position : POSITION;
+    float2 uv : UV;
+    float3 world_normal : NORMAL;
+    float view_depth : VIEW_DEPTH;
+};
+
+cbuffer Transform : register(b0) {
+    float4x4 projection;
+    float4x4 view;
+    float4x4 world;
+    float4x4 transform;
+};
+
+// Layer indices for the one and two layer variants.
+cbuffer Terrain_Chunk : register(b1) {
+    uint layer_a;
+    uint layer_b;
+    uint2 chunk_padding;
+};
+
+VSOutput vertex_main(float3 position : POSITION, float2 uv : UV, float3 normal : NORMAL) {
+    VSOutput output;
+
+    output.world_position = mul(world, float4(position, 1.0));
+    output.position = mul(view, output.world_position);
+    output.position = mul(projection, output.position);
+    output.view_depth = output.position.w;
+    output.uv = uv;
+    output.world_normal = mul(world, float4(normal, 0.0)).xyz;
+    
+    return output;
+}
+
+struct PSOutput {
+    float4 color : SV_TARGET;
+};
+
+// Background, r, g and b in that order.
+Texture2DArray terrain_layers : register(t0);
+Texture2D blend_map : register(t1);
+SamplerState texture_sampler : register(s0);
+
+// Must match TERRAIN_TEXTURE_TILING in terrain.h.
+static const float TEXTURE_TILING = 100.0;
+
+float4 sample_layer(float2 uv, uint layer) {
+    return terrain_layers.Sample(texture_sampler, float3(uv * TEXTURE_TILING, layer));
+}
+
+// How much of each layer shows, indexed the same way as the array.
+// The blend map is bound UNORM, so these are the weights as stored, the same
+// bytes terrain.cpp reads to pick each chunk's shader.
+float4 get_layer_amounts(float2 uv) {
+    float4 blend_map_color = blend_map.Sample(texture_sampler, uv);
+
+    float background_amount = 1 - (blend_map_color.r + blend_map_color.g + blend_map_color.b);
+    return float4(background_amount, blend_map_color.rgb);
+}
+
+float4 light_terrain(VSOutput input, float4 color) {
+    float3 light_pos = float3(0.0, 50.0, 5000.0);
+    
+    float3 light_dir = normalize(light_pos - input.world_position.xyz);
+    float3 normal = normalize(input.world_normal);
+    float dot_result = dot(normal, light_dir);
+    float brightness = max(0.0, dot_result);
+    float3 diffuse = brightness;
+    
+    diffuse = max(diffuse, 0.1);
+    diffuse += get_point_lighting(input.world_position.xyz, normal, input.position.xy, input.view_depth);
+    
+    return color * float4(diffuse, 1.0);
+}
@@ -0,0 +1,13 @@
+// @NoBlend
+
+// Chunks covered by a single layer skip the blend map altogether.
+
+#include "terrain_common.hlsli"
+
+PSOutput pixel_main(VSOutput input) {
+    PSOutput output;
+
+    output.color = light_terrain(input, sample_layer(input.uv, layer_a));
+    
+    return output;
+}
@@ -0,0 +1,21 @@
+// @NoBlend
+
+// Chunks where only two layers show. Whatever faint traces of the others the
+// blend map has are dropped, and the two amounts are renormalized.
+
+#include "terrain_common.hlsli"
+
+PSOutput pixel_main(VSOutput input) {
+    PSOutput output;
+
+    float4 amounts = get_layer_amounts(input.uv);
+    float amount_a = max(amounts[layer_a], 0.0);
+    float amount_b = max(amounts[layer_b], 0.0);
+    float t = amount_b / max(amount_a + amount_b, 0.0001);
+
+    float4 total_color = lerp(sample_layer(input.uv, layer_a), sample_layer(input.uv, layer_b), t);
+
+    output.color = light_terrain(input, total_color);
+    
+    return output;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <direct.h>
 #include <windows.h>
 
@@ -21,6 +22,37 @@ u64 get_last_write_time(char *file_path) {
     return li.QuadPart;
 }
 
+// A shader is as new as the newest file it #includes, directly or through
+// another include, so editing a shared include rebuilds every shader that
+// uses it. Includes are looked up next to the shader, the way fxc does by
+// default.
+u64 get_last_write_time_with_includes(char *file_path) {
+    u64 result = get_last_write_time(file_path);
+
+    FILE *file = fopen(file_path, "rt");
+    if (!file) return result;
+    defer { fclose(file); };
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        char *include = strstr(line, "#include \"");
+        if (!include) continue;
+
+        char *name = include + strlen("#include \"");
+        char *end = strchr(name, '"');
+        if (!end) continue;
+        *end = 0;
+
+        char *include_path = mprintf("..\\..\\run_tree\\data\\shaders\\%s", name);
+        u64 include_last_write_time = get_last_write_time_with_includes(include_path);
+        delete [] include_path;
+
+        if (include_last_write_time > result) result = include_last_write_time;
+    }
+
+    return result;
+}
+
 int main(int argc, char **argv) {
     if (argc == 1) {
         printf("No file name provided\n");
@@ -47,7 +79,7 @@ int main(int argc, char **argv) {
         char *name = file_names[i];
 
         char *path = mprintf("..\\..\\run_tree\\data\\shaders\\%s.hlsl", name);
-        u64 shader_file_last_write_time = get_last_write_time(path);
+        u64 shader_file_last_write_time = get_last_write_time_with_includes(path);
         delete [] path;
         
         path = mprintf("%s_vs.h", name);
@@ -3,6 +3,14 @@
 
 #include <assert.h>
 #include <new>
+#include <type_traits>
+#include <utility>
+
+#include "general.h"
+
+// Trivially copyable element types (vectors, indices, pointers) grow with a
+// single reallocate and never run constructors or destructors; everything else
+// is move-constructed into the new block and destroyed in the old one.
 
 template<typename T>
 struct Array {
@@ -10,93 +18,152 @@ struct Array {
     int count = 0;
     int allocated = 0;
 
+    Allocator allocator = {};
+
+    inline Array() {}
+    inline Array(Allocator _allocator) : allocator(_allocator) {}
+
+    // Grows to at least newSize, following the doubling schedule so repeated
+    // reserves don't degrade into one reallocation per call.
     inline void reserve(int newSize) {
+        if (newSize > allocated) {
+            int grown = allocated ? allocated * 2 : 16;
+            resize(Max(newSize, grown));
+        }
+    }
+
+    // Grows to exactly newSize, for callers that know the final count up front.
+    inline void reserve_exact(int newSize) {
         if (newSize > allocated) {
             resize(newSize);
         }
     }
-    
-    inline ~Array() {
-        if (data) {
-            ::operator delete(data, allocated * sizeof(T));
+
+    inline void shrink_to_fit() {
+        if (count < allocated) {
+            resize(count);
         }
     }
-    
+
+    inline ~Array() {
+        destroy_range(0, count);
+        deallocate(allocator, data);
+    }
+
     inline void add(const T& value) {
         if (count >= allocated) {
-            if (!allocated) {
-                allocated = 16;
-            }
-            resize(allocated * 2);
+            resize(allocated ? allocated * 2 : 16);
         }
-        
-        data[count] = value;
+
+        new (&data[count]) T(value);
+        count++;
+    }
+
+    inline void add(T&& value) {
+        if (count >= allocated) {
+            resize(allocated ? allocated * 2 : 16);
+        }
+
+        new (&data[count]) T(std::move(value));
         count++;
     }
 
     inline T *add() {
         if (count >= allocated) {
-            if (!allocated) {
-                allocated = 16;
-            }
-            resize(allocated * 2);
+            resize(allocated ? allocated * 2 : 16);
         }
 
-        T tmp = {};
-        data[count] = tmp;
-        T *result = &data[count++];
+        T *result = new (&data[count]) T();
+        count++;
         return result;
     }
-    
-    inline void resize(int newSize) {
-        T *new_block = (T *)::operator new(newSize * sizeof(T));
 
+    inline void resize(int newSize) {
         if (newSize < count) {
+            destroy_range(newSize, count);
             count = newSize;
         }
-        
-        for (int i = 0; i < count; i++) {
-            new_block[i] = data[i];
-        }
-        
-        if (data) {
-            ::operator delete(data, allocated * sizeof(T));
+
+        if (newSize == 0) {
+            deallocate(allocator, data);
+            data = NULL;
+            allocated = 0;
+            return;
         }
-        data = new_block;
+
+        data = move_to_new_block(newSize, std::is_trivially_copyable<T>());
         allocated = newSize;
     }
 
+    // Destroys the elements but keeps the memory around for reuse.
+    inline void reset() {
+        destroy_range(0, count);
+        count = 0;
+    }
+
     inline T remove_nth(int index) {
-        T result = data[index];
-        data[index] = data[count - 1];
+        assert(index < count);
+
+        T result = std::move(data[index]);
+        if (index != count - 1) {
+            data[index] = std::move(data[count - 1]);
+        }
+        data[count - 1].~T();
         count--;
 
         return result;
     }
-    
+
     inline const T &get(int index) const {
         assert(index < count);
-        
+
         return data[index];
     }
 
     inline T &get(int index) {
         assert(index < count);
-        
+
         return data[index];
     }
-    
+
     inline const T &operator[](int index) const {
         assert(index < count);
-        
+
         return data[index];
     }
-    
+
     inline T &operator[](int index) {
         assert(index < count);
-        
+
         return data[index];
     }
+
+  private:
+    inline void destroy_range(int first, int last) {
+        if (std::is_trivially_destructible<T>::value) return;
+
+        for (int i = first; i < last; i++) {
+            data[i].~T();
+        }
+    }
+
+    inline T *move_to_new_block(int newSize, std::true_type /*trivially_copyable*/) {
+        if (!data) return (T *)allocate(allocator, (s64)newSize * sizeof(T));
+
+        return (T *)reallocate(allocator, data, (s64)allocated * sizeof(T), (s64)newSize * sizeof(T));
+    }
+
+    inline T *move_to_new_block(int newSize, std::false_type /*trivially_copyable*/) {
+        T *new_block = (T *)allocate(allocator, (s64)newSize * sizeof(T));
+
+        for (int i = 0; i < count; i++) {
+            new (&new_block[i]) T(std::move(data[i]));
+            data[i].~T();
+        }
+
+        deallocate(allocator, data);
+        return new_block;
+    }
 };
 
 #endif
@@ -0,0 +1,194 @@
+#include "assets.h"
+
+#include "os.h"
+#include "text_file_handler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int ASSET_MANIFEST_VERSION = 1;
+
+struct Asset_Directory {
+    char *directory;
+    Asset_Type type;
+    bool keep_extension;
+
+    // In order of preference when the same name shows up more than once.
+    char *extensions[4];
+};
+
+static Asset_Directory asset_directories[] = {
+    { "data/textures", ASSET_TEXTURE, false, { "png", "jpg", "bmp" } },
+    { "data/meshes",   ASSET_MESH,    false, { "obj" } },
+    { "data/fonts",    ASSET_FONT,    true,  { "ttf", "otf" } },
+    { "data/shaders",  ASSET_SHADER,  false, { "hlsl" } },
+    { "data/cooked",   ASSET_COOKED_TEXTURE, false, { "tex" } },
+};
+
+static Hash_Table <Atom, Asset_Entry> asset_tables[NUM_ASSET_TYPES];
+static int num_assets;
+
+static int get_extension_priority(Asset_Directory *directory, char *extension) {
+    for (int i = 0; i < ArrayCount(directory->extensions); i++) {
+        if (directory->extensions[i] && strings_match(directory->extensions[i], extension)) return i;
+    }
+
+    return -1;
+}
+
+static bool register_asset_file(char *full_path, s64 size, u64 modification_time) {
+    for (int i = 0; i < ArrayCount(asset_directories); i++) {
+        Asset_Directory *directory = &asset_directories[i];
+
+        int directory_length = get_string_length(directory->directory);
+        if (strncmp(full_path, directory->directory, directory_length) != 0) continue;
+        if (full_path[directory_length] != '/') continue;
+
+        char *relative_path = full_path + directory_length + 1;
+        char *dot = find_character_from_right(relative_path, '.');
+        if (!dot) return false;
+
+        int priority = get_extension_priority(directory, dot + 1);
+        if (priority < 0) return false;
+
+        Arena_Mark mark = get_arena_mark(&frame_arena);
+        defer { rewind_arena(&frame_arena, mark); };
+
+        int name_length = directory->keep_extension ? get_string_length(relative_path) : (int)(dot - relative_path);
+        Atom name = intern(tprint("%.*s", name_length, relative_path));
+
+        Hash_Table <Atom, Asset_Entry> *table = &asset_tables[directory->type];
+        Asset_Entry *existing = table->get(name);
+        if (existing) {
+            char *existing_dot = find_character_from_right(existing->full_path, '.');
+            if (get_extension_priority(directory, existing_dot + 1) <= priority) return false;
+
+            delete [] existing->full_path;
+            num_assets--;
+        }
+
+        Asset_Entry entry;
+        entry.name = name;
+        entry.type = directory->type;
+        entry.full_path = copy_string(full_path);
+        entry.size = size;
+        entry.modification_time = modification_time;
+
+        table->add(name, entry);
+        num_assets++;
+        return true;
+    }
+
+    return false;
+}
+
+static void visit_asset_file(File_Info *info, void *data) {
+    register_asset_file(info->full_path, info->size, info->modification_time);
+}
+
+static void clear_assets() {
+    for (int type = 0; type < NUM_ASSET_TYPES; type++) {
+        Hash_Table <Atom, Asset_Entry> *table = &asset_tables[type];
+        for (int i = 0; i < table->allocated; i++) {
+            if (!table->is_slot_full(i)) continue;
+            delete [] table->buckets[i].value.full_path;
+        }
+
+        table->deinit();
+    }
+
+    num_assets = 0;
+}
+
+void scan_assets() {
+    clear_assets();
+
+    for (int i = 0; i < ArrayCount(asset_directories); i++) {
+        os_visit_files(asset_directories[i].directory, visit_asset_file, nullptr);
+    }
+}
+
+bool load_asset_manifest(char *file_path) {
+    Text_File_Handler handler;
+    handler.strip_comments_from_end_of_lines = false; // '#' is legal in a path.
+    handler.start_file(file_path, file_path, "assets");
+    if (handler.failed) return false;
+
+    if (handler.version != ASSET_MANIFEST_VERSION) {
+        printf("[assets] '%s' has version %d, expected %d.\n", file_path, handler.version, ASSET_MANIFEST_VERSION);
+        return false;
+    }
+
+    clear_assets();
+
+    while (true) {
+        char *line = handler.consume_next_line();
+        if (!line) break;
+
+        // <size> <modification_time> <path>, the path runs to the end of the line.
+        char *at = line;
+        s64 size = strtoll(at, &at, 10);
+        u64 modification_time = strtoull(at, &at, 10);
+        char *full_path = eat_spaces(at);
+
+        if (!*full_path) {
+            printf("[assets] Malformed line %d in '%s'.\n", handler.line_number, file_path);
+            continue;
+        }
+
+        if (!register_asset_file(full_path, size, modification_time)) {
+            printf("[assets] Line %d in '%s': '%s' is not a known asset type.\n", handler.line_number, file_path, full_path);
+        }
+    }
+
+    return true;
+}
+
+bool write_asset_manifest(char *file_path) {
+    FILE *file = fopen(file_path, "wt");
+    if (!file) {
+        printf("[assets] Unable to open file '%s' for writing\n", file_path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    fprintf(file, "[%d]\n\n", ASSET_MANIFEST_VERSION);
+    fprintf(file, "# size modification_time path\n");
+
+    for (int type = 0; type < NUM_ASSET_TYPES; type++) {
+        Hash_Table <Atom, Asset_Entry> *table = &asset_tables[type];
+        for (int i = 0; i < table->allocated; i++) {
+            if (!table->is_slot_full(i)) continue;
+
+            Asset_Entry *entry = &table->buckets[i].value;
+            fprintf(file, "%lld %llu %s\n", (long long)entry->size, (unsigned long long)entry->modification_time, entry->full_path);
+        }
+    }
+
+    return true;
+}
+
+void init_asset_registry() {
+    // Debug builds are where data/ gets edited, and a stale manifest would
+    // hide new or renamed files, so they always scan.
+#ifndef _DEBUG
+    if (os_file_exists(ASSET_MANIFEST_FILEPATH) && load_asset_manifest(ASSET_MANIFEST_FILEPATH)) {
+        return;
+    }
+#endif
+
+    scan_assets();
+}
+
+Asset_Entry *find_asset(Asset_Type type, Atom name) {
+    assert(type >= 0 && type < NUM_ASSET_TYPES);
+    return asset_tables[type].get(name);
+}
+
+Asset_Entry *find_asset(Asset_Type type, char *name) {
+    return find_asset(type, intern(name));
+}
+
+int get_num_assets() {
+    return num_assets;
+}
@@ -0,0 +1,44 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "atom.h"
+
+#define ASSET_MANIFEST_FILEPATH "data/assets.manifest"
+
+enum Asset_Type {
+    ASSET_TEXTURE,
+    ASSET_MESH,
+    ASSET_FONT,
+    ASSET_SHADER,
+    ASSET_COOKED_TEXTURE, // texture_cooker output, same names as the sources.
+
+    NUM_ASSET_TYPES
+};
+
+// Names are paths relative to the type's folder. Textures, meshes and shaders
+// drop the extension ("grass", "skybox/front"); fonts keep it, since that's how
+// they've always been asked for ("OpenSans-SemiBold.ttf"). When a texture
+// exists in several formats, png beats jpg beats bmp.
+struct Asset_Entry {
+    Atom name;
+    Asset_Type type;
+
+    char *full_path;
+    s64 size;
+    u64 modification_time;
+};
+
+// Reads the manifest if there is one, otherwise scans data/. Ship a manifest
+// (see -write_asset_manifest) to skip the scan. Debug builds always scan.
+void init_asset_registry();
+
+void scan_assets();
+bool load_asset_manifest(char *file_path);
+bool write_asset_manifest(char *file_path);
+
+Asset_Entry *find_asset(Asset_Type type, Atom name);
+Asset_Entry *find_asset(Asset_Type type, char *name);
+
+int get_num_assets();
+
+#endif
@@ -0,0 +1,33 @@
+#include "atom.h"
+
+static Hash_Table <u64, char *> interned_strings;
+
+Atom intern(char *string) {
+    Atom result;
+    result.id = hash_atom_string(string);
+
+    char **existing = interned_strings.get(result.id);
+    if (existing) {
+        assert(strings_match(*existing, string)); // 64-bit hash collision between two names.
+        result.string = *existing;
+        return result;
+    }
+
+    result.string = copy_string(string);
+    interned_strings.add(result.id, result.string);
+    return result;
+}
+
+#ifdef _DEBUG
+Atom register_atom_literal(Atom atom) {
+    char **existing = interned_strings.get(atom.id);
+    if (existing) {
+        assert(strings_match(*existing, atom.string)); // 64-bit hash collision between two names.
+        return atom;
+    }
+
+    // Literals live forever, no need for a copy.
+    interned_strings.add(atom.id, atom.string);
+    return atom;
+}
+#endif
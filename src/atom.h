@@ -0,0 +1,61 @@
+#ifndef ATOM_H
+#define ATOM_H
+
+#include "general.h"
+#include "hash_table.h"
+
+//
+// An atom is an interned name: a 64-bit FNV-1a hash of the string together
+// with a pointer to a copy of it that lives forever. Atoms compare by id
+// only, the string is there for loaders and logging.
+//
+// ATOM("grass") is hashed at compile time. intern() hashes at runtime and
+// registers the string, so collisions between runtime names get caught.
+// Debug builds also register each ATOM literal the first time it runs, which
+// catches literals colliding with each other or with runtime names.
+//
+
+struct Atom {
+    u64 id;
+    char *string;
+};
+
+const u64 ATOM_HASH_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+const u64 ATOM_HASH_PRIME = 0x100000001b3ULL;
+
+constexpr u64 hash_atom_string(const char *string) {
+    u64 result = ATOM_HASH_OFFSET_BASIS;
+    while (*string) {
+        result = (result ^ (u8)*string) * ATOM_HASH_PRIME;
+        string++;
+    }
+    return result;
+}
+
+constexpr Atom make_atom_from_literal(const char *literal) {
+    return { hash_atom_string(literal), const_cast <char *>(literal) };
+}
+
+#ifdef _DEBUG
+Atom register_atom_literal(Atom atom);
+
+#define ATOM(literal) ([]() { constexpr Atom atom = make_atom_from_literal(literal); static Atom registered = register_atom_literal(atom); return registered; }())
+#else
+#define ATOM(literal) ([]() { constexpr Atom atom = make_atom_from_literal(literal); return atom; }())
+#endif
+
+inline bool operator==(Atom a, Atom b) {
+    return a.id == b.id;
+}
+
+inline bool operator!=(Atom a, Atom b) {
+    return a.id != b.id;
+}
+
+inline int hash(Atom atom) {
+    return hash(atom.id);
+}
+
+Atom intern(char *string);
+
+#endif
@@ -3,11 +3,47 @@
 
 #include "general.h"
 
+// Cooked textures store these values, so only ever append.
 enum Texture_Format {
-    TEXTURE_FORMAT_RGBA8,
-    TEXTURE_FORMAT_RGB8,
+    TEXTURE_FORMAT_RGBA8 = 0,
+    TEXTURE_FORMAT_RGB8  = 1,
+
+    // Block compressed, 4x4 pixel blocks.
+    TEXTURE_FORMAT_BC1   = 2, // RGB, 8 bytes per block.
+    TEXTURE_FORMAT_BC3   = 3, // RGBA, 16 bytes per block.
+    TEXTURE_FORMAT_BC5   = 4, // Two channels (normal map XY), 16 bytes per block.
+    TEXTURE_FORMAT_BC7   = 5, // RGBA, 16 bytes per block.
 };
 
+inline bool is_block_compressed(Texture_Format format) {
+    return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC3 ||
+           format == TEXTURE_FORMAT_BC5 || format == TEXTURE_FORMAT_BC7;
+}
+
+// Bytes per 4x4 block for compressed formats, bytes per pixel otherwise.
+inline int get_texture_format_unit_size(Texture_Format format) {
+    switch (format) {
+        case TEXTURE_FORMAT_RGBA8: return 4;
+        case TEXTURE_FORMAT_RGB8:  return 3;
+        case TEXTURE_FORMAT_BC1:   return 8;
+        case TEXTURE_FORMAT_BC3:   return 16;
+        case TEXTURE_FORMAT_BC5:   return 16;
+        case TEXTURE_FORMAT_BC7:   return 16;
+    }
+
+    return 0;
+}
+
+inline s64 get_texture_row_pitch(Texture_Format format, int width) {
+    if (is_block_compressed(format)) return (s64)((width + 3) / 4) * get_texture_format_unit_size(format);
+    return (s64)width * get_texture_format_unit_size(format);
+}
+
+inline s64 get_texture_level_size(Texture_Format format, int width, int height) {
+    int num_rows = is_block_compressed(format) ? (height + 3) / 4 : height;
+    return get_texture_row_pitch(format, width) * num_rows;
+}
+
 struct Bitmap {
     int width;
     int height;
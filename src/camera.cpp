@@ -14,48 +14,51 @@ Camera make_camera(Vector3 position, float pitch, float yaw, float roll) {
     return result;
 }
 
-void update_camera(Camera *camera) {
-    float dt = globals.time_info.current_dt;
-
+void update_camera_look(Camera *camera) {
     float sensitivity = 0.1f;
     camera->yaw += get_mouse_pointer_delta_x() * sensitivity;
     camera->pitch += get_mouse_pointer_delta_y() * sensitivity;
 
     Clamp(&camera->pitch, -89.0f, 89.0f);
 
+    camera->target.x = cosf(camera->yaw * (PI / 180.0f)) * cosf(camera->pitch * (PI / 180.0f));
+    camera->target.y = sinf(camera->pitch * (PI / 180.0f));
+    camera->target.z = sinf(camera->yaw * (PI / 180.0f)) * cosf(camera->pitch * (PI / 180.0f));
+    camera->target = normalize_or_zero(camera->target);
+}
+
+void update_camera(Camera *camera, float dt) {
+    camera->previous_position = camera->position;
+
     float old_y = camera->position.y;
     float movement_speed = 12.5f;
 
     Vector3 world_up = make_vector3(0, 1, 0);
     Vector3 right = normalize_or_zero(cross_product(camera->target, world_up));
-    Vector3 up = normalize_or_zero(cross_product(right, camera->target));
 
-    camera->target = make_vector3(0, 0, 0);
-    camera->target.x = cosf(camera->yaw * (PI / 180.0f)) * cosf(camera->pitch * (PI / 180.0f));
-    camera->target.z = sinf(camera->yaw * (PI / 180.0f)) * cosf(camera->pitch * (PI / 180.0f));
-    Vector3 camera_target = normalize_or_zero(camera->target);
+    // Walking stays level whatever the pitch.
+    Vector3 forward = normalize_or_zero(make_vector3(camera->target.x, 0, camera->target.z));
 
-    if (is_key_down(KEY_W)) camera->position += camera_target * movement_speed * dt;
-    else if (is_key_down(KEY_S)) camera->position -= camera_target * movement_speed * dt;
+    if (is_key_down(KEY_W)) camera->position += forward * movement_speed * dt;
+    else if (is_key_down(KEY_S)) camera->position -= forward * movement_speed * dt;
 
     if (is_key_down(KEY_A)) camera->position -= right * movement_speed * dt;
     else if (is_key_down(KEY_D)) camera->position += right * movement_speed * dt;
 
     camera->position.y = old_y;
 
-    camera->target.y = sinf(camera->pitch * (PI / 180.0f));
-    camera->target = normalize_or_zero(camera->target);
-    
+    // The same jump the old per-frame step gave at 60 fps: 25 units per
+    // second up, 60 units per second squared down.
     if (is_key_down(KEY_SPACE)) {
         if (camera->is_on_ground) {
-            camera->jump_velocity = 25.0f * dt;
+            camera->jump_velocity = 25.0f;
             camera->is_on_ground = false;
         }
     }
     
-    camera->jump_velocity -= 1.0f * dt;
+    camera->jump_velocity -= 60.0f * dt;
 
-    camera->position.y += camera->jump_velocity;
+    camera->position.y += camera->jump_velocity * dt;
 
     Terrain *terrain = get_terrain_at(camera->position);
     float terrain_height = get_terrain_height_at(terrain, -camera->position.x, -camera->position.z);
@@ -64,3 +67,7 @@ void update_camera(Camera *camera) {
         camera->is_on_ground = true;
     }
 }
+
+Vector3 get_interpolated_camera_position(Camera *camera, float alpha) {
+    return lerp(camera->previous_position, camera->position, alpha);
+}
@@ -8,11 +8,21 @@ struct Camera {
     Vector3 target = make_vector3(0, 0, -1);
     Vector3 up = make_vector3(0, 1, 0);
     float pitch, yaw, roll;
-    float jump_velocity = 0.0f;
+    float jump_velocity = 0.0f; // Units per second.
     bool is_on_ground = true;
+
+    // Where the last simulation tick started, for drawing between ticks.
+    Vector3 previous_position = make_vector3(0, 0, 0);
 };
 
 Camera make_camera(Vector3 position, float pitch, float yaw, float roll);
-void update_camera(Camera *camera);
+
+// Mouse look, once per drawn frame so it never lags behind the mouse.
+void update_camera_look(Camera *camera);
+
+// Movement, jumping and gravity, once per simulation tick.
+void update_camera(Camera *camera, float dt);
+
+Vector3 get_interpolated_camera_position(Camera *camera, float alpha);
 
 #endif
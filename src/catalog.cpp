@@ -3,63 +3,261 @@
 #include "draw.h"
 #include "os.h"
 #include "array.h"
+#include "assets.h"
+#include "cooked_texture.h"
+#include "texture_streamer.h"
+#include "jobs.h"
+#include "memory_tags.h"
+#include "profiler.h"
+
+#include <stdio.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-static Array <Texture_Map *> loaded_textures;
+// Textures are decoded on the job workers and uploaded on the main thread.
+// Until then callers hold a TEXTURE_PENDING map, which the renderer binds as
+// white. Uploads are spread across frames by update_texture_loads.
+//
+// When texture_cooker has written a data/cooked version of a texture, that
+// is used instead: it is already block compressed with its mips built. Only
+// the header and the small mip tail are read here; the texture streamer
+// brings in finer levels once something draws it up close.
 
-Texture_Map *find_or_create_texture(char *short_name) {
-    for (int i = 0; i < loaded_textures.count; i++) {
-        Texture_Map *map = loaded_textures[i];
-        if (strings_match(map->short_name, short_name)) {
-            return map;
-        }
+struct Texture_Load_Job {
+    Texture_Map *map;
+    char *full_path;
+    Bitmap bitmap;
+
+    char *cooked_path;
+    s64 cooked_size;
+    Texture_Stream *stream;
+    u8 *stream_data; // The stream's tail levels.
+
+    Texture_Load_Job *next_finished;
+};
+
+const s64 DEFAULT_TEXTURE_UPLOAD_BUDGET_BYTES = 16 * 1024 * 1024;
+const f64 DEFAULT_TEXTURE_UPLOAD_BUDGET_SECONDS = 0.002;
+
+// Indexed by srgb: the same file loaded as color and as data is two textures.
+static Hash_Table <Atom, Texture_Map *> loaded_textures[2];
+
+static Job_Counter texture_load_counter;
+static Mutex *finished_texture_loads_mutex;
+static Texture_Load_Job *first_finished_texture_load;
+static Texture_Load_Job *last_finished_texture_load;
+
+static int num_pending_textures;
+static int num_failed_textures;
+
+static s64 texture_upload_budget_bytes = DEFAULT_TEXTURE_UPLOAD_BUDGET_BYTES;
+static f64 texture_upload_budget_seconds = DEFAULT_TEXTURE_UPLOAD_BUDGET_SECONDS;
+
+static void push_finished_texture_load(Texture_Load_Job *job) {
+    os_lock_mutex(finished_texture_loads_mutex);
+    if (last_finished_texture_load) {
+        last_finished_texture_load->next_finished = job;
+    } else {
+        first_finished_texture_load = job;
     }
-    
-    char *extensions[] = {
-        "png",
-        "jpg",
-        "bmp",
-    };
-    
-    char *full_path = nullptr;
-    for (int i = 0; i < ArrayCount(extensions); i++) {
-        full_path = mprintf("data/textures/%s.%s", short_name, extensions[i]);
-        if (os_file_exists(full_path)) {
-            break;
-        } else {
-            delete [] full_path;
-            full_path = nullptr;
-        }
+    last_finished_texture_load = job;
+    os_unlock_mutex(finished_texture_loads_mutex);
+}
+
+static bool load_cooked_texture(Texture_Load_Job *job) {
+    // The header and level table are all parse_cooked_texture looks at, so
+    // that's all that gets read; it still checks offsets against the real size.
+    u8 header_data[sizeof(Cooked_Texture_Header) + MAX_COOKED_TEXTURE_LEVELS * sizeof(Cooked_Texture_Level)];
+    s64 header_size = Min(job->cooked_size, (s64)sizeof(header_data));
+
+    Cooked_Texture cooked;
+    if (!os_read_file_range(job->cooked_path, 0, header_size, header_data) ||
+        !parse_cooked_texture(header_data, job->cooked_size, &cooked)) {
+        fprintf(stderr, "Cooked texture '%s' is invalid or out of date, falling back to '%s'.\n", job->cooked_path, job->full_path);
+        return false;
     }
 
-    if (!full_path) return nullptr;
-    
-    int width, height, channels;
-    stbi_set_flip_vertically_on_load(true);
-    u8 *data = stbi_load(full_path, &width, &height, &channels, 0);
+    bool cooked_srgb = (cooked.flags & COOKED_TEXTURE_SRGB) != 0;
+    if (cooked_srgb != job->map->srgb) {
+        fprintf(stderr, "Cooked texture '%s' has the wrong color space, falling back to '%s'.\n", job->cooked_path, job->full_path);
+        return false;
+    }
+
+    Texture_Stream *stream = create_texture_stream(job->map, job->cooked_path, &cooked);
+    u8 *data = read_texture_stream_levels(stream, stream->tail_level);
     if (!data) {
-        delete [] full_path;
-        return nullptr;
+        destroy_texture_stream(stream);
+        return false;
     }
-    defer { stbi_image_free(data); };
-    
-    Bitmap bitmap = {};
-    bitmap.width = width;
-    bitmap.height = height;
-
-    if (channels == 4) {
-        bitmap.format = TEXTURE_FORMAT_RGBA8;
-    } else if (channels == 3) {
-        bitmap.format = TEXTURE_FORMAT_RGB8;
+
+    job->stream = stream;
+    job->stream_data = data;
+    return true;
+}
+
+static void texture_load_job_proc(void *data, int worker_index) {
+    PROFILE_SCOPE("Load texture");
+
+    Texture_Load_Job *job = (Texture_Load_Job *)data;
+
+    if (job->cooked_path && load_cooked_texture(job)) {
+        push_finished_texture_load(job);
+        return;
+    }
+
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load_thread(true);
+    u8 *pixels = stbi_load(job->full_path, &width, &height, &channels, 0);
+
+    // Grey and grey-alpha images get expanded, the renderer only takes RGB(A).
+    if (pixels && channels != 3 && channels != 4) {
+        stbi_image_free(pixels);
+        pixels = stbi_load(job->full_path, &width, &height, &channels, 4);
+        channels = 4;
+    }
+
+    if (pixels) {
+        job->bitmap.width = width;
+        job->bitmap.height = height;
+        job->bitmap.channels = channels;
+        job->bitmap.format = (channels == 4) ? TEXTURE_FORMAT_RGBA8 : TEXTURE_FORMAT_RGB8;
+        job->bitmap.data = pixels;
+    }
+
+    push_finished_texture_load(job);
+}
+
+static Texture_Load_Job *pop_finished_texture_load() {
+    if (!finished_texture_loads_mutex) return nullptr;
+
+    os_lock_mutex(finished_texture_loads_mutex);
+    Texture_Load_Job *job = first_finished_texture_load;
+    if (job) {
+        first_finished_texture_load = job->next_finished;
+        if (!first_finished_texture_load) last_finished_texture_load = nullptr;
     }
+    os_unlock_mutex(finished_texture_loads_mutex);
+
+    return job;
+}
 
-    bitmap.data = data;
+static void finish_texture_load(Texture_Load_Job *job) {
+    Texture_Map *map = job->map;
+
+    if (job->stream) {
+        upload_texture_stream_levels(job->stream, job->stream->tail_level, job->stream_data);
+        register_texture_stream(job->stream);
+        map->load_state = TEXTURE_LOADED;
+        tagged_free(job->stream_data);
+    } else if (job->bitmap.data) {
+        init_texture(map, job->bitmap);
+        map->load_state = TEXTURE_LOADED;
+        stbi_image_free(job->bitmap.data);
+    } else {
+        fprintf(stderr, "Failed to decode texture '%s'\n", job->full_path);
+        map->load_state = TEXTURE_FAILED;
+        num_failed_textures++;
+    }
+
+    num_pending_textures--;
+
+    delete [] job->full_path;
+    delete [] job->cooked_path;
+    tagged_delete(job);
+}
+
+static Texture_Map *find_or_create_texture(Atom name, bool srgb) {
+    Hash_Table <Atom, Texture_Map *> *table = &loaded_textures[srgb ? 1 : 0];
+
+    Texture_Map **cached = table->get(name);
+    if (cached) return *cached;
     
-    Texture_Map *map = create_texture(bitmap);
-    map->full_path = full_path;
-    map->short_name = copy_string(short_name);
-    loaded_textures.add(map);
+    Asset_Entry *asset = find_asset(ASSET_TEXTURE, name);
+    if (!asset) return nullptr;
+
+    if (!finished_texture_loads_mutex) {
+        finished_texture_loads_mutex = os_create_mutex();
+    }
+
+    Texture_Map *map = new Texture_Map();
+    map->full_path = copy_string(asset->full_path);
+    map->short_name = name.string;
+    map->load_state = TEXTURE_PENDING;
+    map->srgb = srgb;
+    table->add(name, map);
+
+    Texture_Load_Job *job = TAGGED_NEW(MEMORY_TAG_TEXTURE, Texture_Load_Job);
+    job->map = map;
+    job->full_path = copy_string(asset->full_path);
+
+    // A cooked file older than its source is stale, decode the source instead.
+    Asset_Entry *cooked_asset = find_asset(ASSET_COOKED_TEXTURE, name);
+    if (cooked_asset && cooked_asset->modification_time >= asset->modification_time) {
+        job->cooked_path = copy_string(cooked_asset->full_path);
+        job->cooked_size = cooked_asset->size;
+    }
+
+    num_pending_textures++;
+    add_job(texture_load_job_proc, job, &texture_load_counter);
+
     return map;
 }
+
+void update_texture_loads() {
+    if (!num_pending_textures) return;
+
+    PROFILE_SCOPE("update_texture_loads");
+
+    f64 start_time = os_get_time();
+    s64 bytes_uploaded = 0;
+
+    // The first upload always goes through, or a texture bigger than the
+    // budget would never make it.
+    while (true) {
+        if (bytes_uploaded >= texture_upload_budget_bytes) break;
+        if (bytes_uploaded && os_get_time() - start_time >= texture_upload_budget_seconds) break;
+
+        Texture_Load_Job *job = pop_finished_texture_load();
+        if (!job) break;
+
+        Texture_Stream *stream = job->stream;
+        s64 bitmap_bytes = (s64)job->bitmap.width * job->bitmap.height * 4;
+        finish_texture_load(job);
+
+        bytes_uploaded += stream ? stream->resident_bytes : bitmap_bytes;
+    }
+}
+
+void wait_for_all_textures() {
+    wait_for_counter(&texture_load_counter);
+
+    while (Texture_Load_Job *job = pop_finished_texture_load()) {
+        finish_texture_load(job);
+    }
+}
+
+void set_texture_upload_budget(s64 bytes_per_frame, f64 seconds_per_frame) {
+    texture_upload_budget_bytes = bytes_per_frame;
+    texture_upload_budget_seconds = seconds_per_frame;
+}
+
+int get_num_pending_textures() {
+    return num_pending_textures;
+}
+
+int get_num_failed_textures() {
+    return num_failed_textures;
+}
+
+Texture_Map *find_or_create_texture(Atom name) {
+    return find_or_create_texture(name, true);
+}
+
+Texture_Map *find_or_create_texture(char *short_name) {
+    return find_or_create_texture(intern(short_name), true);
+}
+
+Texture_Map *find_or_create_data_texture(Atom name) {
+    return find_or_create_texture(name, false);
+}
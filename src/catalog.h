@@ -1,8 +1,24 @@
 #ifndef CATALOG_H
 #define CATALOG_H
 
+#include "atom.h"
+
 struct Texture_Map;
 
+Texture_Map *find_or_create_texture(Atom name);
 Texture_Map *find_or_create_texture(char *short_name);
 
+// For textures that hold data rather than colour (blend maps). They're
+// uploaded linear, so shaders see the same bytes the CPU reads from the image.
+Texture_Map *find_or_create_data_texture(Atom name);
+
+// Uploads decoded textures until this frame's byte or time budget runs out.
+void update_texture_loads();
+// For loading screens: blocks until every requested texture is on the GPU.
+void wait_for_all_textures();
+
+void set_texture_upload_budget(s64 bytes_per_frame, f64 seconds_per_frame);
+int get_num_pending_textures();
+int get_num_failed_textures();
+
 #endif
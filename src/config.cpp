@@ -24,6 +24,30 @@ Config load_config() {
             line = eat_spaces(line);
             result.render_scale = atof(line);
         }
+
+        if (starts_with(line, "simulation_rate")) {
+            line += get_string_length("simulation_rate");
+            line = eat_spaces(line);
+            result.simulation_rate = atof(line);
+        }
+
+        if (starts_with(line, "vsync")) {
+            line += get_string_length("vsync");
+            line = eat_spaces(line);
+            result.vsync = atoi(line) != 0;
+        }
+
+        if (starts_with(line, "frame_rate_limit")) {
+            line += get_string_length("frame_rate_limit");
+            line = eat_spaces(line);
+            result.frame_rate_limit = atof(line);
+        }
+
+        if (starts_with(line, "just_in_time_pacing")) {
+            line += get_string_length("just_in_time_pacing");
+            line = eat_spaces(line);
+            result.just_in_time_pacing = atoi(line) != 0;
+        }
     }
     
     return result;
@@ -41,4 +65,16 @@ void save_config() {
     
     extern float render_scale_to_draw; // From menu.cpp
     fprintf(file, "render_scale %f\n", render_scale_to_draw);
+
+    extern float simulation_rate; // From main.cpp
+    fprintf(file, "simulation_rate %f\n", simulation_rate);
+
+    extern bool vsync; // From main.cpp
+    fprintf(file, "vsync %d\n", vsync ? 1 : 0);
+
+    extern float frame_rate_limit; // From main.cpp
+    fprintf(file, "frame_rate_limit %f\n", frame_rate_limit);
+
+    extern bool just_in_time_pacing; // From main.cpp
+    fprintf(file, "just_in_time_pacing %d\n", just_in_time_pacing ? 1 : 0);
 }
@@ -3,9 +3,13 @@
 #define CONFIG_FILEPATH "settings.cfg"
 
 struct Config {
-    static const int VERSION = 1;
+    static const int VERSION = 3;
     
     float render_scale = 1.0f; // @v1
+    float simulation_rate = 60.0f; // @v2, ticks per second
+    bool vsync = true; // @v3
+    float frame_rate_limit = 0.0f; // @v3, zero for none
+    bool just_in_time_pacing = false; // @v3
 };
 
 Config load_config();
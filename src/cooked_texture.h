@@ -0,0 +1,88 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include "general.h"
+#include "bitmap.h"
+
+// Cooked textures are written by texture_cooker and read by the catalog.
+// Layout, little endian:
+//
+//     Cooked_Texture_Header
+//     Cooked_Texture_Level[num_levels]    largest level first
+//     level data                          each level at its offset from the start of the file
+//
+// Rows run bottom to top, the same way the loaders flip PNGs, so UVs don't
+// change between cooked and uncooked textures.
+
+const u32 COOKED_TEXTURE_MAGIC = 0x31585443; // "CTX1"
+const u32 COOKED_TEXTURE_VERSION = 1;
+const int MAX_COOKED_TEXTURE_LEVELS = 16;
+
+enum Cooked_Texture_Flags {
+    COOKED_TEXTURE_SRGB      = 0x1,
+    COOKED_TEXTURE_HAS_ALPHA = 0x2,
+};
+
+struct Cooked_Texture_Header {
+    u32 magic;
+    u32 version;
+    u32 format; // Texture_Format
+    u32 flags;
+    u32 width;
+    u32 height;
+    u32 num_levels;
+    u32 reserved;
+};
+
+struct Cooked_Texture_Level {
+    u32 width;
+    u32 height;
+    u64 offset;
+    u64 size;
+};
+
+// Points into the file data, nothing is copied.
+struct Cooked_Texture {
+    Texture_Format format;
+    u32 flags;
+    int width;
+    int height;
+
+    int num_levels;
+    Cooked_Texture_Level *levels;
+
+    u8 *file_data;
+    s64 file_size;
+};
+
+inline bool parse_cooked_texture(u8 *file_data, s64 file_size, Cooked_Texture *result) {
+    if (file_size < (s64)sizeof(Cooked_Texture_Header)) return false;
+
+    Cooked_Texture_Header *header = (Cooked_Texture_Header *)file_data;
+    if (header->magic != COOKED_TEXTURE_MAGIC) return false;
+    if (header->version != COOKED_TEXTURE_VERSION) return false;
+    if (!header->num_levels || header->num_levels > MAX_COOKED_TEXTURE_LEVELS) return false;
+
+    s64 levels_end = sizeof(Cooked_Texture_Header) + header->num_levels * sizeof(Cooked_Texture_Level);
+    if (file_size < levels_end) return false;
+
+    Cooked_Texture_Level *levels = (Cooked_Texture_Level *)(file_data + sizeof(Cooked_Texture_Header));
+    for (u32 i = 0; i < header->num_levels; i++) {
+        if (levels[i].offset + levels[i].size > (u64)file_size) return false;
+
+        s64 expected_size = get_texture_level_size((Texture_Format)header->format, levels[i].width, levels[i].height);
+        if ((s64)levels[i].size != expected_size) return false;
+    }
+
+    result->format = (Texture_Format)header->format;
+    result->flags = header->flags;
+    result->width = header->width;
+    result->height = header->height;
+    result->num_levels = header->num_levels;
+    result->levels = levels;
+    result->file_data = file_data;
+    result->file_size = file_size;
+    return true;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include "culling.h"
+
+#include "mesh.h"
+#include "os.h"
+
+#include <xmmintrin.h>
+
+static Culling_Stats stats;
+
+// Command lists can be recorded on several threads at once, and they all
+// count towards the same stats.
+static void add_to_stat(int *stat, int amount) {
+    os_atomic_add((volatile s32 *)stat, amount);
+}
+
+Bounds get_world_bounds(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
+    Matrix4 m = make_object_to_world_matrix(position, rotation, scale);
+
+    Vector3 center = (mesh->bounds_min + mesh->bounds_max) * 0.5f;
+    Vector3 extents = (mesh->bounds_max - mesh->bounds_min) * 0.5f;
+
+    // A transformed box is enclosed by the box around its center whose
+    // extents are the absolute matrix times the old extents.
+    Bounds result;
+    for (int i = 0; i < 3; i++) {
+        result.box_center.e[i] = m.e[i][0] * center.x + m.e[i][1] * center.y + m.e[i][2] * center.z + m.e[i][3];
+        result.box_extents.e[i] = fabsf(m.e[i][0]) * extents.x + fabsf(m.e[i][1]) * extents.y + fabsf(m.e[i][2]) * extents.z;
+
+        Vector3 c = mesh->bounding_center;
+        result.sphere_center.e[i] = m.e[i][0] * c.x + m.e[i][1] * c.y + m.e[i][2] * c.z + m.e[i][3];
+    }
+
+    result.sphere_radius = mesh->bounding_radius * fabsf(scale);
+    return result;
+}
+
+static Bounds merge_bounds(Bounds a, Bounds b) {
+    Bounds result;
+    for (int i = 0; i < 3; i++) {
+        f32 low = Min(a.box_center.e[i] - a.box_extents.e[i], b.box_center.e[i] - b.box_extents.e[i]);
+        f32 high = Max(a.box_center.e[i] + a.box_extents.e[i], b.box_center.e[i] + b.box_extents.e[i]);
+        result.box_center.e[i] = (low + high) * 0.5f;
+        result.box_extents.e[i] = (high - low) * 0.5f;
+    }
+
+    // The smallest sphere around both, unless one already holds the other.
+    Vector3 offset = b.sphere_center - a.sphere_center;
+    f32 distance = get_length(offset);
+    if (distance + b.sphere_radius <= a.sphere_radius) {
+        result.sphere_center = a.sphere_center;
+        result.sphere_radius = a.sphere_radius;
+    } else if (distance + a.sphere_radius <= b.sphere_radius) {
+        result.sphere_center = b.sphere_center;
+        result.sphere_radius = b.sphere_radius;
+    } else {
+        result.sphere_radius = (distance + a.sphere_radius + b.sphere_radius) * 0.5f;
+        result.sphere_center = a.sphere_center + offset * ((result.sphere_radius - a.sphere_radius) / distance);
+    }
+
+    return result;
+}
+
+// Encloses the mesh at 'position' whatever its rotation.
+static Bounds get_any_rotation_world_bounds(Mesh *mesh, Vector3 position, f32 scale) {
+    f32 radius = (get_length(mesh->bounding_center) + mesh->bounding_radius) * fabsf(scale);
+
+    Bounds result;
+    result.box_center = position;
+    result.box_extents = make_vector3(radius, radius, radius);
+    result.sphere_center = position;
+    result.sphere_radius = radius;
+    return result;
+}
+
+Bounds get_world_bounds_between(Mesh *mesh, Vector3 from_position, Vector3 from_rotation,
+                                Vector3 to_position, Vector3 to_rotation, f32 scale) {
+    // Moving in a straight line, the mesh stays inside the bounds at the two
+    // ends. Turning, it sweeps through places neither end covers.
+    bool turning = from_rotation.x != to_rotation.x || from_rotation.y != to_rotation.y || from_rotation.z != to_rotation.z;
+    if (turning) {
+        return merge_bounds(get_any_rotation_world_bounds(mesh, from_position, scale),
+                            get_any_rotation_world_bounds(mesh, to_position, scale));
+    }
+
+    return merge_bounds(get_world_bounds(mesh, from_position, from_rotation, scale),
+                        get_world_bounds(mesh, to_position, to_rotation, scale));
+}
+
+static Vector4 make_plane(f32 a, f32 b, f32 c, f32 d) {
+    f32 length = sqrtf(a*a + b*b + c*c);
+    if (length > 0.0f) {
+        f32 inverse = 1.0f / length;
+        a *= inverse;
+        b *= inverse;
+        c *= inverse;
+        d *= inverse;
+    }
+
+    return make_vector4(a, b, c, d);
+}
+
+Frustum make_frustum(Matrix4 m) {
+    // Clip space is -w <= x <= w, -w <= y <= w and 0 <= z <= w. With
+    // clip = m * p, each of those is a combination of two rows of m.
+    Frustum result;
+    result.planes[0] = make_plane(m._41 + m._11, m._42 + m._12, m._43 + m._13, m._44 + m._14); // Left
+    result.planes[1] = make_plane(m._41 - m._11, m._42 - m._12, m._43 - m._13, m._44 - m._14); // Right
+    result.planes[2] = make_plane(m._41 + m._21, m._42 + m._22, m._43 + m._23, m._44 + m._24); // Bottom
+    result.planes[3] = make_plane(m._41 - m._21, m._42 - m._22, m._43 - m._23, m._44 - m._24); // Top
+    result.planes[4] = make_plane(m._31, m._32, m._33, m._34);                                 // Near
+    result.planes[5] = make_plane(m._41 - m._31, m._42 - m._32, m._43 - m._33, m._44 - m._34); // Far
+    return result;
+}
+
+void begin_cull_batch(Cull_Batch *batch, int capacity, Arena *arena) {
+    batch->count = 0;
+    batch->capacity = (capacity + 3) & ~3;
+
+    // One block, ten arrays.
+    f32 *memory = (f32 *)arena_push(arena, (s64)batch->capacity * 10 * sizeof(f32));
+    for (int i = 0; i < 3; i++) {
+        batch->box_center[i]    = memory + (0 + i) * batch->capacity;
+        batch->box_extents[i]   = memory + (3 + i) * batch->capacity;
+        batch->sphere_center[i] = memory + (6 + i) * batch->capacity;
+    }
+    batch->sphere_radius = memory + 9 * batch->capacity;
+}
+
+int add_to_cull_batch(Cull_Batch *batch, Bounds bounds) {
+    assert(batch->count < batch->capacity);
+
+    int index = batch->count++;
+    for (int i = 0; i < 3; i++) {
+        batch->box_center[i][index] = bounds.box_center.e[i];
+        batch->box_extents[i][index] = bounds.box_extents.e[i];
+        batch->sphere_center[i][index] = bounds.sphere_center.e[i];
+    }
+    batch->sphere_radius[index] = bounds.sphere_radius;
+
+    return index;
+}
+
+int cull_batch(Frustum *frustum, Cull_Batch *batch, u8 *visible) {
+    // The lanes past the end of the last group of four get tested too; keep
+    // them finite. Batches are often filled far short of their capacity, so
+    // this is the only part cleared.
+    for (int i = batch->count; i < batch->capacity && (i & 3); i++) {
+        for (int c = 0; c < 3; c++) {
+            batch->box_center[c][i] = 0.0f;
+            batch->box_extents[c][i] = 0.0f;
+            batch->sphere_center[c][i] = 0.0f;
+        }
+        batch->sphere_radius[i] = 0.0f;
+    }
+
+    // Broadcast the planes once; the inner loop only does loads and math.
+    __m128 plane[6][4];
+    __m128 plane_abs[6][3];
+    for (int p = 0; p < 6; p++) {
+        for (int c = 0; c < 4; c++) {
+            plane[p][c] = _mm_set1_ps(frustum->planes[p].e[c]);
+        }
+        for (int c = 0; c < 3; c++) {
+            plane_abs[p][c] = _mm_set1_ps(fabsf(frustum->planes[p].e[c]));
+        }
+    }
+
+    int num_visible = 0;
+    for (int i = 0; i < batch->count; i += 4) {
+        __m128 box_x = _mm_loadu_ps(batch->box_center[0] + i);
+        __m128 box_y = _mm_loadu_ps(batch->box_center[1] + i);
+        __m128 box_z = _mm_loadu_ps(batch->box_center[2] + i);
+        __m128 extents_x = _mm_loadu_ps(batch->box_extents[0] + i);
+        __m128 extents_y = _mm_loadu_ps(batch->box_extents[1] + i);
+        __m128 extents_z = _mm_loadu_ps(batch->box_extents[2] + i);
+        __m128 sphere_x = _mm_loadu_ps(batch->sphere_center[0] + i);
+        __m128 sphere_y = _mm_loadu_ps(batch->sphere_center[1] + i);
+        __m128 sphere_z = _mm_loadu_ps(batch->sphere_center[2] + i);
+        __m128 radius = _mm_loadu_ps(batch->sphere_radius + i);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++) {
+            // Sphere: its center is further than the radius behind the plane.
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0], sphere_x), _mm_mul_ps(plane[p][1], sphere_y)),
+                                  _mm_add_ps(_mm_mul_ps(plane[p][2], sphere_z), plane[p][3]));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, radius), _mm_setzero_ps()));
+
+            // Box: even its corner furthest along the plane normal is behind.
+            __m128 box_d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0], box_x), _mm_mul_ps(plane[p][1], box_y)),
+                                      _mm_add_ps(_mm_mul_ps(plane[p][2], box_z), plane[p][3]));
+            __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_abs[p][0], extents_x), _mm_mul_ps(plane_abs[p][1], extents_y)),
+                                      _mm_mul_ps(plane_abs[p][2], extents_z));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(box_d, reach), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        int lanes = Min(4, batch->count - i);
+        for (int lane = 0; lane < lanes; lane++) {
+            u8 is_visible = (mask & (1 << lane)) ? 0 : 1;
+            visible[i + lane] = is_visible;
+            num_visible += is_visible;
+        }
+    }
+
+    add_culling_stats(num_visible, batch->count - num_visible);
+
+    return num_visible;
+}
+
+void reset_culling_stats() {
+    stats = {};
+}
+
+Culling_Stats get_culling_stats() {
+    return stats;
+}
+
+void add_culling_stats(int num_visible, int num_culled) {
+    add_to_stat(&stats.num_tested, num_visible + num_culled);
+    add_to_stat(&stats.num_visible, num_visible);
+    add_to_stat(&stats.num_culled, num_culled);
+}
+
+void add_occluded_stats(int num_occluded) {
+    add_to_stat(&stats.num_visible, -num_occluded);
+    add_to_stat(&stats.num_culled, num_occluded);
+    add_to_stat(&stats.num_occluded, num_occluded);
+}
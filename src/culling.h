@@ -0,0 +1,76 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "geometry.h"
+
+struct Mesh;
+struct Arena;
+
+// World space bounds of something drawn with a mesh. Both volumes enclose
+// it, so whichever one is entirely outside a plane is enough to cull. The
+// box is usually tighter for long thin meshes, the sphere for rotated ones.
+struct Bounds {
+    Vector3 box_center;
+    Vector3 box_extents;
+    Vector3 sphere_center;
+    f32 sphere_radius;
+};
+
+// Same transform as draw_mesh: scale, then rotation in degrees, then position.
+Bounds get_world_bounds(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale);
+
+// Encloses the mesh everywhere from one transform to the other, with position
+// and rotation blended linearly, the way interpolated entities are drawn.
+Bounds get_world_bounds_between(Mesh *mesh, Vector3 from_position, Vector3 from_rotation,
+                                Vector3 to_position, Vector3 to_rotation, f32 scale);
+
+// Planes face inwards and are normalized, so a point p is inside when
+// dot(plane.xyz, p) + plane.w >= 0 for all six.
+struct Frustum {
+    Vector4 planes[6];
+};
+
+// The volume D3D clips to after 'world_to_proj', so nothing is culled that
+// the GPU would have drawn.
+Frustum make_frustum(Matrix4 world_to_proj);
+
+// Bounds laid out one array per component, so the frustum test can take
+// four at a time. Arrays are padded to a multiple of four.
+struct Cull_Batch {
+    int count = 0;
+    int capacity = 0;
+
+    f32 *box_center[3];
+    f32 *box_extents[3];
+    f32 *sphere_center[3];
+    f32 *sphere_radius;
+};
+
+// The arrays come from 'arena' and live as long as it does.
+void begin_cull_batch(Cull_Batch *batch, int capacity, Arena *arena);
+int add_to_cull_batch(Cull_Batch *batch, Bounds bounds);
+
+// Sets visible[i] to 1 or 0 for every bounds in the batch and returns how
+// many are visible. Counts go towards this frame's stats.
+int cull_batch(Frustum *frustum, Cull_Batch *batch, u8 *visible);
+
+struct Culling_Stats {
+    int num_tested;
+    int num_visible;
+    int num_culled;
+    int num_occluded; // Passed the frustum test, then hidden; part of num_culled.
+};
+
+// Called at the start of a frame's drawing; stats read afterwards cover
+// every batch culled since. Counting is safe from any thread.
+void reset_culling_stats();
+Culling_Stats get_culling_stats();
+
+// For objects accepted or rejected as a group without going through
+// cull_batch, e.g. a whole octree node.
+void add_culling_stats(int num_visible, int num_culled);
+
+// For objects already counted visible that the occlusion test then rejected.
+void add_occluded_stats(int num_occluded);
+
+#endif
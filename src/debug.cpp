@@ -4,41 +4,109 @@
 #include "font.h"
 #include "os.h"
 #include "input.h"
+#include "memory_tags.h"
+#include "catalog.h"
+#include "texture_streamer.h"
+#include "culling.h"
+#include "profiler.h"
+#include "frame_timing.h"
+#include "frame_pacer.h"
 
-const f64 NUM_SECONDS_BETWEEN_UPDATES = 0.05;
-static f64 num_seconds_since_last_update;
-static int num_frames_since_last_update;
-static f64 accumulated_dt;
-static f64 dt_for_draw;
+const int FRAME_GRAPH_FRAMES = 256;
 
-void draw_debug_info() {
-    f64 dt = globals.time_info.real_world_dt;
-    
-    num_seconds_since_last_update += dt;
-    num_frames_since_last_update++;
-    if (num_seconds_since_last_update >= NUM_SECONDS_BETWEEN_UPDATES) {
-        num_seconds_since_last_update = 0;
-        
-        dt_for_draw = accumulated_dt / num_frames_since_last_update;
-        
-        accumulated_dt = 0.0;
-        num_frames_since_last_update = 0;
+// Newest frame on the right. Each bar stacks the phases from the bottom, with
+// whatever the phases don't cover on top, red for hitches.
+static void draw_frame_time_graph(Font *font, Frame_Time_Stats stats) {
+    Frame_Time frames[FRAME_GRAPH_FRAMES];
+    int num_frames = get_frame_times(frames, FRAME_GRAPH_FRAMES);
+    if (!num_frames) return;
+
+    f32 left = 0.02f * render_target_width;
+    f32 bottom = 0.02f * render_target_height;
+    f32 width = 0.3f * render_target_width;
+    f32 height = 0.15f * render_target_height;
+    f32 bar_width = width / FRAME_GRAPH_FRAMES;
+
+    // Keeps the 30 fps line on the graph, and room above p99 for spikes.
+    f64 top_seconds = Max(stats.p99 * 1.5, 1.0 / 25.0);
+    f32 pixels_per_second = (f32)(height / top_seconds);
+
+    Vector4 phase_colors[NUM_FRAME_PHASES] = {
+        make_vector4(0.3f, 0.8f, 0.3f, 1), // Simulate
+        make_vector4(0.3f, 0.5f, 0.9f, 1), // Draw
+        make_vector4(0.9f, 0.8f, 0.3f, 1), // Present
+        make_vector4(0.3f, 0.3f, 0.35f, 1), // Wait
+    };
+
+    set_shader(shader_color);
+    immediate_begin();
+
+    immediate_quad(make_vector2(left, bottom + height), make_vector2(left, bottom), make_vector2(left + width, bottom), make_vector2(left + width, bottom + height), make_vector4(0, 0, 0, 0.5f));
+
+    for (int i = 0; i < num_frames; i++) {
+        Frame_Time *frame = &frames[i];
+
+        f32 x0 = left + (FRAME_GRAPH_FRAMES - num_frames + i) * bar_width;
+        f32 x1 = x0 + Max(bar_width - 1.0f, 1.0f);
+        f32 y = bottom;
+        f32 y_max = bottom + height;
+
+        for (int phase = 0; phase < NUM_FRAME_PHASES; phase++) {
+            f32 y1 = Min(y + frame->phases[phase] * pixels_per_second, y_max);
+            immediate_quad(make_vector2(x0, y1), make_vector2(x0, y), make_vector2(x1, y), make_vector2(x1, y1), phase_colors[phase]);
+            y = y1;
+        }
+
+        f32 y1 = Min(bottom + frame->total * pixels_per_second, y_max);
+        if (y1 > y) {
+            Vector4 color = frame->is_hitch ? make_vector4(0.9f, 0.2f, 0.2f, 1) : make_vector4(0.6f, 0.6f, 0.6f, 1);
+            immediate_quad(make_vector2(x0, y1), make_vector2(x0, y), make_vector2(x1, y), make_vector2(x1, y1), color);
+        }
     }
-    accumulated_dt += globals.time_info.current_dt;
-    
+
+    f64 lines[] = { 1.0 / 60.0, 1.0 / 30.0, stats.p99 };
+    for (int i = 0; i < ArrayCount(lines); i++) {
+        f32 y = bottom + (f32)(lines[i] * pixels_per_second);
+        if (y > bottom + height) continue;
+
+        Vector4 color = (i == ArrayCount(lines) - 1) ? make_vector4(1, 0.4f, 0.4f, 1) : make_vector4(1, 1, 1, 0.6f);
+        immediate_quad(make_vector2(left, y + 1.0f), make_vector2(left, y), make_vector2(left + width, y), make_vector2(left + width, y + 1.0f), color);
+    }
+
+    immediate_flush();
+
+    char *text = tprint("p99 %.2f ms   60 / 30 fps lines   F4 writes frame_times.csv", stats.p99 * 1000.0);
+    draw_text(font, text, (int)left, (int)(bottom + height + 0.25f * font->character_height), make_vector4(1, 1, 1, 1));
+}
+
+void draw_debug_info() {
+    Frame_Time_Stats frame_stats = get_frame_time_stats();
+
     set_shader(shader_text);
     rendering_2d_right_handed();
     
     int font_size = (int) (0.02f * render_target_height);
-    Font *font = get_font_at_size("OpenSans-SemiBold.ttf", font_size);
+    Font *font = get_font_at_size(ATOM("OpenSans-SemiBold.ttf"), font_size);
 
     int y = render_target_height - font->character_height;
     int offset = font->character_height / 20;
     
     {
-        if (!dt_for_draw) dt_for_draw = 1.0;
-        char *text = mprintf("%.2lf fps", 1.0 / dt_for_draw);
-        defer { delete [] text; };
+        f64 fps = frame_stats.average ? 1.0 / frame_stats.average : 0.0;
+        char *text = tprint("Frame: %.2f ms avg (%.0f fps), p50 %.2f, p95 %.2f, p99 %.2f, max %.2f ms",
+                            frame_stats.average * 1000.0, fps, frame_stats.p50 * 1000.0, frame_stats.p95 * 1000.0,
+                            frame_stats.p99 * 1000.0, frame_stats.max * 1000.0);
+        
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));
+    }
+
+    y -= font->character_height;
+
+    {
+        char *text = tprint("Hitches: %d in the last %d frames, %lld total", frame_stats.num_hitches, frame_stats.num_frames, frame_stats.total_hitches);
         
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
@@ -51,8 +119,7 @@ void draw_debug_info() {
     {
         Time time = os_get_local_time();
         
-        char *text = mprintf("%02i:%02i:%02i", time.hour, time.minute, time.second);
-        defer { delete [] text; };
+        char *text = tprint("%02i:%02i:%02i", time.hour, time.minute, time.second);
         
         int x = render_target_width - get_string_width_in_pixels(font, text);
 
@@ -63,8 +130,18 @@ void draw_debug_info() {
     y -= font->character_height;
     
     {
-        char *text = mprintf("Mouse pointer delta: (%d, %d)", get_mouse_pointer_delta_x(), get_mouse_pointer_delta_y());
-        defer { delete [] text; };
+        char *text = tprint("Mouse pointer delta: (%d, %d)", get_mouse_pointer_delta_x(), get_mouse_pointer_delta_y());
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Current dt: %.2f", globals.time_info.current_dt);
 
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
@@ -75,8 +152,8 @@ void draw_debug_info() {
     y -= font->character_height;
     
     {
-        char *text = mprintf("Current dt: %.2f", globals.time_info.current_dt);
-        defer { delete [] text; };
+        char *text = tprint("Simulation: %d ticks of %.2f ms last frame, alpha %.2f", globals.simulation_ticks_last_frame,
+                            globals.time_info.simulation_dt * 1000.0f, globals.time_info.simulation_alpha);
 
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
@@ -87,9 +164,72 @@ void draw_debug_info() {
     y -= font->character_height;
     
     {
-        char *text = mprintf("Current time: %.2f", globals.time_info.current_time);
-        defer { delete [] text; };
+        Frame_Pacing_Stats pacing = get_frame_pacing_stats();
+
+        char *text;
+        if (pacing.target_interval) {
+            text = tprint("Pacing: %.2f ms target%s, jitter %.3f ms, late %.3f/%.3f ms, spin %.2f ms", pacing.target_interval * 1000.0,
+                          pacing.just_in_time ? " (just in time)" : "", pacing.interval_jitter * 1000.0,
+                          pacing.average_start_error * 1000.0, pacing.max_start_error * 1000.0, pacing.average_spin_time * 1000.0);
+        } else {
+            text = tprint("Pacing: unlimited, jitter %.3f ms", pacing.interval_jitter * 1000.0);
+        }
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Current time: %.2f", globals.time_info.current_time);
+        
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Real world dt: %.2f", globals.time_info.real_world_dt);
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Real world time: %.2f", globals.time_info.real_world_time);
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Ui dt: %.2f", globals.time_info.ui_dt);
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
         
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Ui time: %.2f", globals.time_info.ui_time);
+
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
         draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
@@ -99,8 +239,8 @@ void draw_debug_info() {
     y -= font->character_height;
     
     {
-        char *text = mprintf("Real world dt: %.2f", globals.time_info.real_world_dt);
-        defer { delete [] text; };
+        Font_Frame_Stats stats = get_font_frame_stats();
+        char *text = tprint("Glyphs rasterized: %d, uploaded: %lld bytes in %d batches", stats.glyphs_rasterized, stats.bytes_uploaded, stats.num_uploads);
 
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
@@ -111,36 +251,199 @@ void draw_debug_info() {
     y -= font->character_height;
     
     {
-        char *text = mprintf("Real world time: %.2f", globals.time_info.real_world_time);
-        defer { delete [] text; };
+        f64 megabytes = get_font_cache_size_in_bytes() / (1024.0 * 1024.0);
+        char *text = tprint("Font cache: %.1f MB in %d fonts", megabytes, get_num_cached_fonts());
 
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
         draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
         draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
     }
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Heap allocations last frame: %d", globals.heap_allocations_last_frame);
 
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
     y -= font->character_height;
     
     {
-        char *text = mprintf("Ui dt: %.2f", globals.time_info.ui_dt);
-        defer { delete [] text; };
+        s64 cpu_bytes = 0;
+        s64 gpu_bytes = 0;
+        for (int i = 0; i < NUM_MEMORY_TAGS; i++) {
+            Memory_Tag_Stats stats = get_memory_stats((Memory_Tag)i);
+            cpu_bytes += stats.live_bytes;
+            gpu_bytes += stats.gpu_bytes;
+        }
+        
+        char *text = tprint("Tracked memory: %.1f MB cpu, %.1f MB gpu", cpu_bytes / (1024.0 * 1024.0), gpu_bytes / (1024.0 * 1024.0));
 
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
         draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
         draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
     }
+    y -= font->character_height;
+    
+    {
+        char *text = tprint("Textures loading: %d, failed: %d", get_num_pending_textures(), get_num_failed_textures());
 
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
     y -= font->character_height;
     
     {
-        char *text = mprintf("Ui time: %.2f", globals.time_info.ui_time);
-        defer { delete [] text; };
+        Texture_Streaming_Stats stats = get_texture_streaming_stats();
+        char *text = tprint("Streaming: %.1f / %.1f MB, %d loading (%.1f MB), %d misses, %d evictions",
+                            stats.resident_bytes / (1024.0 * 1024.0), stats.budget / (1024.0 * 1024.0),
+                            stats.num_loads_in_flight, stats.pending_bytes / (1024.0 * 1024.0),
+                            stats.misses_last_frame, stats.evictions_last_frame);
 
         int x = render_target_width - get_string_width_in_pixels(font, text);
         
         draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
         draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
     }
+    y -= font->character_height;
+    
+    {
+        Culling_Stats stats = get_culling_stats();
+        char *text = tprint("Culling: %d visible, %d culled (%d occluded)", stats.num_visible, stats.num_culled, stats.num_occluded);
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+    y -= font->character_height;
+
+    {
+        Light_Clustering_Stats stats = get_light_clustering_stats();
+        char *text = tprint("Lights: %d of %d binned, %d cluster entries, at most %d per cluster", stats.num_lights_binned, stats.num_lights, stats.num_light_indices, stats.max_lights_in_cluster);
+
+        int x = render_target_width - get_string_width_in_pixels(font, text);
+        
+        draw_text(font, text, x + offset, y - offset, make_vector4(0, 0, 0, 1));
+        draw_text(font, text, x, y, make_vector4(1, 1, 1, 1));        
+    }
+
+    draw_frame_time_graph(font, frame_stats);
+}
+
+#ifdef PROFILER_ENABLED
+
+const int MAX_PROFILER_VIEW_EVENTS = 4096;
+
+static bool profiler_view_visible;
+
+void toggle_profiler_view() {
+    profiler_view_visible = !profiler_view_visible;
+}
+
+// Hashes the name, so a scope keeps its color from one frame to the next.
+static Vector4 get_profile_scope_color(char *name) {
+    u32 hash = 2166136261u;
+    for (char *at = name; *at; at++) {
+        hash = (hash ^ (u8)*at) * 16777619u;
+    }
+
+    f32 r = 0.3f + 0.5f * ((hash >> 0) & 0xff) / 255.0f;
+    f32 g = 0.3f + 0.5f * ((hash >> 8) & 0xff) / 255.0f;
+    f32 b = 0.3f + 0.5f * ((hash >> 16) & 0xff) / 255.0f;
+    return make_vector4(r, g, b, 0.9f);
+}
+
+void draw_profiler_view() {
+    if (!profiler_view_visible) return;
+
+    u64 frame_start, frame_end;
+    if (!get_last_profile_frame(&frame_start, &frame_end)) return;
+
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    Profile_Event *events = (Profile_Event *)arena_push(&frame_arena, MAX_PROFILER_VIEW_EVENTS * sizeof(Profile_Event));
+
+    rendering_2d_right_handed();
+
+    int font_size = (int) (0.016f * render_target_height);
+    Font *font = get_font_at_size(ATOM("OpenSans-SemiBold.ttf"), font_size);
+
+    f32 left = 0.02f * render_target_width;
+    f32 width = 0.96f * render_target_width;
+    f32 row_height = font->character_height * 1.25f;
+    f32 y = 0.5f * render_target_height;
+
+    f64 frame_ticks = (f64)(frame_end - frame_start);
+
+    {
+        char *text = tprint("Last frame: %.2f ms   (F2 hides, F3 writes profile_trace.json)", get_profile_seconds(frame_end - frame_start) * 1000.0);
+        draw_text(font, text, (int)left, (int)y, make_vector4(1, 1, 1, 1));
+        y -= row_height;
+    }
+
+    int main_thread_index = get_num_job_workers();
+    for (int thread_index = 0; thread_index < MAX_PROFILE_THREADS; thread_index++) {
+        int num_events = get_profile_events(thread_index, frame_start, frame_end, events, MAX_PROFILER_VIEW_EVENTS);
+        if (!num_events) continue;
+
+        char *lane_name = "Main thread";
+        if (thread_index != main_thread_index) lane_name = tprint("Worker %d", thread_index);
+        draw_text(font, lane_name, (int)left, (int)y, make_vector4(0.8f, 0.8f, 0.8f, 1));
+        y -= row_height * 0.25f;
+
+        int max_depth = 0;
+        for (int i = 0; i < num_events; i++) {
+            max_depth = Max(max_depth, events[i].depth);
+        }
+
+        set_shader(shader_color);
+        immediate_begin();
+
+        for (int i = 0; i < num_events; i++) {
+            Profile_Event *event = &events[i];
+
+            u64 start = Max(event->start, frame_start);
+            u64 end = Min(event->end, frame_end);
+
+            f32 x0 = left + (f32)((start - frame_start) / frame_ticks) * width;
+            f32 x1 = left + (f32)((end - frame_start) / frame_ticks) * width;
+            x1 = Max(x1, x0 + 1.0f);
+
+            f32 y1 = y - event->depth * row_height;
+            f32 y0 = y1 - row_height + 1.0f;
+
+            immediate_quad(make_vector2(x0, y1), make_vector2(x0, y0), make_vector2(x1, y0), make_vector2(x1, y1), get_profile_scope_color(event->name));
+        }
+
+        immediate_flush();
+
+        // Labels only where they fit inside their bar.
+        for (int i = 0; i < num_events; i++) {
+            Profile_Event *event = &events[i];
+
+            u64 start = Max(event->start, frame_start);
+            u64 end = Min(event->end, frame_end);
+
+            f32 x0 = left + (f32)((start - frame_start) / frame_ticks) * width;
+            f32 x1 = left + (f32)((end - frame_start) / frame_ticks) * width;
+
+            char *text = tprint("%s %.2f ms", event->name, get_profile_seconds(event->end - event->start) * 1000.0);
+            if (get_string_width_in_pixels(font, text) > x1 - x0 - 4.0f) continue;
+
+            f32 text_y = y - (event->depth + 1) * row_height + 0.3f * row_height;
+            draw_text(font, text, (int)(x0 + 2.0f), (int)text_y, make_vector4(0, 0, 0, 1));
+        }
+
+        y -= (max_depth + 1) * row_height + row_height;
+    }
 }
+
+#endif
@@ -1,6 +1,15 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include "profiler.h"
+
 void draw_debug_info();
 
+#ifdef PROFILER_ENABLED
+// F2 in game. The last whole frame as a timeline, one lane per thread, with
+// nested scopes stacked under the scope that contains them.
+void toggle_profiler_view();
+void draw_profiler_view();
+#endif
+
 #endif
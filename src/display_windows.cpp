@@ -21,6 +21,9 @@ extern Key_Info key_infos[NUM_KEYS];
 
 static Key win32_vk_code_to_key(u32 vk_code) {
     switch (vk_code) {
+    case VK_F2: return KEY_F2;
+    case VK_F3: return KEY_F3;
+    case VK_F4: return KEY_F4;
     case VK_F11: return KEY_F11;
     case VK_ESCAPE: return KEY_ESCAPE;
     case VK_RETURN: return KEY_ENTER;
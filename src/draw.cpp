@@ -5,8 +5,14 @@
 #include "os.h"
 #include "catalog.h"
 #include "entities.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "lighting.h"
+#include "jobs.h"
+#include "memory_tags.h"
+#include "profiler.h"
 
-#ifdef DEBUG
+#if defined(DEBUG) || defined(PROFILER_ENABLED)
 #include "debug.h"
 #endif
 
@@ -18,6 +24,8 @@ Shader *shader_msaa_4x;
 Shader *shader_msaa_8x;
 Shader *shader_text;
 Shader *shader_terrain;
+Shader *shader_terrain_one_layer;
+Shader *shader_terrain_two_layers;
 
 Camera camera;
 
@@ -49,6 +57,18 @@ void draw_text(Font *font, char *text, int x, int y, Vector4 color) {
 
     set_shader(shader_text);
 
+    // Rasterize anything new up front so the atlas gets one batched upload
+    // before any quad referencing it is submitted.
+    for (char *at = text; *at;) {
+        int codepoint_byte_count = 0;
+        int codepoint = get_codepoint(at, &codepoint_byte_count);
+        get_or_load_glyph(font, codepoint);
+        
+        if (codepoint == 0x3f) codepoint_byte_count = 1;
+        at += codepoint_byte_count;
+    }
+    flush_font_uploads();
+
     immediate_begin();
 
     for (char *at = text; *at;) {
@@ -83,30 +103,134 @@ void draw_text(Font *font, char *text, int x, int y, Vector4 color) {
 }
 
 void draw_game_view() {
+    PROFILE_SCOPE("draw_game_view");
+
     clear_render_target(0.2f, 0.5f, 0.8f, 1.0f);
 
     draw_game_3d();
     draw_game_2d();
 }
 
+static Light_Clusters light_clusters;
+
+Light_Clustering_Stats get_light_clustering_stats() {
+    return light_clusters.stats;
+}
+
+static void update_light_clusters() {
+    PROFILE_SCOPE("update_light_clusters");
+
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    Entity_Manager *manager = get_entity_manager();
+    int num_lights = manager->lights.count;
+
+    Point_Light *lights = (Point_Light *)arena_push(&frame_arena, num_lights * sizeof(Point_Light));
+    for (int i = 0; i < num_lights; i++) {
+        Light *light = manager->lights[i];
+
+        Point_Light *point = &lights[i];
+        *point = {};
+        point->position = light->position;
+        point->radius = get_point_light_radius(light->color, light->attenutation);
+        point->color = light->color;
+        point->attenuation = light->attenutation;
+    }
+
+    build_light_clusters(&light_clusters, lights, num_lights, world_to_view_matrix, view_to_proj_matrix, render_target_width, render_target_height);
+    set_light_clusters(&light_clusters);
+}
+
+static Command_List terrain_commands;
+static Command_List entity_commands;
+
+struct Terrain_Recording {
+    Frustum *frustum;
+    Command_List *list;
+};
+
+static void record_terrains_job_proc(void *data, int worker_index) {
+    Terrain_Recording *recording = (Terrain_Recording *)data;
+
+    begin_command_list(recording->list);
+    record_terrains(recording->frustum, recording->list);
+}
+
 static void draw_game_3d() {
     f32 aspect_ratio = (f32)render_target_width / (f32)render_target_height;
     view_to_proj_matrix = make_perspective_projection(aspect_ratio, 70.0f * (PI / 180.0f), 0.1f, 1000.0f);
-    world_to_view_matrix = make_look_at_matrix(camera.position, camera.position + camera.target, camera.up);
+    // The simulation runs in fixed ticks; what's drawn is blended between the
+    // last two so motion stays smooth at any frame rate.
+    f32 alpha = globals.time_info.simulation_alpha;
+
+    Vector3 eye = get_interpolated_camera_position(&camera, alpha);
+    world_to_view_matrix = make_look_at_matrix(eye, eye + camera.target, camera.up);
     refresh_transform();
 
-    draw_terrains();
-    
-    set_shader(shader_basic_3d);
+    reset_culling_stats();
+    update_light_clusters();
+
+    // Occluders go in first, so terrain chunks and entities alike can be
+    // tested against them before they're submitted.
+    Matrix4 world_to_proj = view_to_proj_matrix * world_to_view_matrix;
+    Frustum frustum = make_frustum(world_to_proj);
 
     {
+        PROFILE_SCOPE("Rasterize occluders");
+
+        begin_occlusion_frame(world_to_proj);
+        add_terrain_occluders();
+        rasterize_occluders();
+    }
+
+    // Terrain records on a worker while the entities record here; the octree
+    // query uses frame_arena, which is main thread only. Replaying the lists
+    // in a fixed order keeps the frame the same whichever finishes first.
+    Terrain_Recording terrain_recording;
+    terrain_recording.frustum = &frustum;
+    terrain_recording.list = &terrain_commands;
+
+    Job_Counter counter;
+    add_job(record_terrains_job_proc, &terrain_recording, &counter, JOB_PRIORITY_FRAME);
+
+    begin_command_list(&entity_commands);
+    record_set_shader(&entity_commands, shader_basic_3d);
+
+    {
+        PROFILE_SCOPE("Record entities");
+
+        Arena_Mark mark = get_arena_mark(&frame_arena);
+        defer { rewind_arena(&frame_arena, mark); };
+
         Entity_Manager *manager = get_entity_manager();
-        
-        Guy *guy = manager->guy;
-        
-        set_diffuse_texture(guy->mesh->map);
-        draw_mesh(guy->mesh, guy->position, guy->rotation, guy->scale);
+
+        // Everything visible is found before anything is recorded.
+        Array <Entity *> visible(make_arena_allocator(&frame_arena));
+        query_octree_frustum(&manager->octree, &frustum, &visible);
+
+        int num_occluded = 0;
+        for (int i = 0; i < visible.count; i++) {
+            Entity *entity = visible[i];
+            if (is_box_occluded(entity->bounds.box_center, entity->bounds.box_extents)) {
+                num_occluded++;
+                continue;
+            }
+
+            record_set_diffuse_texture(&entity_commands, entity->mesh->map);
+            record_draw_mesh(&entity_commands, entity->mesh, get_interpolated_position(entity, alpha), get_interpolated_rotation(entity, alpha), entity->scale);
+        }
+
+        add_occluded_stats(num_occluded);
     }
+
+    {
+        PROFILE_SCOPE("Wait for terrain recording");
+        wait_for_counter(&counter);
+    }
+
+    Command_List *lists[] = { &terrain_commands, &entity_commands };
+    submit_command_lists(lists, ArrayCount(lists));
 }
 
 static void draw_game_2d() {
@@ -119,7 +243,7 @@ static void draw_game_2d() {
         
         const f32 BIG_FONT_SIZE = 0.0725f;
         int font_size = static_cast <int>((BIG_FONT_SIZE * 1.4f) * render_target_height);
-        Font *big_font = get_font_at_size("Inconsolata-Regular.ttf", font_size);
+        Font *big_font = get_font_at_size(ATOM("Inconsolata-Regular.ttf"), font_size);
         
         char *text = ".";
         int x = render_target_width / 2;
@@ -131,4 +255,8 @@ static void draw_game_2d() {
 #ifdef _DEBUG
     draw_debug_info();
 #endif
+
+#ifdef PROFILER_ENABLED
+    draw_profiler_view();
+#endif
 }
@@ -5,6 +5,16 @@
 #include "bitmap.h"
 #include "camera.h"
 #include "terrain.h"
+#include "lighting.h"
+#include "array.h"
+
+enum Texture_Load_State {
+    TEXTURE_LOADED,
+    TEXTURE_PENDING, // Decoding or waiting for upload; binds as white until then.
+    TEXTURE_FAILED,
+};
+
+struct Texture_Stream;
 
 struct Texture_Map {
     char *full_path;
@@ -14,6 +24,18 @@ struct Texture_Map {
     int height = 0;
 
     Texture_Format format;
+    Texture_Load_State load_state = TEXTURE_LOADED;
+    int num_levels = 1;
+
+    // False for textures that hold data rather than colour, like blend maps:
+    // they're uploaded UNORM, so shaders sample the bytes as stored.
+    bool srgb = true;
+
+    // Set for cooked textures, which only keep the mips they need resident.
+    Texture_Stream *stream = nullptr;
+
+    // Estimated, for memory accounting. See track_gpu_memory.
+    s64 gpu_size_in_bytes = 0;
 
 #ifdef RENDER_D3D11
     void *texture = nullptr;
@@ -22,6 +44,13 @@ struct Texture_Map {
 #endif
 };
 
+// One level of a prebuilt mip chain, largest first.
+struct Texture_Level {
+    int width;
+    int height;
+    u8 *data;
+};
+
 struct Shader;
 
 struct Mesh;
@@ -50,6 +79,8 @@ extern Shader *shader_msaa_4x;
 extern Shader *shader_msaa_8x;
 extern Shader *shader_text;
 extern Shader *shader_terrain;
+extern Shader *shader_terrain_one_layer;
+extern Shader *shader_terrain_two_layers;
 
 extern Camera camera;
 
@@ -75,14 +106,36 @@ Texture_Map *create_texture_rendertarget(int width, int height, bool multisample
 Texture_Map *create_texture_depthtarget(Texture_Map *render_target);
 
 Texture_Map *create_texture(Bitmap bitmap);
-void update_texture(Texture_Map *map, int x, int y, int width, int height, u8 *data);
+// Creates the GPU texture for a map that already exists, e.g. a placeholder
+// handed out before its pixels were decoded.
+void init_texture(Texture_Map *map, Bitmap bitmap);
+// Uploads a complete mip chain as is, e.g. block compressed levels from a
+// cooked texture. RGB8 is not accepted here. Calling it again on the same map
+// replaces the GPU texture, which is how streamed textures gain levels.
+void init_texture_with_levels(Texture_Map *map, Texture_Format format, bool srgb, int num_levels, Texture_Level *levels);
+// Frees the finest levels of a texture by copying the rest into a smaller
+// one on the GPU.
+void drop_texture_levels(Texture_Map *map, int num_levels_to_drop);
+// A Texture2DArray with one slice per bitmap. They all have to be the same
+// size; mips are built the same way init_texture builds them.
+Texture_Map *create_texture_array(int num_layers, Bitmap *layers);
+void destroy_texture(Texture_Map *map);
+void update_texture(Texture_Map *map, int x, int y, int width, int height, u8 *data, int pitch = 0);
 
 void set_render_target(Texture_Map *map);
 void set_depth_target(Texture_Map *map);
 
 void set_shader(Shader *shader);
 void set_diffuse_texture(Texture_Map *map);
-void set_terrain_textures(Terrain_Texture_Pack pack);
+void set_terrain_textures(Terrain_Texture_Pack pack, Texture_Map *blend_map);
+// Which array slices the one and two layer terrain shaders sample.
+void set_terrain_chunk_layers(int layer_a, int layer_b);
+
+// Uploads this frame's binned point lights for the 3D shaders.
+void set_light_clusters(Light_Clusters *clusters);
+
+// As of the last draw_game_view.
+Light_Clustering_Stats get_light_clustering_stats();
 
 void refresh_transform();
 void rendering_2d_right_handed();
@@ -93,6 +146,82 @@ void clear_scissor();
 void draw_text(struct Font *font, char *text, int x, int y, Vector4 color);
 
 void draw_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale);
+// draw_mesh in two steps, for drawing parts of one mesh with different state
+// in between.
+void bind_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale);
+void draw_mesh_indices(u32 first_index, u32 num_indices);
+
+//
+// Command lists. Any thread can record into its own list; nothing reaches the
+// backend until submit_command_lists replays them on the main thread, in the
+// order given, so the frame comes out the same whichever recording finished
+// first. Lists keep their memory from one frame to the next, so keep them
+// around and begin them again rather than making new ones.
+//
+
+enum Draw_Command_Type {
+    DRAW_COMMAND_SET_SHADER,
+    DRAW_COMMAND_SET_DIFFUSE_TEXTURE,
+    DRAW_COMMAND_SET_TERRAIN_TEXTURES,
+    DRAW_COMMAND_SET_TERRAIN_CHUNK_LAYERS,
+    DRAW_COMMAND_BIND_MESH,
+    DRAW_COMMAND_DRAW_MESH_INDICES,
+};
+
+// Each one replays as the call of the same name above.
+struct Draw_Command {
+    Draw_Command_Type type;
+
+    union {
+        Shader *shader;
+        Texture_Map *map;
+
+        struct {
+            Terrain_Texture_Pack pack;
+            Texture_Map *blend_map;
+        } terrain_textures;
+
+        struct {
+            int layer_a;
+            int layer_b;
+        } terrain_chunk_layers;
+
+        struct {
+            Mesh *mesh;
+            Vector3 position;
+            Vector3 rotation;
+            f32 scale;
+        } bind_mesh;
+
+        struct {
+            u32 first_index;
+            u32 num_indices;
+        } draw_mesh_indices;
+    };
+};
+
+const s64 COMMAND_LIST_ARENA_SIZE = 256 * 1024;
+
+struct Command_List {
+    Array <Draw_Command> commands;
+
+    // Scratch for whoever records the list, good until it's begun again.
+    // frame_arena is main thread only, so workers use this instead.
+    Arena arena;
+};
+
+void begin_command_list(Command_List *list);
+
+void record_set_shader(Command_List *list, Shader *shader);
+void record_set_diffuse_texture(Command_List *list, Texture_Map *map);
+void record_set_terrain_textures(Command_List *list, Terrain_Texture_Pack pack, Texture_Map *blend_map);
+void record_set_terrain_chunk_layers(Command_List *list, int layer_a, int layer_b);
+void record_bind_mesh(Command_List *list, Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale);
+void record_draw_mesh_indices(Command_List *list, u32 first_index, u32 num_indices);
+void record_draw_mesh(Command_List *list, Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale);
+
+// Main thread only, after every recording into these lists has finished.
+void submit_command_lists(Command_List **lists, int num_lists);
 
 void draw_game_view();
 
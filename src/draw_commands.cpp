@@ -0,0 +1,105 @@
+// Command list recording and replay, kept apart from the rest of draw.cpp so
+// it builds against any backend without the scene code.
+
+#include "draw.h"
+
+#include "mesh.h"
+#include "memory_tags.h"
+#include "profiler.h"
+
+void begin_command_list(Command_List *list) {
+    if (!list->arena.memory) {
+        list->commands.allocator = make_tagged_allocator(MEMORY_TAG_GENERAL);
+        init_arena(&list->arena, COMMAND_LIST_ARENA_SIZE);
+    }
+
+    list->commands.reset();
+    reset_arena(&list->arena);
+}
+
+static Draw_Command *add_command(Command_List *list, Draw_Command_Type type) {
+    Draw_Command command;
+    command.type = type;
+    list->commands.add(command);
+
+    return &list->commands[list->commands.count - 1];
+}
+
+void record_set_shader(Command_List *list, Shader *shader) {
+    Draw_Command *command = add_command(list, DRAW_COMMAND_SET_SHADER);
+    command->shader = shader;
+}
+
+void record_set_diffuse_texture(Command_List *list, Texture_Map *map) {
+    Draw_Command *command = add_command(list, DRAW_COMMAND_SET_DIFFUSE_TEXTURE);
+    command->map = map;
+}
+
+void record_set_terrain_textures(Command_List *list, Terrain_Texture_Pack pack, Texture_Map *blend_map) {
+    Draw_Command *command = add_command(list, DRAW_COMMAND_SET_TERRAIN_TEXTURES);
+    command->terrain_textures.pack = pack;
+    command->terrain_textures.blend_map = blend_map;
+}
+
+void record_set_terrain_chunk_layers(Command_List *list, int layer_a, int layer_b) {
+    Draw_Command *command = add_command(list, DRAW_COMMAND_SET_TERRAIN_CHUNK_LAYERS);
+    command->terrain_chunk_layers.layer_a = layer_a;
+    command->terrain_chunk_layers.layer_b = layer_b;
+}
+
+void record_bind_mesh(Command_List *list, Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
+    Draw_Command *command = add_command(list, DRAW_COMMAND_BIND_MESH);
+    command->bind_mesh.mesh = mesh;
+    command->bind_mesh.position = position;
+    command->bind_mesh.rotation = rotation;
+    command->bind_mesh.scale = scale;
+}
+
+void record_draw_mesh_indices(Command_List *list, u32 first_index, u32 num_indices) {
+    Draw_Command *command = add_command(list, DRAW_COMMAND_DRAW_MESH_INDICES);
+    command->draw_mesh_indices.first_index = first_index;
+    command->draw_mesh_indices.num_indices = num_indices;
+}
+
+void record_draw_mesh(Command_List *list, Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
+    record_bind_mesh(list, mesh, position, rotation, scale);
+    record_draw_mesh_indices(list, 0, mesh->vertex_count);
+}
+
+void submit_command_lists(Command_List **lists, int num_lists) {
+    PROFILE_SCOPE("submit_command_lists");
+
+    for (int i = 0; i < num_lists; i++) {
+        Command_List *list = lists[i];
+
+        for (int j = 0; j < list->commands.count; j++) {
+            Draw_Command *command = &list->commands[j];
+
+            switch (command->type) {
+            case DRAW_COMMAND_SET_SHADER:
+                set_shader(command->shader);
+                break;
+
+            case DRAW_COMMAND_SET_DIFFUSE_TEXTURE:
+                set_diffuse_texture(command->map);
+                break;
+
+            case DRAW_COMMAND_SET_TERRAIN_TEXTURES:
+                set_terrain_textures(command->terrain_textures.pack, command->terrain_textures.blend_map);
+                break;
+
+            case DRAW_COMMAND_SET_TERRAIN_CHUNK_LAYERS:
+                set_terrain_chunk_layers(command->terrain_chunk_layers.layer_a, command->terrain_chunk_layers.layer_b);
+                break;
+
+            case DRAW_COMMAND_BIND_MESH:
+                bind_mesh(command->bind_mesh.mesh, command->bind_mesh.position, command->bind_mesh.rotation, command->bind_mesh.scale);
+                break;
+
+            case DRAW_COMMAND_DRAW_MESH_INDICES:
+                draw_mesh_indices(command->draw_mesh_indices.first_index, command->draw_mesh_indices.num_indices);
+                break;
+            }
+        }
+    }
+}
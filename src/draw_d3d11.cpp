@@ -6,6 +6,11 @@
 #include "mesh.h"
 #include "draw.h"
 #include "os.h"
+#include "memory_tags.h"
+#include "mipmap.h"
+#include "pixel_convert.h"
+#include "texture_streamer.h"
+#include "lighting.h"
 
 #include <d3d11_1.h>
 #include <string.h>
@@ -26,6 +31,10 @@
 #include "compiled/text_ps.h"
 #include "compiled/terrain_vs.h"
 #include "compiled/terrain_ps.h"
+#include "compiled/terrain_one_layer_vs.h"
+#include "compiled/terrain_one_layer_ps.h"
+#include "compiled/terrain_two_layers_vs.h"
+#include "compiled/terrain_two_layers_ps.h"
 
 #define SafeRelease(ptr) do { if (ptr) { ptr->Release(); ptr = nullptr; } } while (false)
 
@@ -70,6 +79,12 @@ static Texture_Map *current_diffuse_map;
 static Texture_Map *current_render_target;
 static Texture_Map *current_depth_target;
 
+// What draw_mesh reports to the texture streamer. Terrain textures repeat
+// TERRAIN_TEXTURE_TILING times across the mesh, everything else once.
+static Texture_Map *textures_for_streaming[4];
+static int num_textures_for_streaming;
+static f32 texture_tiling_for_streaming = 1.0f;
+
 static bool should_vsync;
 bool multisampling;
 int num_samples;
@@ -99,6 +114,15 @@ static ID3D11SamplerState *sampler_point_clamp;
 static ID3D11SamplerState *sampler_linear_clamp;
 
 static ID3D11Buffer *transform_cbo;
+static ID3D11Buffer *terrain_chunk_cbo;
+static int current_terrain_chunk_layers[2] = { -1, -1 };
+
+// Clustered lighting, see set_light_clusters.
+static ID3D11Buffer *lighting_cbo;
+static ID3D11Buffer *point_light_buffer;
+static ID3D11Buffer *light_cluster_buffer;
+static ID3D11Buffer *light_index_buffer;
+static ID3D11ShaderResourceView *light_srvs[3];
 
 static ID3D11InputLayout *mesh_input_layout;
 static ID3D11InputLayout *immediate_input_layout;
@@ -162,6 +186,9 @@ static void destroy_offscreen_buffer() {
         the_offscreen_buffer->srv = nullptr;
     }
 
+    track_gpu_memory(MEMORY_TAG_RENDER_TARGET, -the_offscreen_buffer->gpu_size_in_bytes);
+    track_gpu_memory(MEMORY_TAG_RENDER_TARGET, -the_offscreen_depth_buffer->gpu_size_in_bytes);
+
     delete the_offscreen_buffer;
     delete the_offscreen_depth_buffer;
 }
@@ -395,6 +422,49 @@ void init_draw(bool vsync, bool multisample, int sample_count) {
 
     device->CreateBuffer(&transform_cbo_bd, nullptr, &transform_cbo);
 
+    D3D11_BUFFER_DESC terrain_chunk_cbo_bd = transform_cbo_bd;
+    terrain_chunk_cbo_bd.ByteWidth = 4 * sizeof(u32);
+
+    device->CreateBuffer(&terrain_chunk_cbo_bd, nullptr, &terrain_chunk_cbo);
+
+    D3D11_BUFFER_DESC lighting_cbo_bd = transform_cbo_bd;
+    lighting_cbo_bd.ByteWidth = sizeof(Light_Cluster_Constants);
+
+    device->CreateBuffer(&lighting_cbo_bd, nullptr, &lighting_cbo);
+
+    {
+        // Sized for the most the binning can produce, and rewritten every
+        // frame, so they're created once here.
+        struct {
+            ID3D11Buffer **buffer;
+            DXGI_FORMAT format;
+            u32 element_size;
+            u32 num_elements;
+        } buffers[] = {
+            { &point_light_buffer,   DXGI_FORMAT_R32G32B32A32_FLOAT, 4 * sizeof(f32), MAX_CLUSTERED_LIGHTS * 3 },
+            { &light_cluster_buffer, DXGI_FORMAT_R32G32_UINT,        2 * sizeof(u32), NUM_LIGHT_CLUSTERS },
+            { &light_index_buffer,   DXGI_FORMAT_R32_UINT,           sizeof(u32),     MAX_CLUSTER_LIGHT_INDICES },
+        };
+
+        for (int i = 0; i < ArrayCount(buffers); i++) {
+            D3D11_BUFFER_DESC bd = {};
+            bd.ByteWidth = buffers[i].element_size * buffers[i].num_elements;
+            bd.Usage = D3D11_USAGE_DYNAMIC;
+            bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+            bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            device->CreateBuffer(&bd, nullptr, buffers[i].buffer);
+
+            D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+            srv_desc.Format = buffers[i].format;
+            srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+            srv_desc.Buffer.FirstElement = 0;
+            srv_desc.Buffer.NumElements = buffers[i].num_elements;
+            device->CreateShaderResourceView(*buffers[i].buffer, &srv_desc, &light_srvs[i]);
+
+            track_gpu_memory(MEMORY_TAG_SCENE, bd.ByteWidth);
+        }
+    }
+
     {
         D3D11_SAMPLER_DESC sampler_desc = {};
         sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -501,6 +571,9 @@ void make_buffers_for_mesh(Mesh *mesh, u32 num_vertices, Mesh_Vertex *buffer, u3
 
     mesh->vbo = (void *)vbo;
     mesh->ibo = (void *)ibo;
+
+    mesh->gpu_size_in_bytes = (s64)num_vertices * sizeof(Mesh_Vertex) + (s64)num_indices * sizeof(u32);
+    track_gpu_memory(MEMORY_TAG_MESH, mesh->gpu_size_in_bytes);
 }
 
 void swap_buffers() {
@@ -638,6 +711,9 @@ Texture_Map *create_texture_rendertarget(int width, int height, bool multisample
     result->texture = (void *)texture;
     result->rtv = (void *)rtv;
     result->srv = (void *)srv;
+
+    result->gpu_size_in_bytes = (s64)width * height * 4 * texture_desc.SampleDesc.Count;
+    track_gpu_memory(MEMORY_TAG_RENDER_TARGET, result->gpu_size_in_bytes);
     
     return result;
 }
@@ -656,6 +732,9 @@ Texture_Map *create_texture_depthtarget(Texture_Map *render_target) {
 
     device->CreateTexture2D(&depth_buffer_desc, nullptr, (ID3D11Texture2D **)&result->texture);
     device->CreateDepthStencilView((ID3D11Texture2D *)result->texture, nullptr, (ID3D11DepthStencilView **)&result->rtv);
+
+    result->gpu_size_in_bytes = (s64)result->width * result->height * 4 * depth_buffer_desc.SampleDesc.Count;
+    track_gpu_memory(MEMORY_TAG_RENDER_TARGET, result->gpu_size_in_bytes);
     
     return result;
 }
@@ -699,23 +778,36 @@ void clear_render_target(f32 r, f32 g, f32 b, f32 a) {
     }
 }
 
+// Estimates how many pixels one repeat of each bound texture covers and tells
+// the streamer. Uses the nearest point of the mesh's bounding sphere, so a
+// mesh the camera is inside (terrain) asks for full detail.
+static void note_streamed_texture_use(Mesh *mesh, Vector3 position, f32 scale) {
+    Matrix4 v = world_to_view_matrix;
+    Vector3 center = make_vector3(v._11 * position.x + v._12 * position.y + v._13 * position.z + v._14,
+                                  v._21 * position.x + v._22 * position.y + v._23 * position.z + v._24,
+                                  v._31 * position.x + v._32 * position.y + v._33 * position.z + v._34);
+
+    f32 radius = mesh->radius * scale;
+    f32 distance = Max(get_length(center) - radius, 0.1f);
+
+    f32 pixels_per_unit = view_to_proj_matrix._22 * render_target_height * 0.5f / distance;
+    f32 projected_pixels = 2.0f * radius / texture_tiling_for_streaming * pixels_per_unit;
+
+    for (int i = 0; i < num_textures_for_streaming; i++) {
+        Texture_Map *map = textures_for_streaming[i];
+        if (map && map->stream) note_texture_use(map, projected_pixels);
+    }
+}
+
 void draw_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
-    Matrix4 m = matrix4_identity();
+    bind_mesh(mesh, position, rotation, scale);
+    draw_mesh_indices(0, mesh->vertex_count);
+}
 
-    m._11 = scale;
-    m._22 = scale;
-    m._33 = scale;
+void bind_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
+    note_streamed_texture_use(mesh, position, scale);
 
-    m._14 = position.x;
-    m._24 = position.y;
-    m._34 = position.z;
-    
-    Matrix4 rot_x = make_x_rotation(rotation.x * (PI / 180.0f));
-    Matrix4 rot_y = make_y_rotation(rotation.y * (PI / 180.0f));
-    Matrix4 rot_z = make_z_rotation(rotation.z * (PI / 180.0f));
-    Matrix4 r = rot_x * rot_y * rot_z;
-    
-    object_to_world_matrix = m * r;
+    object_to_world_matrix = make_object_to_world_matrix(position, rotation, scale);
     refresh_transform();
     
     UINT stride = sizeof(Mesh_Vertex);
@@ -724,8 +816,10 @@ void draw_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
     device_context->IASetIndexBuffer((ID3D11Buffer *)mesh->ibo, DXGI_FORMAT_R32_UINT, 0);
 
     set_vertex_format_to_mesh();
-    
-    device_context->DrawIndexed(mesh->vertex_count, 0, 0);
+}
+
+void draw_mesh_indices(u32 first_index, u32 num_indices) {
+    device_context->DrawIndexed(num_indices, first_index, 0);
 }
 
 void refresh_transform() {
@@ -768,11 +862,15 @@ void rendering_2d_right_handed() {
 }
 
 void set_diffuse_texture(Texture_Map *map) {
+    textures_for_streaming[0] = map;
+    num_textures_for_streaming = 1;
+    texture_tiling_for_streaming = 1.0f;
+
     if (current_diffuse_map == map) return;
 
     immediate_flush();
 
-    if (map) {
+    if (map && map->srv) {
         device_context->PSSetShaderResources(0, 1, (ID3D11ShaderResourceView **)&map->srv);
     } else {
         device_context->PSSetShaderResources(0, 1, (ID3D11ShaderResourceView **)&white_texture->srv);
@@ -780,72 +878,82 @@ void set_diffuse_texture(Texture_Map *map) {
     current_diffuse_map = map;
 }
 
-void set_terrain_textures(Terrain_Texture_Pack pack) {
+void set_terrain_textures(Terrain_Texture_Pack pack, Texture_Map *blend_map) {
     current_diffuse_map = nullptr;
-    
-    device_context->PSSetShaderResources(0, 1, (ID3D11ShaderResourceView **)&pack.background_texture->srv);
-    device_context->PSSetShaderResources(1, 1, (ID3D11ShaderResourceView **)&pack.r_texture->srv);
-    device_context->PSSetShaderResources(2, 1, (ID3D11ShaderResourceView **)&pack.g_texture->srv);
-    device_context->PSSetShaderResources(3, 1, (ID3D11ShaderResourceView **)&pack.b_texture->srv);
+
+    // There's no white fallback for an array; a pack that failed to build
+    // leaves the slot empty and the terrain draws black.
+    ID3D11ShaderResourceView *layers_srv = pack.layers ? (ID3D11ShaderResourceView *)pack.layers->srv : nullptr;
+    device_context->PSSetShaderResources(0, 1, &layers_srv);
+
+    // A blend map that is still loading shows up as white.
+    Texture_Map *map = (blend_map && blend_map->srv) ? blend_map : white_texture;
+    device_context->PSSetShaderResources(1, 1, (ID3D11ShaderResourceView **)&map->srv);
+
+    // The layers are built from source images and always fully resident; only
+    // the blend map can be streamed. It's stretched once over the terrain.
+    textures_for_streaming[0] = blend_map;
+    num_textures_for_streaming = 1;
+    texture_tiling_for_streaming = 1.0f;
 }
 
-Texture_Map *create_texture(Bitmap bitmap) {
-    ID3D11Texture2D *texture = nullptr;
-    ID3D11ShaderResourceView *srv = nullptr;
+void set_terrain_chunk_layers(int layer_a, int layer_b) {
+    if (current_terrain_chunk_layers[0] != layer_a || current_terrain_chunk_layers[1] != layer_b) {
+        u32 layers[4] = { (u32)layer_a, (u32)layer_b, 0, 0 };
 
-    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-    int num_channels = 0;
-    if (bitmap.format == TEXTURE_FORMAT_RGBA8 || bitmap.format == TEXTURE_FORMAT_RGB8) {
-        format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-        num_channels = 4;
-    }
+        D3D11_MAPPED_SUBRESOURCE msr;
+        device_context->Map(terrain_chunk_cbo, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
+        memcpy(msr.pData, layers, sizeof(layers));
+        device_context->Unmap(terrain_chunk_cbo, 0);
 
-    u8 *data = bitmap.data;
-    bool should_free_data_on_exit = false;
-    if (bitmap.format == TEXTURE_FORMAT_RGB8) {
-        should_free_data_on_exit = true;
-
-        data = new u8[bitmap.width * bitmap.height * 4];
-        for (int y = 0; y < bitmap.height; y++) {
-            for (int x = 0; x < bitmap.width; x++) {
-                u8 *source = &bitmap.data[(y * bitmap.width + x) * 3];
-                u8 *dest = &data[(y * bitmap.width + x) * 4];
-
-                dest[0] = source[0];
-                dest[1] = source[1];
-                dest[2] = source[2];
-                dest[3] = 255;
-            }
-        }
+        current_terrain_chunk_layers[0] = layer_a;
+        current_terrain_chunk_layers[1] = layer_b;
     }
-    defer { if (should_free_data_on_exit) delete [] data; };
 
+    device_context->PSSetConstantBuffers(1, 1, &terrain_chunk_cbo);
+}
+
+static void write_dynamic_buffer(ID3D11Buffer *buffer, void *data, s64 size) {
+    D3D11_MAPPED_SUBRESOURCE msr;
+    device_context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
+    memcpy(msr.pData, data, size);
+    device_context->Unmap(buffer, 0);
+}
+
+void set_light_clusters(Light_Clusters *clusters) {
+    write_dynamic_buffer(lighting_cbo, &clusters->constants, sizeof(clusters->constants));
+    write_dynamic_buffer(point_light_buffer, clusters->lights, clusters->num_lights * sizeof(Point_Light));
+    write_dynamic_buffer(light_cluster_buffer, clusters->cluster_ranges, sizeof(clusters->cluster_ranges));
+    write_dynamic_buffer(light_index_buffer, clusters->light_indices, clusters->num_light_indices * sizeof(u32));
+
+    // Nothing else uses these slots, so they stay bound across shader changes.
+    device_context->PSSetConstantBuffers(2, 1, &lighting_cbo);
+    device_context->PSSetShaderResources(4, ArrayCount(light_srvs), light_srvs);
+}
+
+// No pixels means the texture gets filled in later through update_texture, the
+// way font pages are. Those stay a single updatable level; they're drawn 1:1.
+static void init_empty_texture(Texture_Map *result, Bitmap bitmap) {
     D3D11_TEXTURE2D_DESC texture_desc = {};
     texture_desc.Width = bitmap.width;
     texture_desc.Height = bitmap.height;
-    texture_desc.MipLevels = 0;
+    texture_desc.MipLevels = 1;
     texture_desc.ArraySize = 1;
-    texture_desc.Format = format;
+    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
     texture_desc.SampleDesc.Count = 1;
     texture_desc.Usage = D3D11_USAGE_DEFAULT;
-    texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
-    texture_desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-    
-    device->CreateTexture2D(&texture_desc, NULL, &texture);
+    texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
-    if (bitmap.data) {
-        device_context->UpdateSubresource(texture, 0, NULL, data, bitmap.width * num_channels * sizeof(u8), 0);
-    }
+    ID3D11Texture2D *texture = nullptr;
+    device->CreateTexture2D(&texture_desc, NULL, &texture);
 
     D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
     srv_desc.Format = texture_desc.Format;
     srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srv_desc.Texture2D.MipLevels = -1;
-    device->CreateShaderResourceView(texture, &srv_desc, &srv);
+    srv_desc.Texture2D.MipLevels = 1;
 
-    device_context->GenerateMips(srv);
-    
-    Texture_Map *result = new Texture_Map();
+    ID3D11ShaderResourceView *srv = nullptr;
+    device->CreateShaderResourceView(texture, &srv_desc, &srv);
 
     result->width = bitmap.width;
     result->height = bitmap.height;
@@ -854,11 +962,287 @@ Texture_Map *create_texture(Bitmap bitmap) {
     result->texture = (void *)texture;
     result->srv = (void *)srv;
     result->rtv = nullptr;
-    
+
+    result->gpu_size_in_bytes = (s64)bitmap.width * bitmap.height * 4;
+    track_gpu_memory(MEMORY_TAG_TEXTURE, result->gpu_size_in_bytes);
+}
+
+void init_texture(Texture_Map *result, Bitmap bitmap) {
+    if (!bitmap.data) {
+        init_empty_texture(result, bitmap);
+        return;
+    }
+
+    Bitmap rgba = bitmap;
+    if (bitmap.format == TEXTURE_FORMAT_RGB8) {
+        rgba.format = TEXTURE_FORMAT_RGBA8;
+        rgba.channels = 4;
+        rgba.data = TAGGED_NEW_ARRAY(MEMORY_TAG_TEXTURE, u8, bitmap.width * bitmap.height * 4);
+        convert_rgb_to_rgba(bitmap.data, rgba.data, (s64)bitmap.width * bitmap.height);
+    }
+    defer { if (rgba.data != bitmap.data) tagged_free(rgba.data); };
+
+    // The mips are built on the CPU (gamma correct, alpha weighted) rather than
+    // with GenerateMips, so they match what texture_cooker writes. Textures with
+    // alpha here are cutouts (fern, flowers), so their coverage is held steady.
+    // Data textures are averaged as they are.
+    Mip_Options options;
+    options.allocator = make_tagged_allocator(MEMORY_TAG_TEXTURE);
+    options.srgb = result->srgb;
+    if (bitmap.format == TEXTURE_FORMAT_RGBA8 && result->srgb) options.alpha_coverage_cutoff = 0.5f;
+
+    Mip_Chain chain;
+    build_mip_chain(rgba, &chain, options);
+    defer { free_mip_chain(&chain); };
+
+    Texture_Level levels[MAX_MIP_LEVELS];
+    for (int i = 0; i < chain.num_levels; i++) {
+        levels[i].width = chain.levels[i].width;
+        levels[i].height = chain.levels[i].height;
+        levels[i].data = chain.levels[i].data;
+    }
+
+    init_texture_with_levels(result, TEXTURE_FORMAT_RGBA8, result->srgb, chain.num_levels, levels);
+    result->format = bitmap.format;
+}
+
+static DXGI_FORMAT get_dxgi_format(Texture_Format format, bool srgb) {
+    switch (format) {
+        case TEXTURE_FORMAT_RGBA8: return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+        case TEXTURE_FORMAT_BC1:   return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+        case TEXTURE_FORMAT_BC3:   return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+        case TEXTURE_FORMAT_BC5:   return DXGI_FORMAT_BC5_UNORM; // No sRGB variant, it's for data.
+        case TEXTURE_FORMAT_BC7:   return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+    }
+
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+// Drops the GPU side of a texture that is about to be replaced. A bound view
+// stays alive until it's unbound, so this is safe mid-frame.
+static void release_texture_resources(Texture_Map *map) {
+    if (current_diffuse_map == map) current_diffuse_map = nullptr;
+
+    track_gpu_memory(MEMORY_TAG_TEXTURE, -map->gpu_size_in_bytes);
+    map->gpu_size_in_bytes = 0;
+
+    if (map->srv) ((ID3D11ShaderResourceView *)map->srv)->Release();
+    if (map->texture) ((ID3D11Texture2D *)map->texture)->Release();
+    map->srv = nullptr;
+    map->texture = nullptr;
+}
+
+void init_texture_with_levels(Texture_Map *result, Texture_Format format, bool srgb, int num_levels, Texture_Level *levels) {
+    assert(num_levels > 0 && num_levels <= 16);
+
+    DXGI_FORMAT dxgi_format = get_dxgi_format(format, srgb);
+    if (dxgi_format == DXGI_FORMAT_UNKNOWN) {
+        fprintf(stderr, "Texture format %d can't be uploaded as levels.\n", format);
+        return;
+    }
+
+    D3D11_SUBRESOURCE_DATA initial_data[16] = {};
+    s64 total_size = 0;
+    for (int i = 0; i < num_levels; i++) {
+        initial_data[i].pSysMem = levels[i].data;
+        initial_data[i].SysMemPitch = (UINT)get_texture_row_pitch(format, levels[i].width);
+        total_size += get_texture_level_size(format, levels[i].width, levels[i].height);
+    }
+
+    D3D11_TEXTURE2D_DESC texture_desc = {};
+    texture_desc.Width = levels[0].width;
+    texture_desc.Height = levels[0].height;
+    texture_desc.MipLevels = num_levels;
+    texture_desc.ArraySize = 1;
+    texture_desc.Format = dxgi_format;
+    texture_desc.SampleDesc.Count = 1;
+    texture_desc.Usage = D3D11_USAGE_IMMUTABLE;
+    texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    ID3D11Texture2D *texture = nullptr;
+    device->CreateTexture2D(&texture_desc, initial_data, &texture);
+    if (!texture) {
+        fprintf(stderr, "Failed to create %dx%d texture (format %d, %d levels).\n", levels[0].width, levels[0].height, format, num_levels);
+        return;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = dxgi_format;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Texture2D.MipLevels = num_levels;
+
+    ID3D11ShaderResourceView *srv = nullptr;
+    device->CreateShaderResourceView(texture, &srv_desc, &srv);
+
+    release_texture_resources(result);
+
+    result->width = levels[0].width;
+    result->height = levels[0].height;
+    result->format = format;
+    result->num_levels = num_levels;
+    result->srgb = srgb;
+
+    result->texture = (void *)texture;
+    result->srv = (void *)srv;
+    result->rtv = nullptr;
+
+    result->gpu_size_in_bytes = total_size;
+    track_gpu_memory(MEMORY_TAG_TEXTURE, result->gpu_size_in_bytes);
+}
+
+void drop_texture_levels(Texture_Map *map, int num_levels_to_drop) {
+    if (num_levels_to_drop <= 0 || !map->texture) return;
+    assert(num_levels_to_drop < map->num_levels);
+
+    ID3D11Texture2D *old_texture = (ID3D11Texture2D *)map->texture;
+
+    D3D11_TEXTURE2D_DESC texture_desc;
+    old_texture->GetDesc(&texture_desc);
+
+    int num_levels = map->num_levels - num_levels_to_drop;
+    texture_desc.Width = Max(texture_desc.Width >> num_levels_to_drop, 1u);
+    texture_desc.Height = Max(texture_desc.Height >> num_levels_to_drop, 1u);
+    texture_desc.MipLevels = num_levels;
+    texture_desc.Usage = D3D11_USAGE_DEFAULT; // Immutable textures can't be copied into.
+
+    ID3D11Texture2D *texture = nullptr;
+    device->CreateTexture2D(&texture_desc, nullptr, &texture);
+    if (!texture) return;
+
+    s64 total_size = 0;
+    for (int i = 0; i < num_levels; i++) {
+        device_context->CopySubresourceRegion(texture, i, 0, 0, 0, old_texture, i + num_levels_to_drop, nullptr);
+
+        int width = Max((int)texture_desc.Width >> i, 1);
+        int height = Max((int)texture_desc.Height >> i, 1);
+        total_size += get_texture_level_size(map->format, width, height);
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = texture_desc.Format;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Texture2D.MipLevels = num_levels;
+
+    ID3D11ShaderResourceView *srv = nullptr;
+    device->CreateShaderResourceView(texture, &srv_desc, &srv);
+
+    release_texture_resources(map);
+
+    map->width = texture_desc.Width;
+    map->height = texture_desc.Height;
+    map->num_levels = num_levels;
+    map->texture = (void *)texture;
+    map->srv = (void *)srv;
+
+    map->gpu_size_in_bytes = total_size;
+    track_gpu_memory(MEMORY_TAG_TEXTURE, map->gpu_size_in_bytes);
+}
+
+Texture_Map *create_texture_array(int num_layers, Bitmap *layers) {
+    assert(num_layers > 0);
+
+    Texture_Map *result = new Texture_Map();
+
+    int width = layers[0].width;
+    int height = layers[0].height;
+    for (int i = 0; i < num_layers; i++) {
+        if (layers[i].width != width || layers[i].height != height || layers[i].format != TEXTURE_FORMAT_RGBA8) {
+            fprintf(stderr, "Texture array layers have to be RGBA8 and all the same size.\n");
+            return result;
+        }
+    }
+
+    Mip_Options options;
+    options.allocator = make_tagged_allocator(MEMORY_TAG_TEXTURE);
+
+    Mip_Chain *chains = TAGGED_NEW_ARRAY(MEMORY_TAG_TEXTURE, Mip_Chain, num_layers);
+    defer {
+        for (int i = 0; i < num_layers; i++) free_mip_chain(&chains[i]);
+        tagged_free(chains);
+    };
+
+    for (int i = 0; i < num_layers; i++) {
+        build_mip_chain(layers[i], &chains[i], options);
+    }
+
+    // Subresources go every level of the first slice, then the next slice.
+    int num_levels = chains[0].num_levels;
+    D3D11_SUBRESOURCE_DATA *initial_data = TAGGED_NEW_ARRAY(MEMORY_TAG_TEXTURE, D3D11_SUBRESOURCE_DATA, num_layers * num_levels);
+    defer { tagged_free(initial_data); };
+
+    s64 total_size = 0;
+    for (int i = 0; i < num_layers; i++) {
+        for (int level = 0; level < num_levels; level++) {
+            Bitmap *bitmap = &chains[i].levels[level];
+
+            D3D11_SUBRESOURCE_DATA *data = &initial_data[i * num_levels + level];
+            data->pSysMem = bitmap->data;
+            data->SysMemPitch = (UINT)get_texture_row_pitch(TEXTURE_FORMAT_RGBA8, bitmap->width);
+            total_size += get_texture_level_size(TEXTURE_FORMAT_RGBA8, bitmap->width, bitmap->height);
+        }
+    }
+
+    D3D11_TEXTURE2D_DESC texture_desc = {};
+    texture_desc.Width = width;
+    texture_desc.Height = height;
+    texture_desc.MipLevels = num_levels;
+    texture_desc.ArraySize = num_layers;
+    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    texture_desc.SampleDesc.Count = 1;
+    texture_desc.Usage = D3D11_USAGE_IMMUTABLE;
+    texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    ID3D11Texture2D *texture = nullptr;
+    device->CreateTexture2D(&texture_desc, initial_data, &texture);
+    if (!texture) {
+        fprintf(stderr, "Failed to create %dx%d texture array (%d layers).\n", width, height, num_layers);
+        return result;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = texture_desc.Format;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    srv_desc.Texture2DArray.MipLevels = num_levels;
+    srv_desc.Texture2DArray.ArraySize = num_layers;
+
+    ID3D11ShaderResourceView *srv = nullptr;
+    device->CreateShaderResourceView(texture, &srv_desc, &srv);
+
+    result->width = width;
+    result->height = height;
+    result->format = TEXTURE_FORMAT_RGBA8;
+    result->num_levels = num_levels;
+
+    result->texture = (void *)texture;
+    result->srv = (void *)srv;
+
+    result->gpu_size_in_bytes = total_size;
+    track_gpu_memory(MEMORY_TAG_TEXTURE, result->gpu_size_in_bytes);
+
+    return result;
+}
+
+Texture_Map *create_texture(Bitmap bitmap) {
+    Texture_Map *result = new Texture_Map();
+    init_texture(result, bitmap);
     return result;
 }
 
-void update_texture(Texture_Map *map, int x, int y, int width, int height, u8 *data) {
+void destroy_texture(Texture_Map *map) {
+    if (!map) return;
+
+    if (current_diffuse_map == map) current_diffuse_map = nullptr;
+    
+    track_gpu_memory(map->rtv ? MEMORY_TAG_RENDER_TARGET : MEMORY_TAG_TEXTURE, -map->gpu_size_in_bytes);
+
+    if (map->srv) ((ID3D11ShaderResourceView *)map->srv)->Release();
+    if (map->rtv) ((ID3D11RenderTargetView *)map->rtv)->Release();
+    if (map->texture) ((ID3D11Texture2D *)map->texture)->Release();
+
+    delete map;
+}
+
+void update_texture(Texture_Map *map, int x, int y, int width, int height, u8 *data, int pitch) {
     ID3D11Texture2D *tex = (ID3D11Texture2D *)map->texture;
     int num_channels = 0;
     if (map->format == TEXTURE_FORMAT_RGBA8 || map->format == TEXTURE_FORMAT_RGB8) {
@@ -873,7 +1257,9 @@ void update_texture(Texture_Map *map, int x, int y, int width, int height, u8 *d
     box.front = 0;
     box.back = 1;
     
-    device_context->UpdateSubresource(tex, 0, &box, data, width * num_channels * sizeof(u8), 0);
+    if (!pitch) pitch = width * num_channels * sizeof(u8);
+    
+    device_context->UpdateSubresource(tex, 0, &box, data, pitch, 0);
 }
 
 void set_scissor(int x, int y, int width, int height) {
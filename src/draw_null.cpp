@@ -0,0 +1,267 @@
+#ifdef RENDER_NULL
+
+// A backend that draws nothing. Everything above the backend runs as usual,
+// culling and command list recording included, so that work can be run and
+// timed on machines without D3D11. Textures and render targets keep their
+// sizes so layout code sees the same numbers it would with a real backend.
+
+#include "display.h"
+#include "geometry.h"
+#include "mesh.h"
+#include "draw.h"
+#include "lighting.h"
+
+struct Shader {
+    int unused;
+};
+
+Texture_Map *the_back_buffer;
+Texture_Map *the_back_depth_buffer;
+
+Texture_Map *the_offscreen_buffer;
+Texture_Map *the_offscreen_depth_buffer;
+int default_offscreen_buffer_width;
+int default_offscreen_buffer_height;
+
+int render_target_width = 0;
+int render_target_height = 0;
+
+Matrix4 view_to_proj_matrix;
+Matrix4 world_to_view_matrix;
+Matrix4 object_to_world_matrix;
+Matrix4 object_to_proj_matrix;
+
+bool draw_is_initted = false;
+
+bool multisampling;
+int num_samples;
+
+static Shader null_shader;
+
+void resize_offscreen_buffer(int width, int height) {
+    the_offscreen_buffer->width = width;
+    the_offscreen_buffer->height = height;
+    the_offscreen_depth_buffer->width = width;
+    the_offscreen_depth_buffer->height = height;
+}
+
+void set_shader(Shader *shader) {
+    assert(shader);
+}
+
+void init_draw(bool vsync, bool multisample, int sample_count) {
+    defer { draw_is_initted = true; };
+
+    multisampling = multisample;
+    num_samples = sample_count;
+
+    the_back_buffer = new Texture_Map();
+    the_back_buffer->width = display_get_width();
+    the_back_buffer->height = display_get_height();
+
+    the_back_depth_buffer = new Texture_Map();
+    the_back_depth_buffer->width = the_back_buffer->width;
+    the_back_depth_buffer->height = the_back_buffer->height;
+
+    the_offscreen_buffer = create_texture_rendertarget(the_back_buffer->width, the_back_buffer->height, multisampling, num_samples);
+    the_offscreen_depth_buffer = create_texture_depthtarget(the_offscreen_buffer);
+    default_offscreen_buffer_width = the_back_buffer->width;
+    default_offscreen_buffer_height = the_back_buffer->height;
+
+    // Every shader is the same nothing.
+    shader_color = &null_shader;
+    shader_texture = &null_shader;
+    shader_basic_3d = &null_shader;
+    shader_msaa_2x = &null_shader;
+    shader_msaa_4x = &null_shader;
+    shader_msaa_8x = &null_shader;
+    shader_text = &null_shader;
+    shader_terrain = &null_shader;
+    shader_terrain_one_layer = &null_shader;
+    shader_terrain_two_layers = &null_shader;
+
+    view_to_proj_matrix = matrix4_identity();
+    world_to_view_matrix = matrix4_identity();
+    object_to_world_matrix = matrix4_identity();
+    object_to_proj_matrix = matrix4_identity();
+}
+
+void resize_render_targets(int width, int height) {
+    the_back_buffer->width = width;
+    the_back_buffer->height = height;
+    the_back_depth_buffer->width = width;
+    the_back_depth_buffer->height = height;
+    resize_offscreen_buffer(width, height);
+
+    default_offscreen_buffer_width = the_back_buffer->width;
+    default_offscreen_buffer_height = the_back_buffer->height;
+}
+
+void make_buffers_for_mesh(Mesh *mesh, u32 num_vertices, Mesh_Vertex *buffer, u32 num_indices, u32 *indices) {
+    mesh->vbo = nullptr;
+    mesh->ibo = nullptr;
+    mesh->gpu_size_in_bytes = 0;
+}
+
+void swap_buffers() {
+}
+
+void immediate_begin() {
+}
+
+void immediate_flush() {
+}
+
+void immediate_vertex(Vector3 position, u32 color, Vector2 uv) {
+}
+
+void immediate_quad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
+}
+
+void immediate_quad(Vector3 p0, Vector3 p1, Vector3 p2, Vector3 p3, Vector4 color) {
+}
+
+void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector2 uv0, Vector2 uv1, Vector2 uv2, Vector2 uv3, Vector4 color) {
+}
+
+void immediate_quad(Vector2 p0, Vector2 p1, Vector2 p2, Vector2 p3, Vector4 color) {
+}
+
+void set_vertex_format_to_mesh() {
+}
+
+void set_vertex_format_to_immediate() {
+}
+
+Texture_Map *create_texture_rendertarget(int width, int height, bool multisample, int num_samples) {
+    Texture_Map *result = new Texture_Map();
+    result->width = width;
+    result->height = height;
+    return result;
+}
+
+Texture_Map *create_texture_depthtarget(Texture_Map *render_target) {
+    Texture_Map *result = new Texture_Map();
+    result->width = render_target->width;
+    result->height = render_target->height;
+    return result;
+}
+
+void set_render_target(Texture_Map *map) {
+    assert(map);
+
+    render_target_width = map->width;
+    render_target_height = map->height;
+}
+
+void set_depth_target(Texture_Map *map) {
+    assert(map);
+}
+
+void clear_render_target(f32 r, f32 g, f32 b, f32 a) {
+}
+
+void draw_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
+    bind_mesh(mesh, position, rotation, scale);
+    draw_mesh_indices(0, mesh->vertex_count);
+}
+
+void bind_mesh(Mesh *mesh, Vector3 position, Vector3 rotation, f32 scale) {
+    object_to_world_matrix = make_object_to_world_matrix(position, rotation, scale);
+    refresh_transform();
+}
+
+void draw_mesh_indices(u32 first_index, u32 num_indices) {
+}
+
+void refresh_transform() {
+    object_to_proj_matrix = view_to_proj_matrix * (world_to_view_matrix * object_to_world_matrix);
+}
+
+void rendering_2d_right_handed() {
+    view_to_proj_matrix = matrix4_identity();
+
+    f32 w = (f32)render_target_width;
+    if (w < 1.0f) w = 1.0f;
+    f32 h = (f32)render_target_height;
+    if (h < 1.0f) h = 1.0f;
+
+    view_to_proj_matrix._11 = 2.0f/w;
+    view_to_proj_matrix._22 = 2.0f/h;
+    view_to_proj_matrix._14 = -1.0f;
+    view_to_proj_matrix._24 = -1.0f;
+
+    world_to_view_matrix = matrix4_identity();
+    object_to_world_matrix = matrix4_identity();
+
+    refresh_transform();
+}
+
+void set_diffuse_texture(Texture_Map *map) {
+}
+
+void set_terrain_textures(Terrain_Texture_Pack pack, Texture_Map *blend_map) {
+}
+
+void set_terrain_chunk_layers(int layer_a, int layer_b) {
+}
+
+void set_light_clusters(Light_Clusters *clusters) {
+}
+
+void init_texture(Texture_Map *result, Bitmap bitmap) {
+    result->width = bitmap.width;
+    result->height = bitmap.height;
+    result->format = bitmap.format;
+    result->num_levels = 1;
+}
+
+void init_texture_with_levels(Texture_Map *result, Texture_Format format, bool srgb, int num_levels, Texture_Level *levels) {
+    assert(num_levels > 0 && num_levels <= 16);
+
+    result->width = levels[0].width;
+    result->height = levels[0].height;
+    result->format = format;
+    result->num_levels = num_levels;
+    result->srgb = srgb;
+}
+
+void drop_texture_levels(Texture_Map *map, int num_levels_to_drop) {
+    if (num_levels_to_drop <= 0) return;
+    assert(num_levels_to_drop < map->num_levels);
+
+    map->width = Max(map->width >> num_levels_to_drop, 1);
+    map->height = Max(map->height >> num_levels_to_drop, 1);
+    map->num_levels -= num_levels_to_drop;
+}
+
+Texture_Map *create_texture_array(int num_layers, Bitmap *layers) {
+    assert(num_layers > 0);
+
+    Texture_Map *result = new Texture_Map();
+    result->width = layers[0].width;
+    result->height = layers[0].height;
+    result->format = TEXTURE_FORMAT_RGBA8;
+    return result;
+}
+
+Texture_Map *create_texture(Bitmap bitmap) {
+    Texture_Map *result = new Texture_Map();
+    init_texture(result, bitmap);
+    return result;
+}
+
+void destroy_texture(Texture_Map *map) {
+    delete map;
+}
+
+void update_texture(Texture_Map *map, int x, int y, int width, int height, u8 *data, int pitch) {
+}
+
+void set_scissor(int x, int y, int width, int height) {
+}
+
+void clear_scissor() {
+}
+
+#endif
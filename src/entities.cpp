@@ -1,3 +1,41 @@
 #include "entities.h"
 
 #include "input.h"
+#include "mesh.h"
+
+void update_entity_bounds(Entity *entity) {
+    if (!entity->mesh) return;
+
+    entity->bounds = get_world_bounds_between(entity->mesh, entity->previous_position, entity->previous_rotation,
+                                              entity->position, entity->rotation, entity->scale);
+
+    Entity_Manager *manager = entity->manager;
+    if (manager && manager->octree.root) update_in_octree(&manager->octree, entity);
+}
+
+Vector3 get_interpolated_position(Entity *entity, f32 alpha) {
+    return lerp(entity->previous_position, entity->position, alpha);
+}
+
+Vector3 get_interpolated_rotation(Entity *entity, f32 alpha) {
+    return lerp(entity->previous_rotation, entity->rotation, alpha);
+}
+
+static bool vectors_match(Vector3 a, Vector3 b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+void Entity_Manager::save_previous_transforms() {
+    for (int i = 0; i < entities.count; i++) {
+        Entity *entity = entities[i];
+
+        // Bounds covering last tick's motion shrink back once it's over.
+        bool moved = !vectors_match(entity->previous_position, entity->position) ||
+                     !vectors_match(entity->previous_rotation, entity->rotation);
+
+        entity->previous_position = entity->position;
+        entity->previous_rotation = entity->rotation;
+
+        if (moved) update_entity_bounds(entity);
+    }
+}
@@ -3,6 +3,8 @@
 
 #include "array.h"
 #include "geometry.h"
+#include "culling.h"
+#include "octree.h"
 
 struct Mesh;
 struct Entity_Manager;
@@ -16,8 +18,28 @@ struct Entity {
     Vector3 position = make_vector3(0, 0, 0);
     Vector3 rotation = make_vector3(0, 0, 0);
     f32 scale = 1.0f;
+
+    // The transform as of the start of the last simulation tick. Drawing
+    // blends from these to the current ones, see save_previous_transforms.
+    Vector3 previous_position = make_vector3(0, 0, 0);
+    Vector3 previous_rotation = make_vector3(0, 0, 0);
+
+    // World space, from the mesh bounds and both transforms above, so it
+    // holds the entity wherever it's drawn during the tick. Call
+    // update_entity_bounds after changing any of them, which also moves the
+    // entity in the manager's octree.
+    Bounds bounds = {};
+
+    Octree_Node *octree_node = nullptr;
+    int octree_index = -1;
 };
 
+void update_entity_bounds(Entity *entity);
+
+// Where the entity is drawn, 'alpha' of the way through the current tick.
+Vector3 get_interpolated_position(Entity *entity, f32 alpha);
+Vector3 get_interpolated_rotation(Entity *entity, f32 alpha);
+
 struct Light : public Entity {
     Vector3 color;
     Vector3 attenutation;
@@ -38,15 +60,37 @@ struct Guy : public Entity {
 };
 
 struct Entity_Manager {
+    // Everything that can be drawn, whatever its type.
+    Array <Entity *> entities;
+
     Array <Light *> lights;
+
+    // Over every entity with a mesh, for culling and proximity queries.
+    Octree octree;
     
     Guy *guy;
 
     inline Guy *add_guy() {
         guy = new Guy();
         guy->manager = this;
+        entities.add(guy);
         return guy;
     }
+
+    // Lights aren't drawn, so they stay out of entities and the octree.
+    inline Light *add_light(Vector3 position, Vector3 color, Vector3 attenuation) {
+        Light *light = new Light();
+        light->manager = this;
+        light->position = position;
+        light->color = color;
+        light->attenutation = attenuation;
+        lights.add(light);
+        return light;
+    }
+
+    // Called at the start of every simulation tick, and once after the level
+    // is set up so the first frames don't blend in from the origin.
+    void save_previous_transforms();
 };
 
 #endif
@@ -4,13 +4,134 @@
 #include "font.h"
 #include "draw.h"
 #include "array.h"
+#include "jobs.h"
+#include "os.h"
+#include "memory_tags.h"
+#include "assets.h"
+#include "pixel_convert.h"
+#include "profiler.h"
 
 static bool ft_initted;
 static FT_Library ft;
-static Array <Font *> loaded_fonts;
+static Array <Font_Page *> pages_to_flush;
+
+const s64 DEFAULT_FONT_CACHE_BUDGET = 64 * 1024 * 1024;
+
+static Hash_Table <u64, Font *> font_cache;
+static Font *most_recently_used_font;
+static Font *least_recently_used_font;
+static int num_cached_fonts;
+static s64 font_cache_budget = DEFAULT_FONT_CACHE_BUDGET;
+static u64 font_frame_index;
+
+static Font_Frame_Stats current_frame_stats;
+static Font_Frame_Stats last_frame_stats;
+
+inline u32 make_kerning_key(u32 glyph_index, u32 next_glyph_index) {
+    return (glyph_index << 16) | (next_glyph_index & 0xffff);
+}
+
+static void flush_font_page(Font_Page *page, int atlas_width) {
+    for (int i = 0; i < page->dirty_rects.count; i++) {
+        Rectangle2i rect = page->dirty_rects[i];
+        
+        u8 *data = page->pixels + (rect.y * atlas_width + rect.x) * 4;
+        update_texture(page->map, rect.x, rect.y, rect.width, rect.height, data, atlas_width * 4);
+
+        current_frame_stats.num_uploads += 1;
+        current_frame_stats.bytes_uploaded += rect.width * rect.height * 4;
+    }
+
+    page->dirty_rects.reset();
+}
+
+static void mark_dirty(Font_Page *page, Rectangle2i rect) {
+    // Glyphs are packed left to right in rows, so anything sharing a row with
+    // an existing dirty rect gets folded into it and a row uploads as one strip.
+    for (int i = 0; i < page->dirty_rects.count; i++) {
+        Rectangle2i *dirty = &page->dirty_rects[i];
+
+        bool rows_overlap = (rect.y < get_max_y(*dirty)) && (dirty->y < get_max_y(rect));
+        if (!rows_overlap) continue;
+
+        int min_x = Min(dirty->x, rect.x);
+        int min_y = Min(dirty->y, rect.y);
+        int max_x = Max(get_max_x(*dirty), get_max_x(rect));
+        int max_y = Max(get_max_y(*dirty), get_max_y(rect));
+
+        dirty->x = min_x;
+        dirty->y = min_y;
+        dirty->width = max_x - min_x;
+        dirty->height = max_y - min_y;
+        return;
+    }
+
+    page->dirty_rects.add(rect);
+
+    if (!page->is_queued_for_flush) {
+        page->is_queued_for_flush = true;
+        pages_to_flush.add(page);
+    }
+}
+
+static Font_Page *add_font_page(Font *font) {
+    if (font->pages.count) {
+        // The current page is full. Push out whatever is still pending and
+        // drop its mirror, nothing will be rasterized into it again.
+        Font_Page *full_page = font->pages[font->pages.count - 1];
+        flush_font_page(full_page, font->bw);
+        tagged_free(full_page->pixels);
+        full_page->pixels = nullptr;
+    }
+    
+    Bitmap bitmap = {};
+    bitmap.width = font->bw;
+    bitmap.height = font->bh;
+    bitmap.format = TEXTURE_FORMAT_RGBA8;
+
+    Font_Page *page = TAGGED_NEW(MEMORY_TAG_FONT, Font_Page);
+    page->dirty_rects.allocator = make_tagged_allocator(MEMORY_TAG_FONT);
+    page->map = create_texture(bitmap);
+
+    int num_bytes = font->bw * font->bh * 4;
+    page->pixels = TAGGED_NEW_ARRAY(MEMORY_TAG_FONT, u8, num_bytes);
+    memset(page->pixels, 0, num_bytes);
+
+    font->pages.add(page);
+    return page;
+}
+
+static void precompute_latin1_kerning(Font *font) {
+    u32 glyph_indices[256];
+    int num_glyph_indices = 0;
+    for (int codepoint = 0; codepoint < 256; codepoint++) {
+        u32 glyph_index = font->latin1_glyph_indices[codepoint];
+        if (glyph_index) glyph_indices[num_glyph_indices++] = glyph_index;
+    }
+
+    for (int i = 0; i < num_glyph_indices; i++) {
+        for (int j = 0; j < num_glyph_indices; j++) {
+            FT_Vector kern;
+            FT_Get_Kerning(font->face, glyph_indices[i], glyph_indices[j], FT_KERNING_DEFAULT, &kern);
+
+            int kern_in_pixels = kern.x >> 6;
+            if (!kern_in_pixels) continue;
+
+            font->kerning_pairs.add(make_kerning_key(glyph_indices[i], glyph_indices[j]), kern_in_pixels);
+        }
+    }
+}
 
 Font *load_font(char *full_path, int size) {
-    Font *result = new Font();
+    PROFILE_SCOPE("load_font");
+
+    Font *result = TAGGED_NEW(MEMORY_TAG_FONT, Font);
+
+    Allocator font_allocator = make_tagged_allocator(MEMORY_TAG_FONT);
+    result->glyphs.allocator = font_allocator;
+    result->glyph_indices.allocator = font_allocator;
+    result->kerning_pairs.allocator = font_allocator;
+    result->pages.allocator = font_allocator;
 
     if (!ft_initted) {
         FT_Init_FreeType(&ft);
@@ -24,56 +145,172 @@ Font *load_font(char *full_path, int size) {
 
     result->character_height = size;
 
+    for (int codepoint = 0; codepoint < 256; codepoint++) {
+        result->latin1_glyph_indices[codepoint] = FT_Get_Char_Index(result->face, codepoint);
+    }
+
+    if (result->has_kerning) {
+        precompute_latin1_kerning(result);
+    }
+
     result->bx = result->by = 0;
     result->bw = result->bh = 1024 + ((size / 1000) * 1024);
+
+    add_font_page(result);
     
-    Bitmap bitmap = {};
-    bitmap.width = result->bw;
-    bitmap.height = result->bh;
-    bitmap.format = TEXTURE_FORMAT_RGBA8;
+    return result;
+}
+
+static u64 make_font_cache_key(Atom name, int size) {
+    return name.id ^ ((u64)size * 0x9e3779b97f4a7c15ULL);
+}
+
+static void unlink_from_lru(Font *font) {
+    if (font->lru_prev) font->lru_prev->lru_next = font->lru_next;
+    else most_recently_used_font = font->lru_next;
+
+    if (font->lru_next) font->lru_next->lru_prev = font->lru_prev;
+    else least_recently_used_font = font->lru_prev;
+
+    font->lru_prev = nullptr;
+    font->lru_next = nullptr;
+}
 
-    result->map = create_texture(bitmap);
+static void link_as_most_recently_used(Font *font) {
+    font->lru_prev = nullptr;
+    font->lru_next = most_recently_used_font;
+    if (most_recently_used_font) most_recently_used_font->lru_prev = font;
+    most_recently_used_font = font;
+    if (!least_recently_used_font) least_recently_used_font = font;
+}
+
+static s64 get_font_size_in_bytes(Font *font) {
+    s64 page_bytes = (s64)font->bw * (s64)font->bh * 4;
     
+    s64 result = 0;
+    for (int i = 0; i < font->pages.count; i++) {
+        result += page_bytes;
+        if (font->pages[i]->pixels) result += page_bytes;
+    }
+
+    result += font->glyphs.get_size_in_bytes();
+    result += font->glyph_indices.get_size_in_bytes();
+    result += font->kerning_pairs.get_size_in_bytes();
     return result;
 }
 
-Font *get_font_at_size(char *short_name, int size) {
-    for (int i = 0; i < loaded_fonts.count; i++) {
-        Font *font = loaded_fonts[i];
-        if (strings_match(font->short_name, short_name) && font->character_height == size) {
+static void free_font(Font *font) {
+    for (int i = 0; i < font->pages.count; i++) {
+        Font_Page *page = font->pages[i];
+
+        if (page->is_queued_for_flush) {
+            for (int j = 0; j < pages_to_flush.count; j++) {
+                if (pages_to_flush[j] == page) {
+                    pages_to_flush.remove_nth(j);
+                    break;
+                }
+            }
+        }
+
+        destroy_texture(page->map);
+        tagged_free(page->pixels);
+        tagged_delete(page);
+    }
+
+    font->glyphs.deinit();
+    font->glyph_indices.deinit();
+    font->kerning_pairs.deinit();
+
+    FT_Done_Face(font->face);
+
+    delete [] font->full_path;
+    tagged_delete(font);
+}
+
+static void evict_fonts_over_budget() {
+    s64 total_bytes = get_font_cache_size_in_bytes();
+
+    Font *font = least_recently_used_font;
+    while (font && total_bytes > font_cache_budget) {
+        // Anything touched this frame may still be held by a caller; the list
+        // is in recency order, so nothing further up can go either.
+        if (font->last_used_frame == font_frame_index) break;
+
+        Font *more_recent = font->lru_prev;
+        
+        if (!font->num_pending_prerasterize_jobs) {
+            total_bytes -= get_font_size_in_bytes(font);
+
+            Font **cached = font_cache.get(font->cache_key);
+            if (cached && *cached == font) font_cache.remove(font->cache_key);
+
+            unlink_from_lru(font);
+            num_cached_fonts--;
+            free_font(font);
+        }
+
+        font = more_recent;
+    }
+}
+
+Font *get_font_at_size(Atom name, int size) {
+    u64 key = make_font_cache_key(name, size);
+    
+    Font **cached = font_cache.get(key);
+    if (cached) {
+        Font *font = *cached;
+        if (font->name == name && font->character_height == size) {
+            font->last_used_frame = font_frame_index;
+            if (font != most_recently_used_font) {
+                unlink_from_lru(font);
+                link_as_most_recently_used(font);
+            }
             return font;
         }
     }
 
-    char *full_path = mprintf("data/fonts/%s", short_name);
+    Asset_Entry *asset = find_asset(ASSET_FONT, name);
+    char *full_path = asset ? copy_string(asset->full_path) : mprintf("data/fonts/%s", name.string);
     
     Font *result = load_font(full_path, size);
     result->full_path = full_path;
-    result->short_name = copy_string(short_name);
-    loaded_fonts.add(result);
+    result->name = name;
+    result->cache_key = key;
+    result->last_used_frame = font_frame_index;
+    
+    // On a key collision the old font stays in the LRU list until evicted.
+    font_cache.add(key, result);
+    link_as_most_recently_used(result);
+    num_cached_fonts++;
+
+    evict_fonts_over_budget();
 
     return result;
 }
 
-Glyph *get_or_load_glyph(Font *font, int codepoint) {
-    Glyph *glyph = font->glyphs[codepoint];
-    
-    if (glyph->height == font->character_height) return glyph;
+Font *get_font_at_size(char *short_name, int size) {
+    return get_font_at_size(intern(short_name), size);
+}
 
-    unsigned long glyph_index = FT_Get_Char_Index(font->face, codepoint);
-    FT_Load_Glyph(font->face, glyph_index, FT_LOAD_RENDER);
+void set_font_cache_budget(s64 num_bytes) {
+    font_cache_budget = num_bytes;
+}
 
-    glyph->advance = font->face->glyph->advance.x >> 6;
-    glyph->bearing_x = font->face->glyph->bitmap_left;
-    glyph->bearing_y = font->face->glyph->bitmap_top;
-    
-    glyph->height = font->character_height;
-    
-    if (is_whitespace(codepoint)) return glyph;
-    
-    glyph->size_x = font->face->glyph->bitmap.width;
-    glyph->size_y = font->face->glyph->bitmap.rows;
-    
+s64 get_font_cache_size_in_bytes() {
+    s64 result = 0;
+    for (Font *font = most_recently_used_font; font; font = font->lru_next) {
+        result += get_font_size_in_bytes(font);
+    }
+    return result;
+}
+
+int get_num_cached_fonts() {
+    return num_cached_fonts;
+}
+
+// Places a rasterized glyph (size_x/size_y already set) in the current atlas
+// page and copies its coverage into the page's mirror.
+static void pack_glyph(Font *font, Glyph *glyph, u8 *coverage, int pitch) {
     bool is_already_on_a_new_line = false;
     if (font->bx + glyph->size_x > font->bw) {
         font->by += font->character_height;
@@ -82,15 +319,12 @@ Glyph *get_or_load_glyph(Font *font, int codepoint) {
     }
 
     if (font->by > font->bh - font->character_height) {
-        Bitmap bitmap = {};
-        bitmap.width = font->bw;
-        bitmap.height = font->bh;
-        bitmap.format = TEXTURE_FORMAT_RGBA8;
-        
-        font->map = create_texture(bitmap);
+        add_font_page(font);
         font->by = 0;
         font->bx = 0;
     }
+
+    Font_Page *page = font->pages[font->pages.count - 1];
     
     glyph->min_uv = make_vector2((float)font->bx, (float)font->by);
     glyph->max_uv = glyph->min_uv + make_vector2((float)glyph->size_x, (float)glyph->size_y);
@@ -98,22 +332,20 @@ Glyph *get_or_load_glyph(Font *font, int codepoint) {
     glyph->min_uv.x /= (float)font->bw; glyph->min_uv.y /= (float)font->bh;
     glyph->max_uv.x /= (float)font->bw; glyph->max_uv.y /= (float)font->bh;
 
-    u8 *data = new u8[glyph->size_x * glyph->size_y * 4];
-    defer { delete [] data; };
-    for (int y = 0; y < glyph->size_y; y++) {
-        for (int x = 0; x < glyph->size_x; x++) {
-            u8 source = font->face->glyph->bitmap.buffer[y * glyph->size_x + x];
-            u8 *dest = &data[(y * glyph->size_x + x) * 4];
-            
-            dest[0] = 255;
-            dest[1] = 255;
-            dest[2] = 255;
-            dest[3] = source;
-        }
+    // A glyph taller than a row can hang off the bottom of the page; clip it
+    // rather than write past the end of the mirror.
+    int rows = Min(glyph->size_y, font->bh - font->by);
+    int columns = Min(glyph->size_x, font->bw - font->bx);
+    
+    for (int y = 0; y < rows; y++) {
+        u8 *source = coverage + y * pitch;
+        u8 *dest = page->pixels + ((font->by + y) * font->bw + font->bx) * 4;
+        convert_a8_to_rgba(source, dest, columns);
     }
 
-    update_texture(font->map, font->bx, font->by, glyph->size_x, glyph->size_y, data);
-    glyph->map = font->map;
+    Rectangle2i rect = { font->bx, font->by, columns, rows };
+    mark_dirty(page, rect);
+    glyph->map = page->map;
     
     font->bx += glyph->size_x + 8;
 
@@ -121,18 +353,71 @@ Glyph *get_or_load_glyph(Font *font, int codepoint) {
         font->by += font->character_height;
         font->bx = 0;
     }
+}
+
+u32 get_glyph_index(Font *font, int codepoint) {
+    if (codepoint >= 0 && codepoint < 256) {
+        return font->latin1_glyph_indices[codepoint];
+    }
+
+    u32 *cached = font->glyph_indices.get(codepoint);
+    if (cached) return *cached;
+
+    u32 glyph_index = FT_Get_Char_Index(font->face, codepoint);
+    font->glyph_indices.add(codepoint, glyph_index);
+    return glyph_index;
+}
+
+Glyph *get_or_load_glyph(Font *font, int codepoint) {
+    Glyph *glyph = font->glyphs[codepoint];
+    
+    if (glyph->height == font->character_height) return glyph;
+
+    PROFILE_SCOPE("Rasterize glyph");
+
+    u32 glyph_index = get_glyph_index(font, codepoint);
+    FT_Load_Glyph(font->face, glyph_index, FT_LOAD_RENDER);
+
+    glyph->advance = font->face->glyph->advance.x >> 6;
+    glyph->bearing_x = font->face->glyph->bitmap_left;
+    glyph->bearing_y = font->face->glyph->bitmap_top;
+    
+    glyph->height = font->character_height;
+
+    current_frame_stats.glyphs_rasterized += 1;
+    
+    if (is_whitespace(codepoint)) return glyph;
+    
+    glyph->size_x = font->face->glyph->bitmap.width;
+    glyph->size_y = font->face->glyph->bitmap.rows;
+
+    FT_Bitmap *bitmap = &font->face->glyph->bitmap;
+    pack_glyph(font, glyph, bitmap->buffer, bitmap->pitch);
     
     return glyph;
 }
 
 int get_kerning_in_pixels(Font *font, int codepoint, int next_codepoint) {
-    unsigned long glyph_index = FT_Get_Char_Index(font->face, codepoint);
-    unsigned long next_glyph_index = FT_Get_Char_Index(font->face, next_codepoint);
+    if (!font->has_kerning) return 0;
+    
+    u32 glyph_index = get_glyph_index(font, codepoint);
+    u32 next_glyph_index = get_glyph_index(font, next_codepoint);
+    if (!glyph_index || !next_glyph_index) return 0;
 
+    u32 key = make_kerning_key(glyph_index, next_glyph_index);
+    int *cached = font->kerning_pairs.get(key);
+    if (cached) return *cached;
+
+    // Every non-zero Latin-1 pair was added in load_font, so a miss here means no kerning.
+    bool both_latin1 = (codepoint >= 0 && codepoint < 256) && (next_codepoint >= 0 && next_codepoint < 256);
+    if (both_latin1) return 0;
+    
     FT_Vector kern;
     FT_Get_Kerning(font->face, glyph_index, next_glyph_index, FT_KERNING_DEFAULT, &kern);
 
-    return kern.x >> 6;
+    int kern_in_pixels = kern.x >> 6;
+    font->kerning_pairs.add(key, kern_in_pixels);
+    return kern_in_pixels;
 }
 
 int get_string_width_in_pixels(Font *font, char *text) {
@@ -157,3 +442,230 @@ int get_string_width_in_pixels(Font *font, char *text) {
     
     return width;
 }
+
+void flush_font_uploads() {
+    PROFILE_SCOPE("flush_font_uploads");
+
+    for (int i = 0; i < pages_to_flush.count; i++) {
+        Font_Page *page = pages_to_flush[i];
+        page->is_queued_for_flush = false;
+
+        if (!page->pixels) continue; // Already flushed when it filled up.
+
+        flush_font_page(page, page->map->width);
+    }
+
+    pages_to_flush.reset();
+}
+
+//
+// Background pre-rasterization
+//
+
+struct Prerasterized_Glyph {
+    int codepoint;
+    int size_x, size_y;
+    int bearing_x, bearing_y;
+    u32 advance;
+    u8 *coverage; // size_x * size_y bytes, null for empty glyphs.
+};
+
+struct Prerasterize_Job {
+    Font *font; // Only touched on the main thread.
+    char *full_path;
+    int size;
+    int first_codepoint;
+    int last_codepoint;
+
+    Array <Prerasterized_Glyph> glyphs;
+    Prerasterize_Job *next_finished;
+};
+
+// FreeType faces are not thread safe, so each worker opens its own and keeps
+// it around while consecutive jobs ask for the same font and size.
+struct Worker_Face {
+    FT_Library library;
+    FT_Face face;
+    char *full_path;
+    int size;
+};
+
+const int PRERASTERIZE_CODEPOINTS_PER_JOB = 128;
+const int MAX_PRERASTERIZE_JOBS_COMMITTED_PER_FRAME = 4;
+
+static Worker_Face worker_faces[MAX_JOB_WORKERS + 1];
+
+static Mutex *finished_jobs_mutex;
+static Prerasterize_Job *first_finished_job;
+static Prerasterize_Job *last_finished_job;
+
+static int num_codepoints_declared;
+static int num_codepoints_committed;
+
+static FT_Face get_worker_face(int worker_index, char *full_path, int size) {
+    Worker_Face *worker_face = &worker_faces[worker_index];
+    
+    if (!worker_face->library) {
+        FT_Init_FreeType(&worker_face->library);
+    }
+
+    if (worker_face->face && worker_face->size == size && strings_match(worker_face->full_path, full_path)) {
+        return worker_face->face;
+    }
+
+    if (worker_face->face) {
+        FT_Done_Face(worker_face->face);
+        worker_face->face = nullptr;
+        delete [] worker_face->full_path;
+        worker_face->full_path = nullptr;
+    }
+
+    if (FT_New_Face(worker_face->library, full_path, 0, &worker_face->face)) {
+        worker_face->face = nullptr;
+        return nullptr;
+    }
+    FT_Set_Pixel_Sizes(worker_face->face, 0, size);
+
+    worker_face->full_path = copy_string(full_path);
+    worker_face->size = size;
+    return worker_face->face;
+}
+
+static void prerasterize_job_proc(void *data, int worker_index) {
+    PROFILE_SCOPE("Prerasterize glyphs");
+
+    Prerasterize_Job *job = (Prerasterize_Job *)data;
+
+    FT_Face face = get_worker_face(worker_index, job->full_path, job->size);
+    if (face) {
+        for (int codepoint = job->first_codepoint; codepoint <= job->last_codepoint; codepoint++) {
+            u32 glyph_index = FT_Get_Char_Index(face, codepoint);
+            if (!glyph_index) continue;
+
+            if (FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER)) continue;
+
+            FT_GlyphSlot slot = face->glyph;
+            
+            Prerasterized_Glyph glyph = {};
+            glyph.codepoint = codepoint;
+            glyph.size_x = slot->bitmap.width;
+            glyph.size_y = slot->bitmap.rows;
+            glyph.bearing_x = slot->bitmap_left;
+            glyph.bearing_y = slot->bitmap_top;
+            glyph.advance = slot->advance.x >> 6;
+
+            if (glyph.size_x && glyph.size_y) {
+                glyph.coverage = TAGGED_NEW_ARRAY(MEMORY_TAG_FONT, u8, glyph.size_x * glyph.size_y);
+                for (int y = 0; y < glyph.size_y; y++) {
+                    memcpy(glyph.coverage + y * glyph.size_x, slot->bitmap.buffer + y * slot->bitmap.pitch, glyph.size_x);
+                }
+            }
+
+            job->glyphs.add(glyph);
+        }
+    }
+
+    os_lock_mutex(finished_jobs_mutex);
+    if (last_finished_job) {
+        last_finished_job->next_finished = job;
+    } else {
+        first_finished_job = job;
+    }
+    last_finished_job = job;
+    os_unlock_mutex(finished_jobs_mutex);
+}
+
+static void commit_prerasterized_glyphs() {
+    if (!finished_jobs_mutex) return;
+    
+    for (int i = 0; i < MAX_PRERASTERIZE_JOBS_COMMITTED_PER_FRAME; i++) {
+        os_lock_mutex(finished_jobs_mutex);
+        Prerasterize_Job *job = first_finished_job;
+        if (job) {
+            first_finished_job = job->next_finished;
+            if (!first_finished_job) last_finished_job = nullptr;
+        }
+        os_unlock_mutex(finished_jobs_mutex);
+
+        if (!job) break;
+
+        Font *font = job->font;
+        for (int j = 0; j < job->glyphs.count; j++) {
+            Prerasterized_Glyph *source = &job->glyphs[j];
+            defer { tagged_free(source->coverage); };
+            
+            Glyph *glyph = font->glyphs[source->codepoint];
+            if (glyph->height == font->character_height) continue; // Already loaded on demand.
+
+            glyph->advance = source->advance;
+            glyph->bearing_x = source->bearing_x;
+            glyph->bearing_y = source->bearing_y;
+            glyph->height = font->character_height;
+
+            if (is_whitespace(source->codepoint)) continue;
+
+            glyph->size_x = source->size_x;
+            glyph->size_y = source->size_y;
+            pack_glyph(font, glyph, source->coverage, source->size_x);
+        }
+
+        num_codepoints_committed += job->last_codepoint - job->first_codepoint + 1;
+        font->num_pending_prerasterize_jobs--;
+
+        delete [] job->full_path;
+        tagged_delete(job);
+    }
+}
+
+void prerasterize_glyphs(Atom name, int size, const Glyph_Range *ranges, int num_ranges) {
+    if (!finished_jobs_mutex) {
+        finished_jobs_mutex = os_create_mutex();
+    }
+    
+    Font *font = get_font_at_size(name, size);
+
+    for (int i = 0; i < num_ranges; i++) {
+        Glyph_Range range = ranges[i];
+        
+        for (int first = range.first_codepoint; first <= range.last_codepoint; first += PRERASTERIZE_CODEPOINTS_PER_JOB) {
+            Prerasterize_Job *job = TAGGED_NEW(MEMORY_TAG_FONT, Prerasterize_Job);
+            job->glyphs.allocator = make_tagged_allocator(MEMORY_TAG_FONT);
+            job->font = font;
+            job->full_path = copy_string(font->full_path);
+            job->size = size;
+            job->first_codepoint = first;
+            job->last_codepoint = Min(first + PRERASTERIZE_CODEPOINTS_PER_JOB - 1, range.last_codepoint);
+
+            // Keeps the font out of eviction until the job is committed.
+            font->num_pending_prerasterize_jobs++;
+
+            num_codepoints_declared += job->last_codepoint - job->first_codepoint + 1;
+            
+            add_job(prerasterize_job_proc, job);
+        }
+    }
+}
+
+float get_glyph_prerasterization_progress() {
+    if (!num_codepoints_declared) return 1.0f;
+    return (float)num_codepoints_committed / (float)num_codepoints_declared;
+}
+
+bool is_glyph_prerasterization_done() {
+    return num_codepoints_committed == num_codepoints_declared;
+}
+
+void begin_font_frame() {
+    last_frame_stats = current_frame_stats;
+    current_frame_stats = {};
+
+    font_frame_index++;
+    evict_fonts_over_budget();
+
+    commit_prerasterized_glyphs();
+    flush_font_uploads();
+}
+
+Font_Frame_Stats get_font_frame_stats() {
+    return last_frame_stats;
+}
@@ -3,6 +3,8 @@
 
 #include "geometry.h"
 #include "hash_table.h"
+#include "array.h"
+#include "atom.h"
 
 struct Texture_Map;
 
@@ -15,24 +17,89 @@ struct Glyph {
     Texture_Map *map;
 };
 
+// One atlas texture. Glyphs are rasterized into 'pixels', a CPU mirror of 'map',
+// and the touched areas are uploaded in batches by flush_font_uploads(). The
+// mirror is freed once the page fills up and a new page takes over.
+struct Font_Page {
+    Texture_Map *map;
+    u8 *pixels;
+    Array <Rectangle2i> dirty_rects;
+    bool is_queued_for_flush;
+};
+
+struct Font_Frame_Stats {
+    int glyphs_rasterized;
+    int num_uploads;
+    s64 bytes_uploaded;
+};
+
 struct Font {
     char *full_path;
-    char *short_name;
+    Atom name;
 
     struct FT_FaceRec_ *face;
     Hash_Table <int, Glyph> glyphs;
     int character_height;
 
+    // Codepoint -> glyph index. Latin-1 is direct-indexed and filled when the
+    // face loads, everything above that is cached in the hash on first use.
+    u32 latin1_glyph_indices[256];
+    Hash_Table <int, u32> glyph_indices;
+
+    // Kerning in pixels keyed by (left glyph index << 16) | right glyph index.
+    // All non-zero Latin-1 pairs are precomputed at load time, other pairs are
+    // added (zeros included) the first time they are asked for.
+    Hash_Table <u32, int> kerning_pairs;
     bool has_kerning;
 
     int bx, by, bw, bh;
-    Texture_Map *map;
+    Array <Font_Page *> pages;
+
+    // Font cache bookkeeping, see get_font_at_size.
+    u64 cache_key;
+    Font *lru_prev;
+    Font *lru_next;
+    u64 last_used_frame;
+    int num_pending_prerasterize_jobs;
+};
+
+struct Glyph_Range {
+    int first_codepoint;
+    int last_codepoint;
+};
+
+const Glyph_Range GLYPH_RANGES_LATIN[] = {
+    { 0x0020, 0x007e }, // Basic Latin
+    { 0x00a0, 0x00ff }, // Latin-1 Supplement
+    { 0x0100, 0x017f }, // Latin Extended-A
 };
 
 Font *load_font(char *short_name, int size);
+// Fonts are cached per (name, size). When the cache is over its byte budget
+// the least recently used fonts are evicted at the next miss or frame start,
+// so a Font * is only guaranteed to stay valid for the frame it was fetched in.
+Font *get_font_at_size(Atom name, int size);
 Font *get_font_at_size(char *short_name, int size);
+void set_font_cache_budget(s64 num_bytes);
+s64 get_font_cache_size_in_bytes();
+int get_num_cached_fonts();
+u32 get_glyph_index(Font *font, int codepoint);
 Glyph *get_or_load_glyph(Font *font, int codepoint);
 int get_kerning_in_pixels(Font *font, int codepoint, int next_codepoint);
 int get_string_width_in_pixels(Font *font, char *text);
 
+// Rasterizes every codepoint in the ranges on the job workers and commits the
+// results to the font's atlas a few batches per frame (see begin_font_frame).
+// Glyphs drawn before their batch lands are loaded on demand as usual.
+void prerasterize_glyphs(Atom name, int size, const Glyph_Range *ranges, int num_ranges);
+
+// From 0 to 1 over every codepoint declared so far. The menu shows it until
+// it's done.
+float get_glyph_prerasterization_progress();
+bool is_glyph_prerasterization_done();
+
+void flush_font_uploads();
+void begin_font_frame();
+Font_Frame_Stats get_font_frame_stats();
+
 #endif
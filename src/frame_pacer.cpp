@@ -0,0 +1,154 @@
+#include "frame_pacer.h"
+
+#include "os.h"
+
+#include <math.h>
+#include <emmintrin.h>
+
+struct Paced_Frame {
+    f64 interval;
+    f64 start_error;
+    f64 spin_time;
+};
+
+static f64 target_interval;
+static bool just_in_time;
+
+static f64 next_slot_start; // Zero until the first limited frame.
+static f64 last_start_time;
+static f64 predicted_work;
+
+// Starts as a guess; wait_until keeps it up to date.
+static f64 sleep_overshoot = 0.002;
+
+static Paced_Frame history[FRAME_PACING_HISTORY];
+static u64 num_frames;
+
+void set_frame_rate_limit(f64 frames_per_second) {
+    f64 interval = (frames_per_second > 0.0) ? 1.0 / frames_per_second : 0.0;
+    if (interval == target_interval) return;
+
+    target_interval = interval;
+    next_slot_start = 0.0;
+}
+
+void set_just_in_time_pacing(bool enabled) {
+    just_in_time = enabled;
+}
+
+// Returns how long it spun.
+static f64 wait_until(f64 deadline) {
+    f64 now = os_get_time();
+
+    // Whole milliseconds of sleep, as long as a wake as late as recent ones
+    // still lands before the deadline.
+    while (deadline - now > sleep_overshoot + 0.001) {
+        u32 milliseconds = (u32)((deadline - now - sleep_overshoot) * 1000.0);
+        if (!milliseconds) break;
+
+        os_sleep(milliseconds);
+
+        f64 woke = os_get_time();
+        f64 overshoot = (woke - now) - milliseconds / 1000.0;
+        now = woke;
+
+        // Quick to grow, slow to shrink: one late wake is a missed deadline,
+        // a few too many spins are only a little CPU.
+        if (overshoot > sleep_overshoot) {
+            sleep_overshoot = overshoot;
+        } else {
+            sleep_overshoot = Max(sleep_overshoot + (overshoot - sleep_overshoot) * 0.05, 0.0002);
+        }
+    }
+
+    f64 spin_start = now;
+    while (now < deadline) {
+        _mm_pause();
+        now = os_get_time();
+    }
+
+    return now - spin_start;
+}
+
+void wait_for_frame_start() {
+    f64 now = os_get_time();
+    f64 deadline = now;
+    f64 spin_time = 0.0;
+
+    if (target_interval) {
+        // The first frame, or one more than a whole slot late, starts the
+        // schedule over from now instead of rushing frames out to catch up.
+        if (!next_slot_start || now - next_slot_start > target_interval) {
+            next_slot_start = now;
+        }
+
+        deadline = next_slot_start;
+        if (just_in_time) {
+            f64 lead = Min(predicted_work + JUST_IN_TIME_SAFETY_MARGIN, target_interval);
+            deadline = next_slot_start + target_interval - lead;
+        }
+
+        if (deadline > now) spin_time = wait_until(deadline);
+        next_slot_start += target_interval;
+
+        now = os_get_time();
+    }
+
+    if (last_start_time) {
+        Paced_Frame *frame = &history[num_frames & (FRAME_PACING_HISTORY - 1)];
+        frame->interval = now - last_start_time;
+        frame->start_error = now - deadline;
+        frame->spin_time = spin_time;
+        num_frames++;
+    }
+
+    last_start_time = now;
+}
+
+void end_paced_frame() {
+    f64 work = os_get_time() - last_start_time;
+
+    // Follows the slowest recent frames, so a frame a little slower than
+    // usual doesn't start too late to make its slot.
+    if (work > predicted_work) {
+        predicted_work = work;
+    } else {
+        predicted_work += (work - predicted_work) * 0.02;
+    }
+}
+
+Frame_Pacing_Stats get_frame_pacing_stats() {
+    Frame_Pacing_Stats stats = {};
+    stats.target_interval = target_interval;
+    stats.just_in_time = just_in_time;
+    stats.predicted_work = predicted_work;
+    stats.sleep_overshoot = sleep_overshoot;
+
+    int count = (int)Min(num_frames, (u64)FRAME_PACING_HISTORY);
+    if (!count) return stats;
+
+    f64 interval_sum = 0.0;
+    f64 error_sum = 0.0;
+    f64 spin_sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        Paced_Frame *frame = &history[i];
+        interval_sum += frame->interval;
+        error_sum += frame->start_error;
+        spin_sum += frame->spin_time;
+        stats.max_start_error = Max(stats.max_start_error, frame->start_error);
+    }
+
+    stats.num_frames = count;
+    stats.average_interval = interval_sum / count;
+    stats.average_start_error = error_sum / count;
+    stats.average_spin_time = spin_sum / count;
+
+    f64 variance = 0.0;
+    for (int i = 0; i < count; i++) {
+        f64 difference = history[i].interval - stats.average_interval;
+        variance += difference * difference;
+    }
+    stats.interval_jitter = sqrt(variance / count);
+
+    return stats;
+}
@@ -0,0 +1,54 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "general.h"
+
+// Holds the main loop to a target frame rate. Waiting sleeps while the
+// deadline is far off and spins on os_get_time for the last stretch, since
+// sleeps wake late by an amount that varies. How long to spin follows how
+// late sleeps have actually been waking.
+//
+// In just-in-time mode the wait moves from the start of a frame's slot to
+// as late as it can be: the frame starts a predicted frame's worth of work
+// before its slot ends. Input is then read as late as possible, which cuts
+// input-to-present latency by up to a whole frame when there's slack. The
+// prediction follows the slowest recent frames and decays slowly.
+
+const int FRAME_PACING_HISTORY = 256; // Power of two.
+
+// Extra lead in just-in-time mode, on top of the predicted work.
+const f64 JUST_IN_TIME_SAFETY_MARGIN = 0.001;
+
+struct Frame_Pacing_Stats {
+    f64 target_interval; // Zero when unlimited.
+    bool just_in_time;
+
+    // Over the frames in the history. Start error is how late each frame
+    // actually started against its deadline; interval jitter is the
+    // standard deviation of the time between frame starts.
+    int num_frames;
+    f64 average_interval;
+    f64 interval_jitter;
+    f64 average_start_error;
+    f64 max_start_error;
+
+    f64 average_spin_time;    // CPU spent spinning per frame.
+    f64 predicted_work;       // Input to present, as just-in-time mode sees it.
+    f64 sleep_overshoot;      // How late sleeps are waking, as of now.
+};
+
+// Zero or less turns the limit off. Cheap to call every frame; the schedule
+// only starts over when the limit changes.
+void set_frame_rate_limit(f64 frames_per_second);
+void set_just_in_time_pacing(bool enabled);
+
+// Start of a frame, before input is read. Waits until the frame should
+// start and returns then.
+void wait_for_frame_start();
+
+// After the frame is presented.
+void end_paced_frame();
+
+Frame_Pacing_Stats get_frame_pacing_stats();
+
+#endif
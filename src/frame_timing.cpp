@@ -0,0 +1,120 @@
+#include "frame_timing.h"
+
+#include "os.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static Frame_Time history[FRAME_TIMING_HISTORY];
+static u64 num_frames;
+
+static Frame_Time current_frame;
+static f64 frame_start_time;
+static f64 phase_start_times[NUM_FRAME_PHASES];
+
+// Running average for the hitch test; a frame only counts against the
+// frames before it.
+static f64 average_frame_time;
+static s64 total_hitches;
+
+void begin_frame_timing() {
+    f64 now = os_get_time();
+
+    if (frame_start_time) {
+        current_frame.total = (f32)(now - frame_start_time);
+
+        if (average_frame_time) {
+            current_frame.is_hitch = current_frame.total > FRAME_HITCH_FACTOR * average_frame_time;
+            average_frame_time += (current_frame.total - average_frame_time) * 0.05;
+        } else {
+            average_frame_time = current_frame.total;
+        }
+        if (current_frame.is_hitch) total_hitches++;
+
+        current_frame.frame_number = num_frames;
+        history[num_frames & (FRAME_TIMING_HISTORY - 1)] = current_frame;
+        num_frames++;
+    }
+
+    current_frame = {};
+    frame_start_time = now;
+}
+
+void begin_frame_phase(Frame_Phase phase) {
+    phase_start_times[phase] = os_get_time();
+}
+
+void end_frame_phase(Frame_Phase phase) {
+    // A phase can run more than once in a frame; the times add up.
+    current_frame.phases[phase] += (f32)(os_get_time() - phase_start_times[phase]);
+}
+
+static int compare_f32(const void *a, const void *b) {
+    f32 value_a = *(f32 *)a;
+    f32 value_b = *(f32 *)b;
+    return (value_a < value_b) ? -1 : (value_a > value_b) ? 1 : 0;
+}
+
+static f64 get_percentile(f32 *sorted, int count, int percent) {
+    int rank = (count * percent + 99) / 100;
+    return sorted[Max(rank, 1) - 1];
+}
+
+Frame_Time_Stats get_frame_time_stats() {
+    Frame_Time_Stats stats = {};
+    stats.total_hitches = total_hitches;
+
+    int count = (int)Min(num_frames, (u64)FRAME_TIMING_HISTORY);
+    if (!count) return stats;
+
+    f32 sorted[FRAME_TIMING_HISTORY];
+    f64 sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        Frame_Time *frame = &history[i];
+        sorted[i] = frame->total;
+        sum += frame->total;
+        if (frame->is_hitch) stats.num_hitches++;
+    }
+
+    qsort(sorted, count, sizeof(f32), compare_f32);
+
+    stats.num_frames = count;
+    stats.min = sorted[0];
+    stats.average = sum / count;
+    stats.p50 = get_percentile(sorted, count, 50);
+    stats.p95 = get_percentile(sorted, count, 95);
+    stats.p99 = get_percentile(sorted, count, 99);
+    stats.max = sorted[count - 1];
+    return stats;
+}
+
+int get_frame_times(Frame_Time *frames, int max_frames) {
+    int count = (int)Min(num_frames, (u64)Min(max_frames, FRAME_TIMING_HISTORY));
+    for (int i = 0; i < count; i++) {
+        frames[i] = history[(num_frames - count + i) & (FRAME_TIMING_HISTORY - 1)];
+    }
+
+    return count;
+}
+
+bool write_frame_times_csv(char *file_path) {
+    FILE *file = fopen(file_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s' for writing.\n", file_path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    Frame_Time frames[FRAME_TIMING_HISTORY];
+    int count = get_frame_times(frames, FRAME_TIMING_HISTORY);
+
+    fprintf(file, "frame,total_ms,simulate_ms,draw_ms,present_ms,wait_ms,hitch\n");
+    for (int i = 0; i < count; i++) {
+        Frame_Time *frame = &frames[i];
+        fprintf(file, "%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%d\n", (unsigned long long)frame->frame_number, frame->total * 1000.0,
+                frame->phases[FRAME_PHASE_SIMULATE] * 1000.0, frame->phases[FRAME_PHASE_DRAW] * 1000.0,
+                frame->phases[FRAME_PHASE_PRESENT] * 1000.0, frame->phases[FRAME_PHASE_WAIT] * 1000.0, frame->is_hitch ? 1 : 0);
+    }
+
+    return true;
+}
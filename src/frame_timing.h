@@ -0,0 +1,63 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include "general.h"
+
+// CPU time of the last FRAME_TIMING_HISTORY frames, each split into the
+// phases below. A frame runs from one begin_frame_timing to the next, so its
+// total also covers whatever falls between the phases.
+//
+// A frame is a hitch when it takes more than FRAME_HITCH_FACTOR times the
+// running average of the frames before it.
+
+const int FRAME_TIMING_HISTORY = 1024; // Power of two.
+const f64 FRAME_HITCH_FACTOR = 2.0;
+
+enum Frame_Phase {
+    FRAME_PHASE_SIMULATE,
+    FRAME_PHASE_DRAW,
+    FRAME_PHASE_PRESENT,
+    FRAME_PHASE_WAIT, // Held back by the frame pacer.
+
+    NUM_FRAME_PHASES,
+};
+
+struct Frame_Time {
+    u64 frame_number;
+    f32 total; // Seconds.
+    f32 phases[NUM_FRAME_PHASES];
+    bool is_hitch;
+};
+
+// Over the frames still in the history. Times are in seconds; percentiles
+// are nearest rank.
+struct Frame_Time_Stats {
+    int num_frames;
+
+    f64 min;
+    f64 average;
+    f64 p50;
+    f64 p95;
+    f64 p99;
+    f64 max;
+
+    int num_hitches;
+    s64 total_hitches; // Since startup.
+};
+
+// Main thread only, once per pass of the main loop. Ends the previous frame.
+void begin_frame_timing();
+
+void begin_frame_phase(Frame_Phase phase);
+void end_frame_phase(Frame_Phase phase);
+
+Frame_Time_Stats get_frame_time_stats();
+
+// Copies up to 'max_frames' of the newest frames, oldest first, and returns
+// how many were copied.
+int get_frame_times(Frame_Time *frames, int max_frames);
+
+// One row per frame in the history, times in milliseconds.
+bool write_frame_times_csv(char *file_path);
+
+#endif
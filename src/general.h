@@ -5,6 +5,9 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#include <stb_sprintf.h>
 
 typedef uint64_t u64;
 typedef uint32_t u32;
@@ -52,6 +55,58 @@ class ExitScopeHelp {
 
 const float PI = 3.14159265359f;
 
+// Allocators are a proc plus an opaque data pointer, so containers can be handed
+// a heap, an arena or a pool at runtime without becoming a different type.
+// RESIZE must preserve the first min(old_size, size) bytes. A null proc means
+// the heap.
+
+enum Allocator_Mode {
+    ALLOCATOR_ALLOCATE,
+    ALLOCATOR_RESIZE,
+    ALLOCATOR_FREE,
+};
+
+typedef void *(*Allocator_Proc)(Allocator_Mode mode, s64 size, s64 old_size, void *old_memory, void *allocator_data);
+
+struct Allocator {
+    Allocator_Proc proc = nullptr;
+    void *data = nullptr;
+};
+
+// Defined next to the global operator new replacement in main.cpp. Every heap
+// allocation the game makes goes through one of the two, so the per-frame count
+// catches anything that sneaks into the steady-state loop.
+void count_heap_allocation();
+
+inline void *heap_allocator_proc(Allocator_Mode mode, s64 size, s64 old_size, void *old_memory, void *allocator_data) {
+    if (mode != ALLOCATOR_FREE) count_heap_allocation();
+
+    switch (mode) {
+        case ALLOCATOR_ALLOCATE: return malloc(size);
+        case ALLOCATOR_RESIZE:   return realloc(old_memory, size);
+        case ALLOCATOR_FREE:     free(old_memory); return nullptr;
+    }
+
+    return nullptr;
+}
+
+inline Allocator_Proc get_allocator_proc(Allocator allocator) {
+    return allocator.proc ? allocator.proc : heap_allocator_proc;
+}
+
+inline void *allocate(Allocator allocator, s64 size) {
+    return get_allocator_proc(allocator)(ALLOCATOR_ALLOCATE, size, 0, nullptr, allocator.data);
+}
+
+inline void *reallocate(Allocator allocator, void *memory, s64 old_size, s64 size) {
+    return get_allocator_proc(allocator)(ALLOCATOR_RESIZE, size, old_size, memory, allocator.data);
+}
+
+inline void deallocate(Allocator allocator, void *memory) {
+    if (!memory) return;
+    get_allocator_proc(allocator)(ALLOCATOR_FREE, 0, 0, memory, allocator.data);
+}
+
 inline int get_string_length(char *a) {
     if (!a) return 0;
     
@@ -90,6 +145,16 @@ inline void Clamp(int *value, int min, int max) {
     else if (*value > max) *value = max;
 }
 
+template <typename T>
+inline T Min(T a, T b) {
+    return (a < b) ? a : b;
+}
+
+template <typename T>
+inline T Max(T a, T b) {
+    return (a > b) ? a : b;
+}
+
 inline char *find_character_from_right(char *s, char c) {
     return strrchr(s, c);
 }
@@ -280,6 +345,134 @@ inline int get_codepoint(char *text, int *bytes_processed) {
     return code;
 }
 
+// Linear arena. Allocation is a pointer bump, individual frees are no-ops and
+// everything goes away at once on reset. If the block runs out, allocations
+// spill to the heap until the next reset; those show up in the heap counter, so
+// an undersized arena is visible rather than fatal.
+//
+// Temporary scopes use a mark:
+//
+//     Arena_Mark mark = get_arena_mark(&frame_arena);
+//     defer { rewind_arena(&frame_arena, mark); };
+//
+// Rewinding only reclaims space from the main block; spilled allocations live
+// until reset.
+
+const s64 ARENA_OVERFLOW_HEADER_SIZE = 16;
+
+struct Arena_Overflow_Block {
+    Arena_Overflow_Block *next;
+};
+
+struct Arena {
+    u8 *memory = nullptr;
+    s64 size = 0;
+    s64 used = 0;
+    s64 high_water_mark = 0;
+
+    void *last_allocation = nullptr;
+    Arena_Overflow_Block *overflow = nullptr;
+};
+
+struct Arena_Mark {
+    s64 used;
+};
+
+inline void init_arena(Arena *arena, s64 size) {
+    arena->memory = (u8 *)malloc(size);
+    arena->size = arena->memory ? size : 0;
+    arena->used = 0;
+}
+
+inline void *arena_push(Arena *arena, s64 size, s64 alignment = 16) {
+    s64 start = (arena->used + alignment - 1) & ~(alignment - 1);
+
+    void *result;
+    if (start + size <= arena->size) {
+        result = arena->memory + start;
+        arena->used = start + size;
+        if (arena->used > arena->high_water_mark) arena->high_water_mark = arena->used;
+    } else {
+        assert(alignment <= ARENA_OVERFLOW_HEADER_SIZE);
+
+        count_heap_allocation();
+        Arena_Overflow_Block *block = (Arena_Overflow_Block *)malloc(ARENA_OVERFLOW_HEADER_SIZE + size);
+        if (!block) return nullptr;
+
+        block->next = arena->overflow;
+        arena->overflow = block;
+        result = (u8 *)block + ARENA_OVERFLOW_HEADER_SIZE;
+    }
+
+    arena->last_allocation = result;
+    return result;
+}
+
+inline Arena_Mark get_arena_mark(Arena *arena) {
+    Arena_Mark result;
+    result.used = arena->used;
+    return result;
+}
+
+inline void rewind_arena(Arena *arena, Arena_Mark mark) {
+    assert(mark.used <= arena->used);
+
+    arena->used = mark.used;
+    arena->last_allocation = nullptr;
+}
+
+inline void reset_arena(Arena *arena) {
+    Arena_Overflow_Block *block = arena->overflow;
+    while (block) {
+        Arena_Overflow_Block *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->overflow = nullptr;
+    arena->used = 0;
+    arena->last_allocation = nullptr;
+}
+
+inline void *arena_allocator_proc(Allocator_Mode mode, s64 size, s64 old_size, void *old_memory, void *allocator_data) {
+    Arena *arena = (Arena *)allocator_data;
+
+    switch (mode) {
+        case ALLOCATOR_ALLOCATE: return arena_push(arena, size);
+        case ALLOCATOR_RESIZE: {
+            // The most recent allocation in the main block can grow in place.
+            u8 *old = (u8 *)old_memory;
+            if (old && old == arena->last_allocation && old >= arena->memory && old < arena->memory + arena->size) {
+                s64 start = old - arena->memory;
+                if (start + size <= arena->size) {
+                    arena->used = start + size;
+                    if (arena->used > arena->high_water_mark) arena->high_water_mark = arena->used;
+                    return old_memory;
+                }
+            }
+
+            void *result = arena_push(arena, size);
+            if (result && old_memory) memcpy(result, old_memory, Min(old_size, size));
+            return result;
+        }
+        case ALLOCATOR_FREE: return nullptr;
+    }
+
+    return nullptr;
+}
+
+inline Allocator make_arena_allocator(Arena *arena) {
+    Allocator result;
+    result.proc = arena_allocator_proc;
+    result.data = arena;
+    return result;
+}
+
+// Transient storage for the current frame, reset right after swap_buffers.
+// Main thread only.
+const s64 FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+extern Arena frame_arena;
+
 // Copy-paste from https://github.com/dwilliamson/GDMagArchive/blob/master/jan04_novideo/blow/Lerp%201%20(January%202004)/mprintf.h
 const int MPRINTF_INITIAL_GUESS = 256;
 
@@ -294,7 +487,7 @@ inline char *mprintf(char *fmt, ...) {
 		va_list ap;
 		va_start(ap, fmt);
 
-		int len = vsnprintf(res, size, fmt, ap);
+		int len = stbsp_vsnprintf(res, size, fmt, ap);
 		va_end(ap);
 
 		if ((len >= 0) && (size >= len + 1)) {
@@ -318,9 +511,9 @@ inline char *mprintf_valist(char *fmt, va_list ap_orig) {
 		if (!res) return NULL;
 
 		va_list ap;
-        ap = ap_orig;
+		va_copy(ap, ap_orig);
 
-		int len = vsnprintf(res, size, fmt, ap);
+		int len = stbsp_vsnprintf(res, size, fmt, ap);
 		va_end(ap);
 
 		if ((len >= 0) && (size >= len + 1)) {
@@ -347,7 +540,7 @@ inline char *mprintf(int size, char *fmt, ...) {
 		va_list ap;
 		va_start(ap, fmt);
 
-		int len = vsnprintf(res, size, fmt, ap);
+		int len = stbsp_vsnprintf(res, size, fmt, ap);
 		va_end(ap);
 
 		if ((len >= 0) && (size >= len + 1)) {
@@ -362,6 +555,50 @@ inline char *mprintf(int size, char *fmt, ...) {
     return res;
 }
 
+// Formats straight into an arena: the first attempt writes into whatever room
+// is left at the top of the block and only re-formats if it didn't fit.
+inline char *aprintf_valist(Arena *arena, char *fmt, va_list ap) {
+    s64 available = arena->memory ? Min<s64>(arena->size - arena->used, 0x7fffffff) : 0;
+    char *dest = arena->memory ? (char *)(arena->memory + arena->used) : nullptr;
+
+    va_list ap_first;
+    va_copy(ap_first, ap);
+    int len = stbsp_vsnprintf(dest, (int)available, fmt, ap_first);
+    va_end(ap_first);
+
+    if (len < 0) return nullptr;
+
+    if (len + 1 <= available) {
+        return (char *)arena_push(arena, len + 1, 1);
+    }
+
+    char *result = (char *)arena_push(arena, len + 1, 1);
+    if (!result) return nullptr;
+
+    stbsp_vsnprintf(result, len + 1, fmt, ap);
+    return result;
+}
+
+inline char *aprintf(Arena *arena, char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char *result = aprintf_valist(arena, fmt, ap);
+    va_end(ap);
+
+    return result;
+}
+
+// Frame-lifetime formatted string. Don't free it and don't keep it past the end
+// of the frame.
+inline char *tprint(char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char *result = aprintf_valist(&frame_arena, fmt, ap);
+    va_end(ap);
+
+    return result;
+}
+
 extern double global_time_rate;
 
 struct Time_Info {
@@ -373,6 +610,11 @@ struct Time_Info {
 
     float real_world_time = 0.0f;
     float real_world_dt = 0.0f;
+
+    // The game simulates in fixed ticks of simulation_dt. simulation_alpha
+    // is how far this frame is between the last tick and the next one.
+    float simulation_dt = 0.0f;
+    float simulation_alpha = 0.0f;
 };
 
 enum Program_Mode {
@@ -385,6 +627,9 @@ struct Globals {
     char *operating_folder;
     Time_Info time_info;
     Program_Mode program_mode = PROGRAM_MODE_GAME;
+
+    int heap_allocations_last_frame;
+    int simulation_ticks_last_frame;
 };
 
 extern Globals globals;
@@ -224,6 +224,10 @@ inline Vector3 cross_product(Vector3 a, Vector3 b) {
     return result;
 }
 
+inline Vector3 lerp(Vector3 a, Vector3 b, float t) {
+    return a * (1.0f - t) + b * t;
+}
+
 union Vector4 {
     struct { f32 x, y, z, w; };
     struct { f32 r, g, b, a; };
@@ -361,6 +365,26 @@ inline Matrix4 make_z_rotation(f32 t) {
     return result;
 }
 
+// Uniform scale, then rotation about x, y and z in degrees, then translation.
+inline Matrix4 make_object_to_world_matrix(Vector3 position, Vector3 rotation, f32 scale) {
+    Matrix4 m = matrix4_identity();
+
+    m._11 = scale;
+    m._22 = scale;
+    m._33 = scale;
+
+    m._14 = position.x;
+    m._24 = position.y;
+    m._34 = position.z;
+    
+    Matrix4 rot_x = make_x_rotation(rotation.x * (PI / 180.0f));
+    Matrix4 rot_y = make_y_rotation(rotation.y * (PI / 180.0f));
+    Matrix4 rot_z = make_z_rotation(rotation.z * (PI / 180.0f));
+    Matrix4 r = rot_x * rot_y * rot_z;
+    
+    return m * r;
+}
+
 inline Matrix4 make_look_at_matrix(Vector3 position, Vector3 target, Vector3 world_up) {
     Vector3 z_axis = normalize_or_zero(position - target);
     Vector3 x_axis = normalize_or_zero(cross_product(normalize_or_zero(world_up), z_axis));
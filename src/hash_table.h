@@ -3,25 +3,80 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <emmintrin.h>
 
-static int hash(int x) {
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "general.h"
+#include "memory_tags.h"
+
+inline int hash(int x) {
     x = ((x >> 16) ^ x) * 0x45d9f3b;
     x = ((x >> 16) ^ x) * 0x45d9f3b;
     x = (x >> 16) ^ x;
     return x;
 }
 
-static int hash(char *str) {
-    int hash = 5381;
+inline int hash(u32 x) {
+    return hash((int)x);
+}
 
-    extern int get_string_length(char *str);
-    int len = get_string_length(str);
-    for (int i = 0; i < len; i++) {
-        hash = ((hash << 5) + hash) + str[i];
+inline int hash(u64 x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x = x ^ (x >> 31);
+    return (int)x;
+}
+
+inline int hash(char *str) {
+    int hash = 5381;
+    for (char *at = str; *at; at++) {
+        hash = ((hash << 5) + hash) + *at;
     }
     return hash;
 }
 
+template <typename T>
+inline bool hash_keys_match(T a, T b) {
+    return a == b;
+}
+
+// char * keys compare as strings. The table only keeps the pointer, so the
+// caller has to keep the string alive for as long as it's in there.
+inline bool hash_keys_match(char *a, char *b) {
+    return strings_match(a, b);
+}
+
+inline int find_first_set_bit(u32 mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//
+// Open addressing in the style of SwissTable. Every slot has a control byte:
+// EMPTY, DELETED, or the low 7 bits of the key's hash when full. Slots are
+// probed a group of 16 at a time, comparing all 16 control bytes with one
+// SSE2 compare, and the remaining hash bits pick the first group. Lookups
+// stop at the first group that has an EMPTY slot in it.
+//
+
+const u8 HASH_CONTROL_EMPTY = 0x80;
+const u8 HASH_CONTROL_DELETED = 0xfe;
+const int HASH_GROUP_WIDTH = 16;
+const int HASH_TABLE_INITIAL_CAPACITY = 16;
+
+// Max load factor is 7/8, counting tombstones.
+inline int get_hash_table_max_load(int allocated) {
+    return allocated - allocated / 8;
+}
+
 template <typename Key, typename Value>
 struct Hash_Table {
     struct Bucket {
@@ -30,179 +85,199 @@ struct Hash_Table {
     };
 
     Bucket *buckets = nullptr;
-    bool *occupancy_mask = nullptr;
+    u8 *controls = nullptr;
     int allocated = 0;
     int count = 0;
+    int num_deleted = 0;
+
+    // Owners that want the table counted against their own subsystem swap this
+    // out before the first insert.
+    Allocator allocator = make_tagged_allocator(MEMORY_TAG_HASH_TABLE);
+
+    // Slots run from 0 to allocated - 1. To visit every entry:
+    //     for (int i = 0; i < table.allocated; i++) {
+    //         if (!table.is_slot_full(i)) continue;
+    //         ... table.buckets[i] ...
+    //     }
+    inline bool is_slot_full(int index) {
+        return !(controls[index] & 0x80);
+    }
 
-    inline void grow() {
-        const int HASH_TABLE_INITIAL_CAPACITY = 256;
+    inline s64 get_size_in_bytes() {
+        return (s64)allocated * (sizeof(Bucket) + sizeof(u8));
+    }
 
-        if (!buckets) {
-            assert(allocated == 0);
-            assert(count == 0);
-            
-            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
-            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
-            allocated = HASH_TABLE_INITIAL_CAPACITY;
-            count = 0;
-        } else {
-            Hash_Table <Key, Value> new_hash_table = {
-                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
-                (bool *)calloc(allocated * 2, sizeof(bool)),
-                allocated * 2,
-                0,
-            };
-
-            for (int i = 0; i < count; i++) {
-                if (occupancy_mask[i]) {
-                    new_hash_table.add(buckets[i].key, buckets[i].value);
-                }
+    inline int find_index(Key key) {
+        if (!buckets) return -1;
+        
+        u32 h = (u32)hash(key);
+        __m128i h2 = _mm_set1_epi8((char)(h & 0x7f));
+        __m128i empty = _mm_set1_epi8((char)HASH_CONTROL_EMPTY);
+
+        int group_mask = allocated / HASH_GROUP_WIDTH - 1;
+        int group = (h >> 7) & group_mask;
+        
+        for (int probe = 0; probe <= group_mask; probe++) {
+            u8 *group_controls = controls + group * HASH_GROUP_WIDTH;
+            __m128i ctrl = _mm_loadu_si128((__m128i *)group_controls);
+
+            u32 matches = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, h2));
+            while (matches) {
+                int index = group * HASH_GROUP_WIDTH + find_first_set_bit(matches);
+                if (hash_keys_match(buckets[index].key, key)) return index;
+                matches &= matches - 1;
             }
 
-            free(buckets);
-            free(occupancy_mask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, empty))) return -1;
 
-            *this = new_hash_table;
+            // Triangular probing visits every group when the count is a power of two.
+            group = (group + probe + 1) & group_mask;
         }
+
+        return -1;
     }
 
-    inline void add(Key key, Value value) {
-        if (count >= allocated) {
-            grow();
-        }
+    // Assumes the key is not in the table and there is room for it.
+    inline int insert_new(Key key, Value value) {
+        u32 h = (u32)hash(key);
 
-        auto hk = hash(key) & (allocated - 1);
-        while (occupancy_mask[hk] && buckets[hk].key != key) {
-            hk = (hk + 1) & (allocated - 1);
-        }
+        int group_mask = allocated / HASH_GROUP_WIDTH - 1;
+        int group = (h >> 7) & group_mask;
 
-        occupancy_mask[hk] = true;
-        buckets[hk].key = key;
-        buckets[hk].value = value;
-        count++;
-    }
+        for (int probe = 0; probe <= group_mask; probe++) {
+            u8 *group_controls = controls + group * HASH_GROUP_WIDTH;
+            __m128i ctrl = _mm_loadu_si128((__m128i *)group_controls);
 
-    inline Value *get(Key key) {
-        auto hk = hash(key) & (allocated - 1);
-        for (int i = 0; i < allocated && occupancy_mask[hk] && buckets[hk].key != key; i++) {
-            hk = (hk + 1) & (allocated - 1);
-        }
+            // EMPTY and DELETED both have the top bit set, full slots don't.
+            u32 free_slots = _mm_movemask_epi8(ctrl);
+            if (free_slots) {
+                int index = group * HASH_GROUP_WIDTH + find_first_set_bit(free_slots);
+                if (controls[index] == HASH_CONTROL_DELETED) num_deleted--;
 
-        if (buckets && occupancy_mask[hk] && buckets[hk].key == key) {
-            return &buckets[hk].value;
-        } else {
-            return nullptr;
+                controls[index] = (u8)(h & 0x7f);
+                buckets[index].key = key;
+                buckets[index].value = value;
+                count++;
+                return index;
+            }
+
+            group = (group + probe + 1) & group_mask;
         }
-    }
 
-    inline bool contains(Key key) {
-        return get(key);
+        assert(!"Hash_Table is full");
+        return -1;
     }
 
-    Value *operator[](Key key) {
-        {
-            Value *maybe_value = get(key);
-            if (!maybe_value) {
-                add(key, {});
-            } else {
-                return maybe_value;
+    inline void rehash(int new_allocated) {
+        assert(new_allocated >= HASH_GROUP_WIDTH);
+        assert((new_allocated & (new_allocated - 1)) == 0);
+        
+        Bucket *old_buckets = buckets;
+        u8 *old_controls = controls;
+        int old_allocated = allocated;
+
+        buckets = (Bucket *)allocate(allocator, (s64)new_allocated * sizeof(Bucket));
+        controls = (u8 *)allocate(allocator, new_allocated);
+        memset(buckets, 0, (s64)new_allocated * sizeof(Bucket));
+        memset(controls, HASH_CONTROL_EMPTY, new_allocated);
+        allocated = new_allocated;
+        count = 0;
+        num_deleted = 0;
+
+        for (int i = 0; i < old_allocated; i++) {
+            if (!(old_controls[i] & 0x80)) {
+                insert_new(old_buckets[i].key, old_buckets[i].value);
             }
         }
-        Value *maybe_value = get(key);
-        assert(maybe_value);
-        return maybe_value;
-    }
-};
 
-template <typename Value>
-struct String_Hash_Table {
-    struct Bucket {
-        char *key;
-        Value value;
-    };
+        deallocate(allocator, old_buckets);
+        deallocate(allocator, old_controls);
+    }
 
-    Bucket *buckets = nullptr;
-    bool *occupancy_mask = nullptr;
-    int allocated = 0;
-    int count = 0;
+    inline void reserve(int num_entries) {
+        int new_allocated = allocated ? allocated : HASH_TABLE_INITIAL_CAPACITY;
+        while (get_hash_table_max_load(new_allocated) < num_entries) {
+            new_allocated *= 2;
+        }
 
-    inline void grow() {
-        const int HASH_TABLE_INITIAL_CAPACITY = 256;
+        if (new_allocated > allocated) rehash(new_allocated);
+    }
 
+    inline void make_room_for_one_more() {
         if (!buckets) {
-            assert(allocated == 0);
-            assert(count == 0);
-            
-            buckets = (Bucket *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(Bucket));
-            occupancy_mask = (bool *)calloc(HASH_TABLE_INITIAL_CAPACITY, sizeof(bool));
-            allocated = HASH_TABLE_INITIAL_CAPACITY;
-            count = 0;
-        } else {
-            String_Hash_Table <Value> new_hash_table = {
-                (Bucket *)calloc(allocated * 2, sizeof(Bucket)),
-                (bool *)calloc(allocated * 2, sizeof(bool)),
-                allocated * 2,
-                0,
-            };
-
-            for (int i = 0; i < count; i++) {
-                if (occupancy_mask[i]) {
-                    new_hash_table.add(buckets[i].key, buckets[i].value);
-                }
-            }
-
-            free(buckets);
-            free(occupancy_mask);
+            rehash(HASH_TABLE_INITIAL_CAPACITY);
+            return;
+        }
+        
+        if (count + num_deleted + 1 <= get_hash_table_max_load(allocated)) return;
 
-            *this = new_hash_table;
+        // Mostly tombstones: clean them up in place instead of growing.
+        if (count + 1 <= get_hash_table_max_load(allocated) / 2) {
+            rehash(allocated);
+        } else {
+            rehash(allocated * 2);
         }
     }
 
-    inline void add(char *key, Value value) {
-        if (count >= allocated) {
-            grow();
+    inline void add(Key key, Value value) {
+        int index = find_index(key);
+        if (index >= 0) {
+            buckets[index].value = value;
+            return;
         }
 
-        auto hk = hash(key) & (allocated - 1);
-        while (occupancy_mask[hk] && !strings_match(buckets[hk].key, key)) {
-            hk = (hk + 1) & (allocated - 1);
-        }
+        make_room_for_one_more();
+        insert_new(key, value);
+    }
 
-        occupancy_mask[hk] = true;
-        buckets[hk].key = copy_string(key);
-        buckets[hk].value = value;
-        count++;
+    inline Value *get(Key key) {
+        int index = find_index(key);
+        if (index < 0) return nullptr;
+        return &buckets[index].value;
     }
 
-    inline Value *get(char *key) {
-        auto hk = hash(key) & (allocated - 1);
-        for (int i = 0; i < allocated && occupancy_mask[hk] && !strings_match(buckets[hk].key, key); i++) {
-            hk = (hk + 1) & (allocated - 1);
-        }
+    inline bool contains(Key key) {
+        return find_index(key) >= 0;
+    }
+
+    inline bool remove(Key key) {
+        int index = find_index(key);
+        if (index < 0) return false;
 
-        if (buckets && occupancy_mask[hk] && strings_match(buckets[hk].key, key)) {
-            return &buckets[hk].value;
+        // If this slot's group still has an EMPTY, no probe sequence has ever
+        // run past the group, so the slot can go straight back to EMPTY.
+        int group = index / HASH_GROUP_WIDTH;
+        __m128i ctrl = _mm_loadu_si128((__m128i *)(controls + group * HASH_GROUP_WIDTH));
+        bool group_has_empty = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)HASH_CONTROL_EMPTY))) != 0;
+
+        if (group_has_empty) {
+            controls[index] = HASH_CONTROL_EMPTY;
         } else {
-            return nullptr;
+            controls[index] = HASH_CONTROL_DELETED;
+            num_deleted++;
         }
+
+        count--;
+        return true;
     }
 
-    inline bool contains(char *key) {
-        return get(key);
+    inline void deinit() {
+        deallocate(allocator, buckets);
+        deallocate(allocator, controls);
+        buckets = nullptr;
+        controls = nullptr;
+        allocated = 0;
+        count = 0;
+        num_deleted = 0;
     }
 
-    Value *operator[](char *key) {
-        {
-            Value *maybe_value = get(key);
-            if (!maybe_value) {
-                add(key, {});
-            } else {
-                return maybe_value;
-            }
-        }
+    Value *operator[](Key key) {
         Value *maybe_value = get(key);
-        assert(maybe_value);
-        return maybe_value;
+        if (maybe_value) return maybe_value;
+
+        make_room_for_one_more();
+        int index = insert_new(key, {});
+        return &buckets[index].value;
     }
 };
 
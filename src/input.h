@@ -17,6 +17,9 @@ enum Key {
     
     KEY_SPACE,
     
+    KEY_F2,
+    KEY_F3,
+    KEY_F4,
     KEY_F11,
     KEY_ESCAPE,
     KEY_ENTER,
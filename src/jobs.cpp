@@ -0,0 +1,151 @@
+#include "jobs.h"
+
+#include "os.h"
+
+struct Job {
+    Job_Proc proc;
+    void *data;
+    Job_Counter *counter;
+};
+
+const int MAX_QUEUED_JOBS = 1024;
+
+// A job taken out of the middle by wait_for_counter leaves its slot behind
+// with a null proc, for pop_job to skip.
+struct Job_Queue {
+    Job jobs[MAX_QUEUED_JOBS];
+    int first;
+    int count;
+};
+
+static Job_Queue queues[NUM_JOB_PRIORITIES];
+
+static Mutex *queue_mutex;
+static Semaphore *queue_semaphore;
+
+static int num_workers;
+static thread_local int current_worker_index;
+
+// The oldest job of the most urgent priority that has any.
+static bool pop_job(Job *job) {
+    bool result = false;
+    
+    os_lock_mutex(queue_mutex);
+    for (int i = 0; i < NUM_JOB_PRIORITIES && !result; i++) {
+        Job_Queue *queue = &queues[i];
+        while (queue->count) {
+            Job *slot = &queue->jobs[queue->first];
+            queue->first = (queue->first + 1) % MAX_QUEUED_JOBS;
+            queue->count--;
+
+            if (slot->proc) {
+                *job = *slot;
+                result = true;
+                break;
+            }
+        }
+    }
+    os_unlock_mutex(queue_mutex);
+
+    return result;
+}
+
+static bool take_job_for_counter(Job_Counter *counter, Job *job) {
+    bool result = false;
+
+    os_lock_mutex(queue_mutex);
+    for (int i = 0; i < NUM_JOB_PRIORITIES && !result; i++) {
+        Job_Queue *queue = &queues[i];
+        for (int j = 0; j < queue->count; j++) {
+            Job *slot = &queue->jobs[(queue->first + j) % MAX_QUEUED_JOBS];
+            if (slot->proc && slot->counter == counter) {
+                *job = *slot;
+                slot->proc = nullptr;
+                result = true;
+                break;
+            }
+        }
+    }
+    os_unlock_mutex(queue_mutex);
+
+    return result;
+}
+
+static void run_job(Job job) {
+    job.proc(job.data, current_worker_index);
+    if (job.counter) os_atomic_add(&job.counter->remaining, -1);
+}
+
+static void worker_thread_proc(void *data) {
+    current_worker_index = (int)(s64)data;
+
+    while (true) {
+        os_wait_semaphore(queue_semaphore);
+
+        // The main thread may have taken this job while helping in
+        // wait_for_counter, in which case there is nothing left to do.
+        Job job;
+        if (pop_job(&job)) run_job(job);
+    }
+}
+
+void init_jobs() {
+    queue_mutex = os_create_mutex();
+    // The main thread can pop jobs without consuming a count, so the semaphore
+    // may briefly run ahead of the queue; give it plenty of headroom.
+    queue_semaphore = os_create_semaphore(0, 1 << 30);
+
+    // Leave one core for the main thread.
+    num_workers = Min(os_get_processor_count() - 1, MAX_JOB_WORKERS);
+    if (num_workers < 1) num_workers = 1;
+
+    current_worker_index = num_workers;
+    
+    for (int i = 0; i < num_workers; i++) {
+        os_create_thread(worker_thread_proc, (void *)(s64)i);
+    }
+}
+
+int get_num_job_workers() {
+    return num_workers;
+}
+
+int get_current_worker_index() {
+    return current_worker_index;
+}
+
+void add_job(Job_Proc proc, void *data, Job_Counter *counter, Job_Priority priority) {
+    Job job = { proc, data, counter };
+    if (counter) os_atomic_add(&counter->remaining, 1);
+
+    bool queued = false;
+    
+    os_lock_mutex(queue_mutex);
+    Job_Queue *queue = &queues[priority];
+    if (queue->count < MAX_QUEUED_JOBS) {
+        queue->jobs[(queue->first + queue->count) % MAX_QUEUED_JOBS] = job;
+        queue->count++;
+        queued = true;
+    }
+    os_unlock_mutex(queue_mutex);
+
+    if (queued) {
+        os_signal_semaphore(queue_semaphore);
+    } else {
+        run_job(job);
+    }
+}
+
+void wait_for_counter(Job_Counter *counter) {
+    // Running whatever is at the front of the queue could mean a texture
+    // decode in the middle of a frame; only this counter's own jobs are fair
+    // game.
+    while (counter->remaining > 0) {
+        Job job;
+        if (take_job_for_counter(counter, &job)) {
+            run_job(job);
+        } else {
+            os_sleep(0);
+        }
+    }
+}
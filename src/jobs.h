@@ -0,0 +1,39 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "general.h"
+
+// worker_index is in [0, MAX_JOB_WORKERS]. Each worker thread has its own
+// index and the main thread uses get_num_job_workers(), so per-worker state
+// can live in plain arrays without locking.
+typedef void (*Job_Proc)(void *data, int worker_index);
+
+const int MAX_JOB_WORKERS = 8;
+
+// Workers drain every frame job before they start on background work. Frame
+// jobs are what the current frame is waiting on; background jobs (texture
+// decodes, stream reads, glyphs) can take as many frames as they need.
+enum Job_Priority {
+    JOB_PRIORITY_FRAME,
+    JOB_PRIORITY_BACKGROUND,
+
+    NUM_JOB_PRIORITIES,
+};
+
+struct Job_Counter {
+    volatile s32 remaining = 0;
+};
+
+void init_jobs();
+int get_num_job_workers();
+int get_current_worker_index();
+
+// If a counter is given it is incremented now and decremented once the job
+// has run.
+void add_job(Job_Proc proc, void *data, Job_Counter *counter = nullptr, Job_Priority priority = JOB_PRIORITY_BACKGROUND);
+
+// Waits until the counter drops to zero. While it waits, the calling thread
+// runs queued jobs tied to this counter, and only those; otherwise it yields.
+void wait_for_counter(Job_Counter *counter);
+
+#endif
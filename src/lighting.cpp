@@ -0,0 +1,244 @@
+#include "lighting.h"
+
+#include <xmmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline int find_lowest_set_bit(u32 mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+f32 get_point_light_radius(Vector3 color, Vector3 attenuation) {
+    // Brightness falls off as color / (c + l*d + q*d^2); solve for where the
+    // brightest channel gets down to 1/256.
+    f32 brightest = Max(color.x, Max(color.y, color.z));
+    f32 c = attenuation.x - brightest * 256.0f;
+    f32 l = attenuation.y;
+    f32 q = attenuation.z;
+
+    // Too dim to see even up close.
+    if (c >= 0.0f) return 0.0f;
+
+    f32 result = MAX_POINT_LIGHT_RADIUS;
+    if (q > 0.0f) {
+        result = (-l + sqrtf(l*l - 4.0f*q*c)) / (2.0f*q);
+    } else if (l > 0.0f) {
+        result = -c / l;
+    }
+
+    return Min(result, MAX_POINT_LIGHT_RADIUS);
+}
+
+//
+// Cluster boxes
+//
+
+static int get_slice(Light_Cluster_Constants *constants, f32 depth) {
+    if (depth < constants->first_slice_depth) return 0;
+
+    int slice = 1 + (int)(log2f(depth / constants->first_slice_depth) * constants->slices_per_log2_depth);
+    return Min(slice, LIGHT_CLUSTERS_Z - 1);
+}
+
+static f32 get_slice_start(Light_Cluster_Constants *constants, int slice, f32 z_near) {
+    if (slice == 0) return z_near;
+    return constants->first_slice_depth * exp2f((slice - 1) / constants->slices_per_log2_depth);
+}
+
+// A cluster is the part of a screen tile between two depths, so its corners
+// are the tile's corners in NDC pushed out to both depths.
+static void build_cluster_boxes(Light_Clusters *clusters, f32 p11, f32 p22, f32 z_near, f32 z_far) {
+    Light_Cluster_Constants *constants = &clusters->constants;
+
+    for (int z = 0; z < LIGHT_CLUSTERS_Z; z++) {
+        f32 d0 = get_slice_start(constants, z, z_near);
+        f32 d1 = (z + 1 < LIGHT_CLUSTERS_Z) ? get_slice_start(constants, z + 1, z_near) : z_far;
+
+        for (int y = 0; y < LIGHT_CLUSTERS_Y; y++) {
+            f32 top = 1.0f - 2.0f * y / LIGHT_CLUSTERS_Y;
+            f32 bottom = 1.0f - 2.0f * (y + 1) / LIGHT_CLUSTERS_Y;
+
+            for (int x = 0; x < LIGHT_CLUSTERS_X; x++) {
+                f32 left = -1.0f + 2.0f * x / LIGHT_CLUSTERS_X;
+                f32 right = -1.0f + 2.0f * (x + 1) / LIGHT_CLUSTERS_X;
+
+                int index = (z * LIGHT_CLUSTERS_Y + y) * LIGHT_CLUSTERS_X + x;
+                clusters->cluster_min[0][index] = Min(left * d0, left * d1) / p11;
+                clusters->cluster_max[0][index] = Max(right * d0, right * d1) / p11;
+                clusters->cluster_min[1][index] = Min(bottom * d0, bottom * d1) / p22;
+                clusters->cluster_max[1][index] = Max(top * d0, top * d1) / p22;
+                clusters->cluster_min[2][index] = d0;
+                clusters->cluster_max[2][index] = d1;
+            }
+        }
+    }
+}
+
+//
+// Binning
+//
+
+// Screen tiles a light can reach on one axis: the NDC range of the box around
+// it, between its nearest and farthest depth.
+static bool get_tile_range(f32 center, f32 radius, f32 scale, f32 near_depth, f32 far_depth, int num_tiles, bool flip, int *first, int *last) {
+    f32 low = center - radius;
+    f32 high = center + radius;
+    f32 ndc_low = scale * low / (low >= 0.0f ? far_depth : near_depth);
+    f32 ndc_high = scale * high / (high >= 0.0f ? near_depth : far_depth);
+    if (ndc_low > 1.0f || ndc_high < -1.0f) return false;
+
+    // Tiles in y count down from the top of the screen.
+    if (flip) {
+        f32 t = -ndc_low;
+        ndc_low = -ndc_high;
+        ndc_high = t;
+    }
+
+    *first = Max((int)floorf((ndc_low + 1.0f) * 0.5f * num_tiles), 0);
+    *last = Min((int)floorf((ndc_high + 1.0f) * 0.5f * num_tiles), num_tiles - 1);
+    return true;
+}
+
+void build_light_clusters(Light_Clusters *clusters, Point_Light *lights, int num_lights, Matrix4 world_to_view, Matrix4 view_to_proj, int render_target_width, int render_target_height) {
+    // The planes come back out of the projection, so this follows whatever
+    // make_perspective_projection was given.
+    f32 p11 = view_to_proj._11;
+    f32 p22 = view_to_proj._22;
+    f32 z_near = view_to_proj._34 / (view_to_proj._33 - 1.0f);
+    f32 z_far = view_to_proj._34 / (view_to_proj._33 + 1.0f);
+
+    Light_Cluster_Constants *constants = &clusters->constants;
+    constants->tiles_per_pixel_x = (f32)LIGHT_CLUSTERS_X / Max(render_target_width, 1);
+    constants->tiles_per_pixel_y = (f32)LIGHT_CLUSTERS_Y / Max(render_target_height, 1);
+    constants->first_slice_depth = Max(LIGHT_CLUSTER_FIRST_SLICE_DEPTH, z_near);
+    constants->slices_per_log2_depth = (LIGHT_CLUSTERS_Z - 1) / log2f(Max(z_far / constants->first_slice_depth, 2.0f));
+    constants->num_clusters_x = LIGHT_CLUSTERS_X;
+    constants->num_clusters_y = LIGHT_CLUSTERS_Y;
+    constants->num_clusters_z = LIGHT_CLUSTERS_Z;
+
+    f32 projection[4] = { p11, p22, z_near, z_far };
+    if (memcmp(projection, clusters->cluster_projection, sizeof(projection)) != 0) {
+        build_cluster_boxes(clusters, p11, p22, z_near, z_far);
+        memcpy(clusters->cluster_projection, projection, sizeof(projection));
+    }
+
+    Light_Clustering_Stats *stats = &clusters->stats;
+    *stats = {};
+    stats->num_lights = num_lights;
+    stats->num_lights_dropped = Max(num_lights - MAX_CLUSTERED_LIGHTS, 0);
+    num_lights = Min(num_lights, MAX_CLUSTERED_LIGHTS);
+
+    clusters->lights = lights;
+    clusters->num_lights = num_lights;
+    constants->num_lights = num_lights;
+
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    // One bit per light per cluster, so binning can go light by light and
+    // the lists still come out cluster by cluster.
+    int words_per_cluster = (num_lights + 31) / 32;
+    u32 *bits = (u32 *)arena_push(&frame_arena, (s64)NUM_LIGHT_CLUSTERS * words_per_cluster * sizeof(u32));
+    memset(bits, 0, (s64)NUM_LIGHT_CLUSTERS * words_per_cluster * sizeof(u32));
+
+    const __m128 lane_offsets = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int i = 0; i < num_lights; i++) {
+        Point_Light *light = &lights[i];
+        f32 radius = light->radius;
+        if (radius <= 0.0f) continue;
+
+        Vector3 p = light->position;
+        Matrix4 m = world_to_view;
+        f32 x = m._11 * p.x + m._12 * p.y + m._13 * p.z + m._14;
+        f32 y = m._21 * p.x + m._22 * p.y + m._23 * p.z + m._24;
+        f32 depth = -(m._31 * p.x + m._32 * p.y + m._33 * p.z + m._34);
+
+        f32 near_depth = Max(depth - radius, z_near);
+        f32 far_depth = Min(depth + radius, z_far);
+        if (near_depth > far_depth) continue;
+
+        int x0, x1, y0, y1;
+        if (!get_tile_range(x, radius, p11, near_depth, far_depth, LIGHT_CLUSTERS_X, false, &x0, &x1)) continue;
+        if (!get_tile_range(y, radius, p22, near_depth, far_depth, LIGHT_CLUSTERS_Y, true, &y0, &y1)) continue;
+        int z0 = get_slice(constants, near_depth);
+        int z1 = get_slice(constants, far_depth);
+
+        // The range is only a box around the sphere; test the clusters in it
+        // four at a time for the exact sphere against cluster box overlap.
+        __m128 center[3] = { _mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(depth) };
+        __m128 radius_squared = _mm_set1_ps(radius * radius);
+        __m128 first_x = _mm_set1_ps((f32)x0 - 0.5f);
+        __m128 last_x = _mm_set1_ps((f32)x1 + 0.5f);
+
+        u32 *light_bits = bits + i / 32;
+        u32 light_bit = 1u << (i % 32);
+        bool binned = false;
+
+        for (int cz = z0; cz <= z1; cz++) {
+            for (int cy = y0; cy <= y1; cy++) {
+                int row = (cz * LIGHT_CLUSTERS_Y + cy) * LIGHT_CLUSTERS_X;
+
+                for (int cx = x0 & ~3; cx <= x1; cx += 4) {
+                    int index = row + cx;
+
+                    __m128 distance_squared = zero;
+                    for (int axis = 0; axis < 3; axis++) {
+                        __m128 below = _mm_sub_ps(_mm_loadu_ps(clusters->cluster_min[axis] + index), center[axis]);
+                        __m128 above = _mm_sub_ps(center[axis], _mm_loadu_ps(clusters->cluster_max[axis] + index));
+                        __m128 outside = _mm_max_ps(_mm_max_ps(below, above), zero);
+                        distance_squared = _mm_add_ps(distance_squared, _mm_mul_ps(outside, outside));
+                    }
+
+                    __m128 lane_x = _mm_add_ps(_mm_set1_ps((f32)cx), lane_offsets);
+                    __m128 in_range = _mm_and_ps(_mm_cmpgt_ps(lane_x, first_x), _mm_cmplt_ps(lane_x, last_x));
+                    int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(distance_squared, radius_squared), in_range));
+
+                    while (mask) {
+                        int lane = find_lowest_set_bit((u32)mask);
+                        light_bits[(s64)(index + lane) * words_per_cluster] |= light_bit;
+                        mask &= mask - 1;
+                        binned = true;
+                    }
+                }
+            }
+        }
+
+        if (binned) stats->num_lights_binned++;
+    }
+
+    // Compact into one list. Lights stay in index order within a cluster.
+    int num_indices = 0;
+    for (int c = 0; c < NUM_LIGHT_CLUSTERS; c++) {
+        int first = num_indices;
+        u32 *cluster_bits = bits + (s64)c * words_per_cluster;
+
+        for (int w = 0; w < words_per_cluster; w++) {
+            u32 word = cluster_bits[w];
+            while (word) {
+                if (num_indices < MAX_CLUSTER_LIGHT_INDICES) {
+                    clusters->light_indices[num_indices++] = w * 32 + find_lowest_set_bit(word);
+                } else {
+                    stats->num_indices_dropped++;
+                }
+                word &= word - 1;
+            }
+        }
+
+        clusters->cluster_ranges[c * 2 + 0] = first;
+        clusters->cluster_ranges[c * 2 + 1] = num_indices - first;
+        stats->max_lights_in_cluster = Max(stats->max_lights_in_cluster, num_indices - first);
+    }
+
+    clusters->num_light_indices = num_indices;
+    stats->num_light_indices = num_indices;
+}
@@ -0,0 +1,95 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include "geometry.h"
+
+// Clustered forward lighting. The view frustum is cut into a grid of clusters:
+// LIGHT_CLUSTERS_X by LIGHT_CLUSTERS_Y tiles on screen, and LIGHT_CLUSTERS_Z
+// slices in depth that get thicker further away. Every frame the point lights
+// are binned into the clusters their spheres touch, and the shaders light a
+// pixel with only the lights in its cluster (see lighting.hlsli), so the cost
+// per pixel depends on how many lights overlap there, not on how many exist.
+//
+// Binning is CPU only and doesn't touch the renderer; upload the result with
+// set_light_clusters.
+
+const int LIGHT_CLUSTERS_X = 16;
+const int LIGHT_CLUSTERS_Y = 9;
+const int LIGHT_CLUSTERS_Z = 24;
+const int NUM_LIGHT_CLUSTERS = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z;
+
+// Slice 0 runs from the near plane to here, and the rest split the distance
+// from here to the far plane exponentially. Without it most of the slices
+// would go to the first few units in front of the camera.
+const f32 LIGHT_CLUSTER_FIRST_SLICE_DEPTH = 5.0f;
+
+const int MAX_CLUSTERED_LIGHTS = 4096;
+const int MAX_CLUSTER_LIGHT_INDICES = 128 * 1024;
+
+// Lights whose attenuation never drops off far enough get this radius.
+const f32 MAX_POINT_LIGHT_RADIUS = 500.0f;
+
+// Laid out the way the shaders read it, three float4s per light.
+struct Point_Light {
+    Vector3 position;
+    f32 radius; // Nothing is lit past this; see get_point_light_radius.
+    Vector3 color;
+    f32 unused0;
+    Vector3 attenuation; // Constant, linear and quadratic.
+    f32 unused1;
+};
+
+// How far out the light is still worth one step of an 8-bit color channel.
+f32 get_point_light_radius(Vector3 color, Vector3 attenuation);
+
+// Matches cbuffer Lighting in lighting.hlsli.
+struct Light_Cluster_Constants {
+    f32 tiles_per_pixel_x;
+    f32 tiles_per_pixel_y;
+    f32 first_slice_depth;
+    f32 slices_per_log2_depth; // For the exponential slices past the first.
+
+    u32 num_clusters_x;
+    u32 num_clusters_y;
+    u32 num_clusters_z;
+    u32 num_lights;
+};
+
+struct Light_Clustering_Stats {
+    int num_lights;
+    int num_lights_binned;  // Touched at least one cluster.
+    int num_lights_dropped; // Past MAX_CLUSTERED_LIGHTS.
+    int num_light_indices;
+    int num_indices_dropped; // Past MAX_CLUSTER_LIGHT_INDICES.
+    int max_lights_in_cluster;
+};
+
+struct Light_Clusters {
+    // Per cluster, where its lights start in light_indices and how many there
+    // are, interleaved. Clusters go x first, then y from the top of the
+    // screen, then depth.
+    u32 cluster_ranges[NUM_LIGHT_CLUSTERS * 2];
+
+    u32 light_indices[MAX_CLUSTER_LIGHT_INDICES];
+    int num_light_indices;
+
+    Point_Light *lights;
+    int num_lights;
+
+    Light_Cluster_Constants constants;
+    Light_Clustering_Stats stats;
+
+    // View space boxes around each cluster, one array per component, with
+    // depth increasing away from the camera. Rebuilt when the projection
+    // changes.
+    f32 cluster_min[3][NUM_LIGHT_CLUSTERS];
+    f32 cluster_max[3][NUM_LIGHT_CLUSTERS];
+    f32 cluster_projection[4]; // What the boxes were built for.
+};
+
+// Bins 'lights' for a camera with these matrices. The clusters keep a
+// pointer to the lights, so they have to stay put until they're uploaded.
+// Temporary memory comes from frame_arena and is released before returning.
+void build_light_clusters(Light_Clusters *clusters, Point_Light *lights, int num_lights, Matrix4 world_to_view, Matrix4 view_to_proj, int render_target_width, int render_target_height);
+
+#endif
@@ -4,15 +4,29 @@
 #include "geometry.h"
 #include "os.h"
 #include "array.h"
+#include "memory_tags.h"
+#include "assets.h"
+#include "profiler.h"
 
 #include <stdio.h>
 
 Mesh *make_mesh(u32 num_vertices, Vector3 *positions, Vector2 *uvs, Vector3 *normals,
                 u32 num_indices, u32 *indices) {
-    Mesh_Vertex *dest_buffer = new Mesh_Vertex[num_vertices];
-    defer { delete [] dest_buffer; };
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    Mesh_Vertex *dest_buffer = (Mesh_Vertex *)arena_push(&frame_arena, num_vertices * sizeof(Mesh_Vertex));
+    f32 radius_squared = 0.0f;
+    Vector3 bounds_min = num_vertices ? positions[0] : make_vector3(0, 0, 0);
+    Vector3 bounds_max = bounds_min;
     for (u32 i = 0; i < num_vertices; i++) {
         dest_buffer[i].position = positions[i];
+        radius_squared = Max(radius_squared, get_length_squared(positions[i]));
+
+        for (int j = 0; j < 3; j++) {
+            bounds_min.e[j] = Min(bounds_min.e[j], positions[i].e[j]);
+            bounds_max.e[j] = Max(bounds_max.e[j], positions[i].e[j]);
+        }
 
         if (uvs) {
             dest_buffer[i].uv = uvs[i];
@@ -27,9 +41,23 @@ Mesh *make_mesh(u32 num_vertices, Vector3 *positions, Vector2 *uvs, Vector3 *nor
         }
     }
 
-    Mesh *result = new Mesh();
+    Mesh *result = TAGGED_NEW(MEMORY_TAG_MESH, Mesh);
 
     result->vertex_count = num_indices;
+    result->radius = sqrtf(radius_squared);
+
+    // Not the smallest enclosing sphere, but close for most meshes and it
+    // only takes one more pass.
+    Vector3 center = (bounds_min + bounds_max) * 0.5f;
+    f32 bounding_radius_squared = 0.0f;
+    for (u32 i = 0; i < num_vertices; i++) {
+        bounding_radius_squared = Max(bounding_radius_squared, get_length_squared(positions[i] - center));
+    }
+
+    result->bounds_min = bounds_min;
+    result->bounds_max = bounds_max;
+    result->bounding_center = center;
+    result->bounding_radius = sqrtf(bounding_radius_squared);
 
     extern void make_buffers_for_mesh(Mesh *mesh, u32 num_vertices, Mesh_Vertex *buffer, u32 num_indices, u32 *indices);
     make_buffers_for_mesh(result, num_vertices, dest_buffer, num_indices, indices);
@@ -38,8 +66,17 @@ Mesh *make_mesh(u32 num_vertices, Vector3 *positions, Vector2 *uvs, Vector3 *nor
 }
 
 Mesh *load_obj(char *filename) {
-    char *full_path = mprintf("data/meshes/%s.obj", filename);
-    defer { delete [] full_path; };
+    PROFILE_SCOPE("load_obj");
+
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    Asset_Entry *asset = find_asset(ASSET_MESH, filename);
+    if (!asset) {
+        fprintf(stderr, "No mesh named '%s'\n", filename);
+        return nullptr;
+    }
+    char *full_path = asset->full_path;
 
     char *data = os_read_entire_file(full_path);
     if (!data) {
@@ -48,10 +85,32 @@ Mesh *load_obj(char *filename) {
     }
     defer { delete [] data; };
 
-    Array <Vector3> vertices;
-    Array <Vector2> uvs;
-    Array <Vector3> normals;
-    Array <u32> indices;
+    Allocator temporary = make_arena_allocator(&frame_arena);
+    Array <Vector3> vertices(temporary);
+    Array <Vector2> uvs(temporary);
+    Array <Vector3> normals(temporary);
+    Array <u32> indices(temporary);
+
+    // Count the records up front so the arrays are allocated once at their final
+    // size instead of doubling their way up on large meshes.
+    {
+        int num_vertices = 0, num_uvs = 0, num_normals = 0, num_faces = 0;
+        bool at_line_start = true;
+        for (char *c = data; *c; c++) {
+            if (at_line_start) {
+                if (c[0] == 'v' && c[1] == ' ') num_vertices++;
+                else if (c[0] == 'v' && c[1] == 't') num_uvs++;
+                else if (c[0] == 'v' && c[1] == 'n') num_normals++;
+                else if (c[0] == 'f' && c[1] == ' ') num_faces++;
+            }
+            at_line_start = is_end_of_line(*c);
+        }
+
+        vertices.reserve_exact(num_vertices);
+        uvs.reserve_exact(num_uvs);
+        normals.reserve_exact(num_normals);
+        indices.reserve_exact(num_faces * 3);
+    }
 
     Vector3 *vertex_array = nullptr;
     Vector2 *uv_array = nullptr;
@@ -79,8 +138,14 @@ Mesh *load_obj(char *filename) {
             sscanf(line, "v %f %f %f", &vertex.x, &vertex.y, &vertex.z);
             vertices.add(vertex);
         } else if (line_header[0] == 'f') {
-            if (!uv_array) uv_array = new Vector2[vertices.count * 2];
-            if (!normal_array) normal_array = new Vector3[vertices.count * 3];
+            if (!uv_array) {
+                uv_array = (Vector2 *)arena_push(&frame_arena, vertices.count * sizeof(Vector2));
+                memset(uv_array, 0, vertices.count * sizeof(Vector2));
+            }
+            if (!normal_array) {
+                normal_array = (Vector3 *)arena_push(&frame_arena, vertices.count * sizeof(Vector3));
+                memset(normal_array, 0, vertices.count * sizeof(Vector3));
+            }
 
             int vertex_index[3], uv_index[3], normal_index[3];
             sscanf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d",
@@ -1,22 +1,71 @@
 
+#define STB_SPRINTF_IMPLEMENTATION
 #include "general.h"
 #include "os.h"
 #include "display.h"
 #include "draw.h"
 #include "loader.h"
 #include "catalog.h"
+#include "texture_streamer.h"
 #include "mesh.h"
 #include "input.h"
 #include "entities.h"
 #include "hash_table.h"
 #include "config.h"
+#include "font.h"
+#include "jobs.h"
+#include "memory_tags.h"
+#include "assets.h"
+#include "profiler.h"
+#include "frame_timing.h"
+#include "frame_pacer.h"
+#include "debug.h"
 
 #include <stdio.h>
+#include <new>
 
 Globals globals = {};
+Arena frame_arena;
+
+static volatile s32 num_heap_allocations_this_frame;
+
+void count_heap_allocation() {
+    os_atomic_add(&num_heap_allocations_this_frame, 1);
+}
+
+void *operator new(size_t size) {
+    count_heap_allocation();
+
+    void *result = malloc(size ? size : 1);
+    if (!result) throw std::bad_alloc();
+    return result;
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
 double global_time_rate = 1.0;
 static double last_time;
 
+// Ticks per second, from the config. The game simulates at this rate
+// whatever the frame rate is.
+float simulation_rate = 60.0f;
+
+// If a frame is so slow it would need more ticks than this, the rest are
+// dropped. Otherwise slow ticks make longer frames that need still more ticks.
+const int MAX_SIMULATION_TICKS_PER_FRAME = 8;
+
+static double simulation_accumulator;
+
+// From the config. A frame rate limit of zero leaves the frame rate to vsync,
+// or to nothing at all.
+bool vsync = true;
+float frame_rate_limit = 0.0f;
+bool just_in_time_pacing = false;
+
+// The menu draws next to nothing, so uncapped it would spin a core flat out.
+const float MENU_FRAME_RATE_LIMIT = 60.0f;
+
 static Entity_Manager *entity_manager = new Entity_Manager();
 
 Entity_Manager *get_entity_manager() {
@@ -28,6 +77,12 @@ static void main_loop();
 static void simulate_game();
 
 int main(int argc, char **argv) {
+    init_arena(&frame_arena, FRAME_ARENA_SIZE);
+
+#ifdef PROFILER_ENABLED
+    init_profiler();
+#endif
+    
     {
         char *exe = os_get_path_to_executable();
         defer { delete [] exe; };
@@ -40,32 +95,86 @@ int main(int argc, char **argv) {
 
         os_setcwd(globals.operating_folder);
     }
+
+    init_asset_registry();
+    
+    for (int i = 1; i < argc; i++) {
+        if (strings_match(argv[i], "-write_asset_manifest")) {
+            // Release packaging: record a fresh scan so the shipped build never walks data/.
+            scan_assets();
+            return write_asset_manifest(ASSET_MANIFEST_FILEPATH) ? 0 : 1;
+        }
+    }
     
     Config config = load_config();
     {
         extern float render_scale_to_draw; // From menu.cpp
         render_scale_to_draw = config.render_scale;
+
+        simulation_rate = Max(config.simulation_rate, 1.0f);
+
+        vsync = config.vsync;
+        frame_rate_limit = Max(config.frame_rate_limit, 0.0f);
+        just_in_time_pacing = config.just_in_time_pacing;
     }
     
     display_init(1280, 720, "TM3D-DX11");
-    init_draw(true, true, 4);
+    init_draw(vsync, true, 4);
+    init_jobs();
+    os_enable_fine_sleep();
     {
         int width = static_cast <int>(config.render_scale * default_offscreen_buffer_width);
         int height = static_cast <int>(config.render_scale * default_offscreen_buffer_height);
         resize_offscreen_buffer(width, height);
+
+        void prerasterize_menu_glyphs(int height); // From menu.cpp
+        prerasterize_menu_glyphs(height);
     }
     
     last_time = os_get_time();
     globals.time_info.current_dt = 0.0f;
 
     game_init();
+    mark_memory_leak_baseline();
+
     main_loop();
+
+    write_frame_times_csv("frame_times.csv");
+    write_memory_report_json("memory_report.json");
+    report_memory_leaks();
     
     return 0;
 }
 
 static void main_loop() {
     while (!globals.should_quit) {
+        begin_frame_timing();
+
+#ifdef PROFILER_ENABLED
+        begin_profile_frame();
+#endif
+        PROFILE_SCOPE("Frame");
+
+        {
+            PROFILE_SCOPE("wait_for_frame_start");
+
+            float limit = frame_rate_limit;
+            if (globals.program_mode == PROGRAM_MODE_MENU && (!limit || limit > MENU_FRAME_RATE_LIMIT)) {
+                limit = MENU_FRAME_RATE_LIMIT;
+            }
+            set_frame_rate_limit(limit);
+            set_just_in_time_pacing(just_in_time_pacing);
+
+            begin_frame_phase(FRAME_PHASE_WAIT);
+            wait_for_frame_start();
+            end_frame_phase(FRAME_PHASE_WAIT);
+        }
+
+        begin_memory_frame();
+        begin_font_frame();
+        update_texture_loads();
+        update_texture_streaming();
+        
         os_poll_events();
         
         if (is_key_pressed(KEY_ESCAPE)) {
@@ -75,6 +184,20 @@ static void main_loop() {
         if (is_key_pressed(KEY_F11)) {
             display_toggle_fullscreen();
         }
+
+        if (is_key_pressed(KEY_F4)) {
+            write_frame_times_csv("frame_times.csv");
+        }
+
+#ifdef PROFILER_ENABLED
+        if (is_key_pressed(KEY_F2)) {
+            toggle_profiler_view();
+        }
+
+        if (is_key_pressed(KEY_F3)) {
+            write_profile_trace_json("profile_trace.json");
+        }
+#endif
         
         if (globals.time_info.current_dt) {
             if (globals.program_mode == PROGRAM_MODE_GAME) {
@@ -83,10 +206,13 @@ static void main_loop() {
                 } else {
                     os_show_cursor();
                 }
+                begin_frame_phase(FRAME_PHASE_SIMULATE);
                 simulate_game();
+                end_frame_phase(FRAME_PHASE_SIMULATE);
             }
         }
         
+        begin_frame_phase(FRAME_PHASE_DRAW);
         if (the_offscreen_buffer && the_offscreen_depth_buffer) {
             set_render_target(the_offscreen_buffer);
             set_depth_target(the_offscreen_depth_buffer);
@@ -138,8 +264,21 @@ static void main_loop() {
                 immediate_flush();
             }
         }
+        end_frame_phase(FRAME_PHASE_DRAW);
             
-        swap_buffers();
+        {
+            PROFILE_SCOPE("swap_buffers");
+
+            begin_frame_phase(FRAME_PHASE_PRESENT);
+            swap_buffers();
+            end_frame_phase(FRAME_PHASE_PRESENT);
+        }
+        end_paced_frame();
+        reset_arena(&frame_arena);
+
+        s32 num_heap_allocations = os_atomic_add(&num_heap_allocations_this_frame, 0);
+        os_atomic_add(&num_heap_allocations_this_frame, -num_heap_allocations);
+        globals.heap_allocations_last_frame = num_heap_allocations;
         
         update_time(0.15f);
     }
@@ -149,11 +288,16 @@ static void main_loop() {
 
 static void game_init() {
     entity_manager = new Entity_Manager();
+
+    // Covers the terrain grid with room to spare; anything outside still
+    // works, it just isn't subdivided.
+    init_octree(&entity_manager->octree, make_vector3(0, 0, 0), 2048.0f);
     
     Guy *guy = entity_manager->add_guy();
     guy->mesh = load_obj("dragon");
-    guy->mesh->map = find_or_create_texture("white");
+    guy->mesh->map = find_or_create_texture(ATOM("white"));
     guy->position = make_vector3(0, 0, -50);
+    update_entity_bounds(guy);
 
     camera = make_camera(make_vector3(0, 0, 0), 0, 0, 0);
 
@@ -161,23 +305,74 @@ static void game_init() {
     // Init terrains
     //
     {   
-        Terrain_Texture_Pack texture_pack;
-        texture_pack.background_texture = find_or_create_texture("grass");
-        texture_pack.r_texture = find_or_create_texture("dirt");
-        texture_pack.g_texture = find_or_create_texture("pinkFlowers");
-        texture_pack.b_texture = find_or_create_texture("path");
+        Terrain_Texture_Pack texture_pack = make_terrain_texture_pack("grass", "dirt", "pinkFlowers", "path");
         
-        Texture_Map *blend_map = find_or_create_texture("blendMap");
+        Terrain_Blend_Map blend_map = load_terrain_blend_map(ATOM("blendMap"));
+        defer { free_terrain_blend_map(&blend_map); };
         
-        make_terrain(0, 0, texture_pack, blend_map, "heightmap");
-        make_terrain(1, 0, texture_pack, blend_map, "heightmap");
-        make_terrain(1, 1, texture_pack, blend_map, "heightmap");
-        make_terrain(0, 1, texture_pack, blend_map, "heightmap");
+        make_terrain(0, 0, texture_pack, &blend_map, "heightmap");
+        make_terrain(1, 0, texture_pack, &blend_map, "heightmap");
+        make_terrain(1, 1, texture_pack, &blend_map, "heightmap");
+        make_terrain(0, 1, texture_pack, &blend_map, "heightmap");
     }
+
+    //
+    // Init lights
+    //
+    {
+        // A grid of lamps over the first terrain, a little above the ground.
+        Vector3 colors[] = {
+            make_vector3(3.0f, 0.8f, 0.4f),
+            make_vector3(0.4f, 1.0f, 3.0f),
+            make_vector3(0.6f, 3.0f, 0.8f),
+            make_vector3(3.0f, 2.4f, 1.2f),
+        };
+
+        for (int z = 0; z < 8; z++) {
+            for (int x = 0; x < 8; x++) {
+                Vector3 position = make_vector3(-25.0f - x * 50.0f, 0.0f, -25.0f - z * 50.0f);
+
+                Terrain *terrain = get_terrain_at(position);
+                if (terrain) position.y = get_terrain_height_at(terrain, position.x, position.z);
+                position.y += 6.0f;
+
+                entity_manager->add_light(position, colors[(x + z) % ArrayCount(colors)], make_vector3(1.0f, 0.1f, 0.05f));
+            }
+        }
+    }
+
+    entity_manager->save_previous_transforms();
+    camera.previous_position = camera.position;
+}
+
+static void simulate_tick(float dt) {
+    entity_manager->save_previous_transforms();
+    update_camera(&camera, dt);
 }
 
 static void simulate_game() {
-    update_camera(&camera);
+    PROFILE_SCOPE("simulate_game");
+
+    update_camera_look(&camera);
+
+    float tick_dt = 1.0f / simulation_rate;
+    simulation_accumulator += globals.time_info.current_dt;
+
+    int num_ticks = 0;
+    while (simulation_accumulator >= tick_dt) {
+        if (num_ticks == MAX_SIMULATION_TICKS_PER_FRAME) {
+            simulation_accumulator = fmod(simulation_accumulator, (double)tick_dt);
+            break;
+        }
+
+        simulate_tick(tick_dt);
+        simulation_accumulator -= tick_dt;
+        num_ticks++;
+    }
+
+    globals.time_info.simulation_dt = tick_dt;
+    globals.time_info.simulation_alpha = (float)(simulation_accumulator / tick_dt);
+    globals.simulation_ticks_last_frame = num_ticks;
 }
 
 void update_time(float dt_max) {
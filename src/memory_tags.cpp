@@ -0,0 +1,278 @@
+#include "memory_tags.h"
+
+#include "os.h"
+
+#include <stdio.h>
+
+struct alignas(16) Allocation_Header {
+    Allocation_Header *prev;
+    Allocation_Header *next;
+
+    char *file;
+    s64 size;
+    u64 serial; // Order of allocation; kept across reallocs.
+    s32 line;
+    s32 tag;
+};
+
+static char *memory_tag_names[NUM_MEMORY_TAGS] = {
+    "general",
+    "hash_table",
+    "font",
+    "texture",
+    "render_target",
+    "mesh",
+    "terrain",
+    "scene",
+};
+
+static Memory_Tag_Stats memory_stats[NUM_MEMORY_TAGS];
+static bool was_over_budget[NUM_MEMORY_TAGS];
+
+// All live allocations, so the leak report can say where they came from.
+static Allocation_Header *first_allocation;
+static Mutex *memory_mutex;
+
+static u64 next_allocation_serial;
+static u64 leak_baseline_serial;
+
+static void lock_memory() {
+    // The first tracked allocation always happens on the main thread, before
+    // any job worker exists.
+    if (!memory_mutex) memory_mutex = os_create_mutex();
+    os_lock_mutex(memory_mutex);
+}
+
+static void unlock_memory() {
+    os_unlock_mutex(memory_mutex);
+}
+
+static void link_allocation(Allocation_Header *header) {
+    header->prev = nullptr;
+    header->next = first_allocation;
+    if (first_allocation) first_allocation->prev = header;
+    first_allocation = header;
+}
+
+static void unlink_allocation(Allocation_Header *header) {
+    if (header->prev) header->prev->next = header->next;
+    else first_allocation = header->next;
+
+    if (header->next) header->next->prev = header->prev;
+}
+
+static void add_live_bytes(Memory_Tag_Stats *stats, s64 delta) {
+    stats->live_bytes += delta;
+    if (stats->live_bytes > stats->peak_bytes) stats->peak_bytes = stats->live_bytes;
+}
+
+void *tagged_alloc(Memory_Tag tag, s64 size, char *file, int line) {
+    assert(tag >= 0 && tag < NUM_MEMORY_TAGS);
+
+    count_heap_allocation();
+    Allocation_Header *header = (Allocation_Header *)malloc(sizeof(Allocation_Header) + size);
+    if (!header) return nullptr;
+
+    header->file = file;
+    header->line = line;
+    header->size = size;
+    header->tag = tag;
+
+    lock_memory();
+    header->serial = next_allocation_serial++;
+    link_allocation(header);
+
+    Memory_Tag_Stats *stats = &memory_stats[tag];
+    add_live_bytes(stats, size);
+    stats->num_live_allocations++;
+    stats->allocations_this_frame++;
+    unlock_memory();
+
+    return header + 1;
+}
+
+void *tagged_realloc(void *memory, s64 size, char *file, int line) {
+    assert(memory);
+
+    Allocation_Header *header = (Allocation_Header *)memory - 1;
+
+    lock_memory();
+    unlink_allocation(header);
+
+    count_heap_allocation();
+    Allocation_Header *new_header = (Allocation_Header *)realloc(header, sizeof(Allocation_Header) + size);
+    if (!new_header) {
+        link_allocation(header);
+        unlock_memory();
+        return nullptr;
+    }
+
+    Memory_Tag_Stats *stats = &memory_stats[new_header->tag];
+    add_live_bytes(stats, size - new_header->size);
+    stats->allocations_this_frame++;
+
+    new_header->size = size;
+    new_header->file = file;
+    new_header->line = line;
+    link_allocation(new_header);
+    unlock_memory();
+
+    return new_header + 1;
+}
+
+void tagged_free(void *memory) {
+    if (!memory) return;
+
+    Allocation_Header *header = (Allocation_Header *)memory - 1;
+
+    lock_memory();
+    unlink_allocation(header);
+
+    Memory_Tag_Stats *stats = &memory_stats[header->tag];
+    stats->live_bytes -= header->size;
+    stats->num_live_allocations--;
+    unlock_memory();
+
+    free(header);
+}
+
+void *tagged_allocator_proc(Allocator_Mode mode, s64 size, s64 old_size, void *old_memory, void *allocator_data) {
+    Memory_Tag tag = (Memory_Tag)(intptr_t)allocator_data;
+
+    switch (mode) {
+        case ALLOCATOR_ALLOCATE: return tagged_alloc(tag, size, "allocator", 0);
+        case ALLOCATOR_RESIZE: {
+            if (!old_memory) return tagged_alloc(tag, size, "allocator", 0);
+            return tagged_realloc(old_memory, size, "allocator", 0);
+        }
+        case ALLOCATOR_FREE: tagged_free(old_memory); return nullptr;
+    }
+
+    return nullptr;
+}
+
+void track_gpu_memory(Memory_Tag tag, s64 delta_in_bytes) {
+    assert(tag >= 0 && tag < NUM_MEMORY_TAGS);
+
+    lock_memory();
+    Memory_Tag_Stats *stats = &memory_stats[tag];
+    stats->gpu_bytes += delta_in_bytes;
+    if (stats->gpu_bytes > stats->peak_gpu_bytes) stats->peak_gpu_bytes = stats->gpu_bytes;
+    unlock_memory();
+}
+
+char *get_memory_tag_name(Memory_Tag tag) {
+    assert(tag >= 0 && tag < NUM_MEMORY_TAGS);
+    return memory_tag_names[tag];
+}
+
+Memory_Tag_Stats get_memory_stats(Memory_Tag tag) {
+    assert(tag >= 0 && tag < NUM_MEMORY_TAGS);
+
+    lock_memory();
+    Memory_Tag_Stats result = memory_stats[tag];
+    unlock_memory();
+
+    return result;
+}
+
+void set_memory_budget(Memory_Tag tag, s64 budget_bytes) {
+    assert(tag >= 0 && tag < NUM_MEMORY_TAGS);
+    memory_stats[tag].budget_bytes = budget_bytes;
+}
+
+bool is_over_memory_budget(Memory_Tag tag) {
+    Memory_Tag_Stats stats = get_memory_stats(tag);
+    if (!stats.budget_bytes) return false;
+
+    return stats.live_bytes + stats.gpu_bytes > stats.budget_bytes;
+}
+
+void begin_memory_frame() {
+    lock_memory();
+    for (int i = 0; i < NUM_MEMORY_TAGS; i++) {
+        Memory_Tag_Stats *stats = &memory_stats[i];
+        stats->allocations_last_frame = stats->allocations_this_frame;
+        stats->allocations_this_frame = 0;
+    }
+    unlock_memory();
+
+    // Only complain when a tag crosses its budget, not every frame it stays over.
+    for (int i = 0; i < NUM_MEMORY_TAGS; i++) {
+        bool over = is_over_memory_budget((Memory_Tag)i);
+        if (over && !was_over_budget[i]) {
+            Memory_Tag_Stats stats = get_memory_stats((Memory_Tag)i);
+            fprintf(stderr, "Memory tag '%s' is over budget: %lld bytes used, %lld allowed.\n",
+                    memory_tag_names[i], (long long)(stats.live_bytes + stats.gpu_bytes), (long long)stats.budget_bytes);
+        }
+        was_over_budget[i] = over;
+    }
+}
+
+void mark_memory_leak_baseline() {
+    lock_memory();
+    leak_baseline_serial = next_allocation_serial;
+    unlock_memory();
+}
+
+void report_memory_leaks() {
+    const int MAX_REPORTED_PER_TAG = 16;
+
+    lock_memory();
+    for (int tag = 0; tag < NUM_MEMORY_TAGS; tag++) {
+        s64 num_leaks = 0;
+        s64 leaked_bytes = 0;
+        for (Allocation_Header *header = first_allocation; header; header = header->next) {
+            if (header->tag != tag || header->serial < leak_baseline_serial) continue;
+
+            num_leaks++;
+            leaked_bytes += header->size;
+        }
+
+        if (!num_leaks) continue;
+
+        fprintf(stderr, "Memory tag '%s': %lld bytes still live in %lld allocations made since the baseline.\n",
+                memory_tag_names[tag], (long long)leaked_bytes, (long long)num_leaks);
+
+        int num_reported = 0;
+        for (Allocation_Header *header = first_allocation; header; header = header->next) {
+            if (header->tag != tag || header->serial < leak_baseline_serial) continue;
+
+            if (num_reported == MAX_REPORTED_PER_TAG) {
+                fprintf(stderr, "    ...\n");
+                break;
+            }
+
+            fprintf(stderr, "    %lld bytes from %s:%d\n", (long long)header->size, header->file, header->line);
+            num_reported++;
+        }
+    }
+    unlock_memory();
+}
+
+bool write_memory_report_json(char *file_path) {
+    FILE *file = fopen(file_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s' for writing.\n", file_path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    Memory_Tag_Stats stats[NUM_MEMORY_TAGS];
+    lock_memory();
+    memcpy(stats, memory_stats, sizeof(stats));
+    unlock_memory();
+
+    fprintf(file, "{\n    \"tags\": [\n");
+    for (int i = 0; i < NUM_MEMORY_TAGS; i++) {
+        Memory_Tag_Stats *s = &stats[i];
+        fprintf(file, "        {\"name\": \"%s\", \"live_bytes\": %lld, \"peak_bytes\": %lld, \"live_allocations\": %lld, "
+                      "\"allocations_last_frame\": %lld, \"gpu_bytes\": %lld, \"peak_gpu_bytes\": %lld, \"budget_bytes\": %lld}%s\n",
+                memory_tag_names[i], (long long)s->live_bytes, (long long)s->peak_bytes, (long long)s->num_live_allocations,
+                (long long)s->allocations_last_frame, (long long)s->gpu_bytes, (long long)s->peak_gpu_bytes, (long long)s->budget_bytes,
+                (i == NUM_MEMORY_TAGS - 1) ? "" : ",");
+    }
+    fprintf(file, "    ]\n}\n");
+
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef MEMORY_TAGS_H
+#define MEMORY_TAGS_H
+
+#include "general.h"
+
+#include <new>
+
+// Every tracked allocation carries the subsystem it belongs to. CPU memory is
+// counted exactly through a small header in front of each block; GPU memory is
+// an estimate reported by the renderer when resources are created and released.
+
+enum Memory_Tag {
+    MEMORY_TAG_GENERAL,
+    MEMORY_TAG_HASH_TABLE,
+    MEMORY_TAG_FONT,
+    MEMORY_TAG_TEXTURE,
+    MEMORY_TAG_RENDER_TARGET,
+    MEMORY_TAG_MESH,
+    MEMORY_TAG_TERRAIN,
+    MEMORY_TAG_SCENE,
+
+    NUM_MEMORY_TAGS
+};
+
+struct Memory_Tag_Stats {
+    s64 live_bytes;
+    s64 peak_bytes;
+    s64 num_live_allocations;
+
+    s64 allocations_this_frame;
+    s64 allocations_last_frame;
+
+    s64 gpu_bytes;
+    s64 peak_gpu_bytes;
+
+    s64 budget_bytes; // 0 means no budget. Compared against live_bytes + gpu_bytes.
+};
+
+void *tagged_alloc(Memory_Tag tag, s64 size, char *file, int line);
+void *tagged_realloc(void *memory, s64 size, char *file, int line);
+void tagged_free(void *memory);
+
+#define TAGGED_ALLOC(tag, size) tagged_alloc(tag, size, __FILE__, __LINE__)
+#define TAGGED_NEW_ARRAY(tag, T, count) ((T *)tagged_alloc(tag, (s64)(count) * sizeof(T), __FILE__, __LINE__))
+#define TAGGED_NEW(tag, T) (new (tagged_alloc(tag, sizeof(T), __FILE__, __LINE__)) T())
+
+template <typename T>
+inline void tagged_delete(T *object) {
+    if (!object) return;
+
+    object->~T();
+    tagged_free(object);
+}
+
+void *tagged_allocator_proc(Allocator_Mode mode, s64 size, s64 old_size, void *old_memory, void *allocator_data);
+
+inline Allocator make_tagged_allocator(Memory_Tag tag) {
+    Allocator result;
+    result.proc = tagged_allocator_proc;
+    result.data = (void *)(intptr_t)tag;
+    return result;
+}
+
+void track_gpu_memory(Memory_Tag tag, s64 delta_in_bytes);
+
+char *get_memory_tag_name(Memory_Tag tag);
+Memory_Tag_Stats get_memory_stats(Memory_Tag tag);
+void set_memory_budget(Memory_Tag tag, s64 budget_bytes);
+bool is_over_memory_budget(Memory_Tag tag);
+
+// Rolls the per-frame allocation counts. Call once per frame.
+void begin_memory_frame();
+
+// Allocations made before this are what the program keeps for its whole run
+// and frees only by exiting, so the leak report leaves them out. Call it once
+// everything loaded at startup is in place.
+void mark_memory_leak_baseline();
+
+// Prints every allocation made since the baseline that is still live, grouped
+// by tag. Without a baseline that's everything still live.
+void report_memory_leaks();
+
+bool write_memory_report_json(char *file_path);
+
+#endif
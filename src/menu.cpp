@@ -11,6 +11,9 @@ enum Menu_Item {
     NUM_MENU_ITEMS,
 };
 
+const float TITLE_FONT_SCALE = 0.1f;
+const float ITEM_FONT_SCALE = 0.05f;
+
 static bool asking_for_quit_confirmation;
 static int current_menu_choice;
 float render_scale_to_draw = 1.0f;
@@ -25,6 +28,14 @@ void toggle_menu() {
     asking_for_quit_confirmation = false;
 }
 
+void prerasterize_menu_glyphs(int height) {
+    int big_font_size = static_cast <int>(TITLE_FONT_SCALE * height);
+    prerasterize_glyphs(ATOM("KarminaBoldItalic.otf"), big_font_size, GLYPH_RANGES_LATIN, ArrayCount(GLYPH_RANGES_LATIN));
+
+    int font_size = static_cast <int>(ITEM_FONT_SCALE * height);
+    prerasterize_glyphs(ATOM("KarminaBold.otf"), font_size, GLYPH_RANGES_LATIN, ArrayCount(GLYPH_RANGES_LATIN));
+}
+
 static void advance_menu_choice(int delta) {
     int prev_menu_choice = current_menu_choice;
     current_menu_choice += delta;
@@ -94,8 +105,8 @@ void draw_menu() {
     // Draw title
     //
     {
-        int big_font_size = static_cast <int>(0.1f * render_target_height);
-        Font *big_font = get_font_at_size("KarminaBoldItalic.otf", big_font_size);
+        int big_font_size = static_cast <int>(TITLE_FONT_SCALE * render_target_height);
+        Font *big_font = get_font_at_size(ATOM("KarminaBoldItalic.otf"), big_font_size);
         
         char *text = "ThinMatrix's 3D OpenGL Series";
         int x = (render_target_width - get_string_width_in_pixels(big_font, text)) / 2;
@@ -108,8 +119,8 @@ void draw_menu() {
         draw_text(big_font, text, x, y, make_vector4(1.0f, 1.0f, 1.0f, 1.0f));
     }
 
-    int font_size = static_cast <int>(0.05f * render_target_height);
-    Font *font = get_font_at_size("KarminaBold.otf", font_size);
+    int font_size = static_cast <int>(ITEM_FONT_SCALE * render_target_height);
+    Font *font = get_font_at_size(ATOM("KarminaBold.otf"), font_size);
     
     int start_y = static_cast <int>(0.55f * render_target_height);
     int y = start_y;
@@ -118,13 +129,24 @@ void draw_menu() {
     draw_item(font, text, y, MENU_RESUME);
     y -= font->character_height;
 
-    text = mprintf("Render scale: %.2f", render_scale_to_draw);
+    text = tprint("Render scale: %.2f", render_scale_to_draw);
     draw_item(font, text, y, MENU_RENDER_SCALE);
     y -= font->character_height;
-    delete [] text;
 
     text = "Quit";
     if (asking_for_quit_confirmation) text = "Quit? Are you sure?";
     draw_item(font, text, y, MENU_QUIT);
     y -= font->character_height;
+
+    //
+    // Draw glyph loading progress, while the glyphs declared at startup are
+    // still on their way into the atlas
+    //
+    if (!is_glyph_prerasterization_done()) {
+        int percent = static_cast <int>(get_glyph_prerasterization_progress() * 100.0f);
+        text = tprint("Loading glyphs %d%%", percent);
+
+        int x = (render_target_width - get_string_width_in_pixels(font, text)) / 2;
+        draw_text(font, text, x, font->character_height, make_vector4(0.4f, 0.4f, 0.4f, 1.0f));
+    }
 }
@@ -15,6 +15,18 @@ struct Mesh {
     void *vbo;
     void *ibo;
     u32 vertex_count;
+    s64 gpu_size_in_bytes;
+
+    // Distance from the mesh origin to its farthest vertex.
+    f32 radius;
+
+    // Object space bounds, for culling. The sphere is centered on the box,
+    // which for meshes not built around their origin is much tighter than
+    // 'radius'.
+    Vector3 bounds_min;
+    Vector3 bounds_max;
+    Vector3 bounding_center;
+    f32 bounding_radius;
 
     Texture_Map *map;
 };
@@ -0,0 +1,297 @@
+#include "mipmap.h"
+
+#include <emmintrin.h>
+#include <math.h>
+
+// Levels past the first are filtered from float RGBA, one __m128 per texel:
+// linear color (not premultiplied) plus alpha. Only the output is quantized.
+
+// 8192 entries keeps the darkest sRGB codes within half a step; a 4096 table
+// skips codes below about 10.
+const int LINEAR_TO_SRGB_TABLE_SIZE = 8192;
+
+static f32 srgb_to_linear_table[256];
+static f32 unorm_to_float_table[256];
+static u8 linear_to_srgb_table[LINEAR_TO_SRGB_TABLE_SIZE];
+
+static f32 srgb_to_linear(f32 value) {
+    if (value <= 0.04045f) return value / 12.92f;
+    return powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static f32 linear_to_srgb(f32 value) {
+    if (value <= 0.0031308f) return value * 12.92f;
+    return 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static bool init_conversion_tables() {
+    for (int i = 0; i < 256; i++) {
+        srgb_to_linear_table[i] = srgb_to_linear(i / 255.0f);
+        unorm_to_float_table[i] = i / 255.0f;
+    }
+
+    for (int i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; i++) {
+        f32 linear = i / (f32)(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+        linear_to_srgb_table[i] = (u8)(linear_to_srgb(linear) * 255.0f + 0.5f);
+    }
+
+    return true;
+}
+
+static void ensure_conversion_tables() {
+    // Function-local static, so the first caller builds the tables even when
+    // that happens on several threads at once.
+    static bool initialized = init_conversion_tables();
+    (void)initialized;
+}
+
+int get_num_mip_levels(int width, int height) {
+    int num_levels = 1;
+    while ((width > 1 || height > 1) && num_levels < MAX_MIP_LEVELS) {
+        width = Max(width / 2, 1);
+        height = Max(height / 2, 1);
+        num_levels++;
+    }
+
+    return num_levels;
+}
+
+//
+// Filtering
+//
+
+static inline __m128 load_texel(const u8 *texel, const f32 *color_table) {
+    return _mm_setr_ps(color_table[texel[0]], color_table[texel[1]], color_table[texel[2]], unorm_to_float_table[texel[3]]);
+}
+
+static inline __m128 broadcast_alpha(__m128 texel) {
+    return _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Alpha-weighted average of four texels. Where all four are fully transparent
+// there is nothing to weight by, so the color is a plain average instead.
+static inline __m128 filter_2x2(__m128 a, __m128 b, __m128 c, __m128 d) {
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 tiny = _mm_set1_ps(1e-12f);
+    const __m128 alpha_lane = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+    __m128 wa = broadcast_alpha(a);
+    __m128 wb = broadcast_alpha(b);
+    __m128 wc = broadcast_alpha(c);
+    __m128 wd = broadcast_alpha(d);
+
+    __m128 weight_sum = _mm_add_ps(_mm_add_ps(wa, wb), _mm_add_ps(wc, wd));
+    __m128 weighted = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, wa), _mm_mul_ps(b, wb)),
+                                 _mm_add_ps(_mm_mul_ps(c, wc), _mm_mul_ps(d, wd)));
+    weighted = _mm_div_ps(weighted, _mm_max_ps(weight_sum, tiny));
+
+    __m128 plain = _mm_mul_ps(_mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d)), quarter);
+
+    __m128 has_weight = _mm_cmpgt_ps(weight_sum, _mm_setzero_ps());
+    __m128 color = _mm_or_ps(_mm_and_ps(has_weight, weighted), _mm_andnot_ps(has_weight, plain));
+
+    // Alpha itself is always the plain average.
+    return _mm_or_ps(_mm_andnot_ps(alpha_lane, color), _mm_and_ps(alpha_lane, plain));
+}
+
+// An odd dimension drops its last row or column, the usual floor convention.
+// A dimension of 1 samples the same texel twice.
+
+static void downsample_from_bytes(Bitmap *source, f32 *dest, int dest_width, int dest_height, const f32 *color_table) {
+    int dx = (source->width > 1) ? 4 : 0;
+    int dy = (source->height > 1) ? 1 : 0;
+
+    for (int y = 0; y < dest_height; y++) {
+        u8 *row0 = source->data + (s64)(y * 2) * source->width * 4;
+        u8 *row1 = source->data + (s64)(y * 2 + dy) * source->width * 4;
+        f32 *out = dest + (s64)y * dest_width * 4;
+
+        for (int x = 0; x < dest_width; x++) {
+            int offset = x * 8;
+            __m128 a = load_texel(row0 + offset, color_table);
+            __m128 b = load_texel(row0 + offset + dx, color_table);
+            __m128 c = load_texel(row1 + offset, color_table);
+            __m128 d = load_texel(row1 + offset + dx, color_table);
+
+            _mm_storeu_ps(out + x * 4, filter_2x2(a, b, c, d));
+        }
+    }
+}
+
+static void downsample_from_floats(f32 *source, int source_width, int source_height, f32 *dest, int dest_width, int dest_height) {
+    int dx = (source_width > 1) ? 4 : 0;
+    int dy = (source_height > 1) ? 1 : 0;
+
+    for (int y = 0; y < dest_height; y++) {
+        f32 *row0 = source + (s64)(y * 2) * source_width * 4;
+        f32 *row1 = source + (s64)(y * 2 + dy) * source_width * 4;
+        f32 *out = dest + (s64)y * dest_width * 4;
+
+        for (int x = 0; x < dest_width; x++) {
+            int offset = x * 8;
+            __m128 a = _mm_loadu_ps(row0 + offset);
+            __m128 b = _mm_loadu_ps(row0 + offset + dx);
+            __m128 c = _mm_loadu_ps(row1 + offset);
+            __m128 d = _mm_loadu_ps(row1 + offset + dx);
+
+            _mm_storeu_ps(out + x * 4, filter_2x2(a, b, c, d));
+        }
+    }
+}
+
+static void quantize_level(f32 *source, Bitmap *dest, bool srgb, f32 alpha_scale) {
+    // Color goes to a table index for sRGB or straight to 0..255 otherwise.
+    f32 color_range = srgb ? (f32)(LINEAR_TO_SRGB_TABLE_SIZE - 1) : 255.0f;
+    const __m128 scale = _mm_setr_ps(color_range, color_range, color_range, 255.0f * alpha_scale);
+    const __m128 upper = _mm_setr_ps(color_range, color_range, color_range, 255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    s64 num_texels = (s64)dest->width * dest->height;
+    for (s64 i = 0; i < num_texels; i++) {
+        __m128 texel = _mm_mul_ps(_mm_loadu_ps(source + i * 4), scale);
+        texel = _mm_min_ps(_mm_max_ps(texel, _mm_setzero_ps()), upper);
+
+        alignas(16) s32 values[4];
+        _mm_store_si128((__m128i *)values, _mm_cvttps_epi32(_mm_add_ps(texel, half)));
+
+        u8 *out = dest->data + i * 4;
+        if (srgb) {
+            out[0] = linear_to_srgb_table[values[0]];
+            out[1] = linear_to_srgb_table[values[1]];
+            out[2] = linear_to_srgb_table[values[2]];
+        } else {
+            out[0] = (u8)values[0];
+            out[1] = (u8)values[1];
+            out[2] = (u8)values[2];
+        }
+        out[3] = (u8)values[3];
+    }
+}
+
+//
+// Alpha coverage
+//
+
+static f32 get_alpha_coverage(Bitmap *bitmap, f32 cutoff) {
+    int threshold = (int)ceilf(cutoff * 255.0f);
+
+    s64 num_texels = (s64)bitmap->width * bitmap->height;
+    s64 num_passing = 0;
+    for (s64 i = 0; i < num_texels; i++) {
+        if (bitmap->data[i * 4 + 3] >= threshold) num_passing++;
+    }
+
+    return (f32)num_passing / num_texels;
+}
+
+// Finds the scale that makes about 'coverage' of the texels pass 'cutoff'.
+// Passing is monotonic in alpha, so a histogram gives the alpha value the
+// target fraction sits at, and the scale maps that value onto the cutoff.
+static f32 get_alpha_scale_for_coverage(f32 *texels, s64 num_texels, f32 cutoff, f32 coverage) {
+    s64 histogram[256] = {};
+    for (s64 i = 0; i < num_texels; i++) {
+        int bin = (int)(texels[i * 4 + 3] * 255.0f + 0.5f);
+        histogram[Min(Max(bin, 0), 255)]++;
+    }
+
+    s64 target = (s64)(coverage * num_texels + 0.5f);
+    if (target <= 0) return 1.0f;
+
+    s64 num_passing = 0;
+    int bin = 255;
+    for (; bin > 0; bin--) {
+        num_passing += histogram[bin];
+        if (num_passing >= target) break;
+    }
+
+    // Everything including zero alpha would have to pass; no scale does that.
+    if (bin == 0) return 1.0f;
+
+    return (cutoff * 255.0f) / bin;
+}
+
+//
+// Chain
+//
+
+void build_mip_chain(Bitmap source, Mip_Chain *chain, Mip_Options options) {
+    assert(source.format == TEXTURE_FORMAT_RGBA8);
+    ensure_conversion_tables();
+
+    chain->allocator = options.allocator;
+    chain->num_levels = get_num_mip_levels(source.width, source.height);
+    chain->levels[0] = source;
+    chain->memory = nullptr;
+
+    if (chain->num_levels == 1) return;
+
+    // Level sizes, plus the two float scratch levels. Odd levels reuse the
+    // first buffer and even levels the second; each is at least as large as
+    // anything that goes into it later.
+    s64 bytes_for_levels = 0;
+    int width = source.width;
+    int height = source.height;
+    for (int i = 1; i < chain->num_levels; i++) {
+        width = Max(width / 2, 1);
+        height = Max(height / 2, 1);
+        bytes_for_levels += (s64)width * height * 4;
+    }
+
+    int width1 = Max(source.width / 2, 1);
+    int height1 = Max(source.height / 2, 1);
+    int width2 = Max(width1 / 2, 1);
+    int height2 = Max(height1 / 2, 1);
+    s64 scratch_floats[2] = { (s64)width1 * height1 * 4, (s64)width2 * height2 * 4 };
+
+    s64 scratch_offset = (bytes_for_levels + 15) & ~15;
+    s64 total_size = scratch_offset + (scratch_floats[0] + scratch_floats[1]) * sizeof(f32);
+
+    chain->memory = (u8 *)allocate(chain->allocator, total_size);
+    f32 *scratch[2];
+    scratch[0] = (f32 *)(chain->memory + scratch_offset);
+    scratch[1] = scratch[0] + scratch_floats[0];
+
+    bool coverage_enabled = options.alpha_coverage_cutoff > 0.0f;
+    f32 target_coverage = coverage_enabled ? get_alpha_coverage(&source, options.alpha_coverage_cutoff) : 1.0f;
+    if (target_coverage >= 1.0f) coverage_enabled = false; // Opaque, nothing to keep.
+
+    const f32 *color_table = options.srgb ? srgb_to_linear_table : unorm_to_float_table;
+
+    u8 *level_data = chain->memory;
+    f32 *previous = nullptr;
+    for (int i = 1; i < chain->num_levels; i++) {
+        Bitmap *parent = &chain->levels[i - 1];
+        Bitmap *level = &chain->levels[i];
+
+        level->width = Max(parent->width / 2, 1);
+        level->height = Max(parent->height / 2, 1);
+        level->format = TEXTURE_FORMAT_RGBA8;
+        level->channels = 4;
+        level->data = level_data;
+        level_data += (s64)level->width * level->height * 4;
+
+        f32 *current = scratch[(i - 1) & 1];
+        if (i == 1) {
+            downsample_from_bytes(&source, current, level->width, level->height, color_table);
+        } else {
+            downsample_from_floats(previous, parent->width, parent->height, current, level->width, level->height);
+        }
+
+        f32 alpha_scale = 1.0f;
+        if (coverage_enabled) {
+            s64 num_texels = (s64)level->width * level->height;
+            alpha_scale = get_alpha_scale_for_coverage(current, num_texels, options.alpha_coverage_cutoff, target_coverage);
+        }
+
+        // The scale only goes into the output. The float level keeps the
+        // filtered alpha, so the next level down starts from the real values.
+        quantize_level(current, level, options.srgb, alpha_scale);
+        previous = current;
+    }
+}
+
+void free_mip_chain(Mip_Chain *chain) {
+    deallocate(chain->allocator, chain->memory);
+    chain->memory = nullptr;
+    chain->num_levels = 0;
+}
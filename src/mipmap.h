@@ -0,0 +1,47 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include "general.h"
+#include "bitmap.h"
+
+// CPU mip chains for RGBA8 bitmaps, shared by create_texture and the texture
+// cooker so both produce the same levels.
+//
+// Filtering is a 2x2 box done in linear light on float intermediates, so
+// there is no rounding drift down the chain and sRGB textures don't darken
+// at distance. Color is averaged weighted by alpha, so fully transparent
+// texels don't bleed their (usually black) color into cutout edges.
+
+const int MAX_MIP_LEVELS = 16;
+
+struct Mip_Options {
+    // Color channels hold sRGB-encoded values. Turn off for data such as
+    // normal maps and blend maps. Alpha is always linear.
+    bool srgb = true;
+
+    // When non-zero, each level's alpha is rescaled so the fraction of texels
+    // passing this cutoff matches the top level. Keeps foliage cutouts from
+    // thinning out and vanishing at distance.
+    f32 alpha_coverage_cutoff = 0.0f;
+
+    // Where the levels and the float scratch come from; null is the heap.
+    Allocator allocator;
+};
+
+struct Mip_Chain {
+    int num_levels = 0;
+    Bitmap levels[MAX_MIP_LEVELS]; // RGBA8. levels[0] is the source and is not copied.
+
+    Allocator allocator;
+    u8 *memory = nullptr;
+};
+
+// Number of levels down to and including 1x1, capped at MAX_MIP_LEVELS.
+int get_num_mip_levels(int width, int height);
+
+// The source must be RGBA8. Levels after the first are allocated in one block
+// that free_mip_chain releases.
+void build_mip_chain(Bitmap source, Mip_Chain *chain, Mip_Options options = Mip_Options());
+void free_mip_chain(Mip_Chain *chain);
+
+#endif
@@ -0,0 +1,405 @@
+#include "occlusion.h"
+
+#include "array.h"
+#include "jobs.h"
+#include "memory_tags.h"
+
+#include <emmintrin.h>
+
+struct Screen_Vertex {
+    f32 x, y, z;
+};
+
+// A triangle ready to rasterize: edge functions that are positive inside, a
+// plane for 1/w and its pixel bounds.
+//
+// Edges are tested at the pixel corner farthest out, so passing all three
+// means the whole pixel is inside. A pixel that sticks out across an edge
+// shared with a neighbouring occluder is still covered if it's inside that
+// neighbour's other two edges, tested the same way; that keeps occluders
+// made of several triangles from cracking along their seams. Edges with no
+// neighbour have neighbour edges that always fail.
+struct Occluder_Triangle {
+    f32 edge_a[3];
+    f32 edge_b[3];
+    f32 edge_c[3];
+
+    f32 neighbor_a[3][2];
+    f32 neighbor_b[3][2];
+    f32 neighbor_c[3][2];
+
+    f32 depth_a;
+    f32 depth_b;
+    f32 depth_c;
+    f32 min_depth;          // Farthest vertex.
+    f32 min_neighbor_depth; // Farthest vertex of this and its neighbours.
+
+    int min_x, min_y;
+    int max_x, max_y; // Exclusive.
+
+    Screen_Vertex v[3]; // Counterclockwise; edge i runs from v[i] to v[i + 1].
+};
+
+alignas(16) static f32 depth_buffer[OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT];
+
+static Matrix4 occlusion_world_to_proj;
+static Array <Occluder_Triangle> triangles(make_tagged_allocator(MEMORY_TAG_SCENE));
+static Occlusion_Stats stats;
+
+void begin_occlusion_frame(Matrix4 world_to_proj) {
+    occlusion_world_to_proj = world_to_proj;
+    triangles.reset();
+    stats = {};
+
+    memset(depth_buffer, 0, sizeof(depth_buffer));
+}
+
+static bool project(Vector3 p, Screen_Vertex *result) {
+    Matrix4 m = occlusion_world_to_proj;
+
+    f32 w = m._41 * p.x + m._42 * p.y + m._43 * p.z + m._44;
+    if (w < OCCLUSION_NEAR_W) return false;
+
+    f32 x = m._11 * p.x + m._12 * p.y + m._13 * p.z + m._14;
+    f32 y = m._21 * p.x + m._22 * p.y + m._23 * p.z + m._24;
+
+    f32 inverse_w = 1.0f / w;
+    result->x = (x * inverse_w * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH;
+    result->y = (y * inverse_w * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT;
+    result->z = inverse_w;
+    return true;
+}
+
+static void setup_triangle(Screen_Vertex v0, Screen_Vertex v1, Screen_Vertex v2) {
+    f32 area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (fabsf(area) < 1e-6f) return;
+
+    // Counterclockwise, so all three edge functions are positive inside.
+    if (area < 0.0f) {
+        Screen_Vertex t = v1;
+        v1 = v2;
+        v2 = t;
+        area = -area;
+    }
+
+    Occluder_Triangle tri;
+    tri.min_x = Max((int)floorf(Min(v0.x, Min(v1.x, v2.x))), 0) & ~3;
+    tri.min_y = Max((int)floorf(Min(v0.y, Min(v1.y, v2.y))), 0);
+    tri.max_x = Min((int)ceilf(Max(v0.x, Max(v1.x, v2.x))), OCCLUSION_BUFFER_WIDTH);
+    tri.max_y = Min((int)ceilf(Max(v0.y, Max(v1.y, v2.y))), OCCLUSION_BUFFER_HEIGHT);
+    if (tri.min_x >= tri.max_x || tri.min_y >= tri.max_y) return;
+
+    tri.v[0] = v0;
+    tri.v[1] = v1;
+    tri.v[2] = v2;
+
+    for (int i = 0; i < 3; i++) {
+        Screen_Vertex a = tri.v[i];
+        Screen_Vertex b = tri.v[(i + 1) % 3];
+
+        // Moved in by half a pixel each way, so the test at the pixel center
+        // is the test at its worst corner.
+        tri.edge_a[i] = a.y - b.y;
+        tri.edge_b[i] = b.x - a.x;
+        tri.edge_c[i] = a.x * b.y - a.y * b.x - 0.5f * (fabsf(tri.edge_a[i]) + fabsf(tri.edge_b[i]));
+
+        for (int j = 0; j < 2; j++) {
+            tri.neighbor_a[i][j] = 0.0f;
+            tri.neighbor_b[i][j] = 0.0f;
+            tri.neighbor_c[i][j] = -1.0f;
+        }
+    }
+
+    f32 inverse_area = 1.0f / area;
+    f32 dx1 = v1.x - v0.x, dy1 = v1.y - v0.y, dz1 = v1.z - v0.z;
+    f32 dx2 = v2.x - v0.x, dy2 = v2.y - v0.y, dz2 = v2.z - v0.z;
+    tri.depth_a = (dz1 * dy2 - dz2 * dy1) * inverse_area;
+    tri.depth_b = (dz2 * dx1 - dz1 * dx2) * inverse_area;
+
+    // The farthest the plane gets within half a pixel of the center.
+    f32 bias = 0.5f * (fabsf(tri.depth_a) + fabsf(tri.depth_b));
+    tri.depth_c = v0.z - tri.depth_a * v0.x - tri.depth_b * v0.y - bias;
+    tri.min_depth = Min(v0.z, Min(v1.z, v2.z));
+    tri.min_neighbor_depth = tri.min_depth;
+
+    triangles.add(tri);
+    stats.num_triangles_rasterized++;
+}
+
+inline bool vertices_match(Screen_Vertex a, Screen_Vertex b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// The edge function before it was moved in by half a pixel.
+static f32 get_exact_edge_value(Occluder_Triangle *tri, int edge, Screen_Vertex p) {
+    f32 c = tri->edge_c[edge] + 0.5f * (fabsf(tri->edge_a[edge]) + fabsf(tri->edge_b[edge]));
+    return tri->edge_a[edge] * p.x + tri->edge_b[edge] * p.y + c;
+}
+
+// Lets pixels across 'tri's edge count as covered when they're inside
+// 'neighbor'. Only when the neighbour lies on the far side of the edge on
+// screen; where the surface folds back over itself it doesn't cover that side.
+static void link_neighbor(Occluder_Triangle *tri, int edge, Occluder_Triangle *neighbor, int neighbor_edge) {
+    Screen_Vertex opposite = neighbor->v[(neighbor_edge + 2) % 3];
+    if (get_exact_edge_value(tri, edge, opposite) >= 0.0f) return;
+
+    for (int j = 0; j < 2; j++) {
+        int other = (neighbor_edge + 1 + j) % 3;
+        tri->neighbor_a[edge][j] = neighbor->edge_a[other];
+        tri->neighbor_b[edge][j] = neighbor->edge_b[other];
+        tri->neighbor_c[edge][j] = neighbor->edge_c[other];
+    }
+
+    tri->min_neighbor_depth = Min(tri->min_neighbor_depth, neighbor->min_depth);
+}
+
+struct Occluder_Edge {
+    u64 key;
+    int triangle;
+    int edge;
+};
+
+static u64 hash_screen_vertex(Screen_Vertex v) {
+    u32 bits[3];
+    memcpy(bits, &v, sizeof(bits));
+    return (bits[0] * 0x9e3779b97f4a7c15ULL) ^ (bits[1] * 0xc2b2ae3d27d4eb4fULL) ^ (bits[2] * 0x165667b19e3779f9ULL);
+}
+
+static int compare_occluder_edges(const void *a, const void *b) {
+    u64 key_a = ((Occluder_Edge *)a)->key;
+    u64 key_b = ((Occluder_Edge *)b)->key;
+    return (key_a < key_b) ? -1 : (key_a > key_b);
+}
+
+// Shared edges are found by their projected endpoints, which come out the
+// same for triangles that were given the same world space vertices.
+static void link_shared_edges(int first_triangle) {
+    int num_triangles = triangles.count - first_triangle;
+    if (num_triangles < 2) return;
+
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    int num_edges = num_triangles * 3;
+    Occluder_Edge *edges = (Occluder_Edge *)arena_push(&frame_arena, num_edges * sizeof(Occluder_Edge));
+    for (int i = 0; i < num_triangles; i++) {
+        Occluder_Triangle *tri = &triangles[first_triangle + i];
+        for (int j = 0; j < 3; j++) {
+            u64 a = hash_screen_vertex(tri->v[j]);
+            u64 b = hash_screen_vertex(tri->v[(j + 1) % 3]);
+
+            Occluder_Edge *edge = &edges[i * 3 + j];
+            edge->key = Min(a, b) * 31 + Max(a, b);
+            edge->triangle = first_triangle + i;
+            edge->edge = j;
+        }
+    }
+
+    qsort(edges, num_edges, sizeof(Occluder_Edge), compare_occluder_edges);
+
+    // Two triangles facing the same way on screen run a shared edge in
+    // opposite directions. Anything else isn't a seam between them.
+    for (int i = 0; i + 1 < num_edges; i++) {
+        Occluder_Edge *first = &edges[i];
+        Occluder_Edge *second = &edges[i + 1];
+        if (first->key != second->key) continue;
+
+        Occluder_Triangle *a = &triangles[first->triangle];
+        Occluder_Triangle *b = &triangles[second->triangle];
+        if (!vertices_match(a->v[first->edge], b->v[(second->edge + 1) % 3])) continue;
+        if (!vertices_match(a->v[(first->edge + 1) % 3], b->v[second->edge])) continue;
+
+        link_neighbor(a, first->edge, b, second->edge);
+        link_neighbor(b, second->edge, a, first->edge);
+        i++;
+    }
+}
+
+void add_occluder_triangles(Vector3 *vertices, int num_triangles) {
+    stats.num_triangles += num_triangles;
+
+    int first_triangle = triangles.count;
+    for (int i = 0; i < num_triangles; i++) {
+        Screen_Vertex v[3];
+        if (!project(vertices[i * 3 + 0], &v[0])) continue;
+        if (!project(vertices[i * 3 + 1], &v[1])) continue;
+        if (!project(vertices[i * 3 + 2], &v[2])) continue;
+
+        setup_triangle(v[0], v[1], v[2]);
+    }
+
+    link_shared_edges(first_triangle);
+}
+
+//
+// Rasterizer
+//
+
+static void rasterize_triangle(Occluder_Triangle *tri, int first_row, int end_row) {
+    int min_y = Max(tri->min_y, first_row);
+    int max_y = Min(tri->max_y, end_row);
+
+    const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 start_x = _mm_add_ps(_mm_set1_ps((f32)tri->min_x), lane_offsets);
+
+    // Three edges, then two neighbour edges behind each.
+    const int NUM_EDGES = 9;
+    f32 a[NUM_EDGES], b[NUM_EDGES], c[NUM_EDGES];
+    for (int i = 0; i < 3; i++) {
+        a[i] = tri->edge_a[i];
+        b[i] = tri->edge_b[i];
+        c[i] = tri->edge_c[i];
+
+        for (int j = 0; j < 2; j++) {
+            a[3 + i * 2 + j] = tri->neighbor_a[i][j];
+            b[3 + i * 2 + j] = tri->neighbor_b[i][j];
+            c[3 + i * 2 + j] = tri->neighbor_c[i][j];
+        }
+    }
+
+    __m128 edge_a[NUM_EDGES], edge_step[NUM_EDGES];
+    for (int i = 0; i < NUM_EDGES; i++) {
+        edge_a[i] = _mm_set1_ps(a[i]);
+        edge_step[i] = _mm_set1_ps(a[i] * 4.0f);
+    }
+    __m128 depth_step = _mm_set1_ps(tri->depth_a * 4.0f);
+    __m128 min_depth = _mm_set1_ps(tri->min_depth);
+    __m128 min_neighbor_depth = _mm_set1_ps(tri->min_neighbor_depth);
+    __m128 zero = _mm_setzero_ps();
+
+    for (int y = min_y; y < max_y; y++) {
+        f32 center_y = y + 0.5f;
+
+        __m128 edge[NUM_EDGES];
+        for (int i = 0; i < NUM_EDGES; i++) {
+            edge[i] = _mm_add_ps(_mm_mul_ps(edge_a[i], start_x), _mm_set1_ps(b[i] * center_y + c[i]));
+        }
+        __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri->depth_a), start_x), _mm_set1_ps(tri->depth_b * center_y + tri->depth_c));
+
+        f32 *row = depth_buffer + y * OCCLUSION_BUFFER_WIDTH;
+        for (int x = tri->min_x; x < tri->max_x; x += 4) {
+            __m128 inside[3];
+            for (int i = 0; i < 3; i++) inside[i] = _mm_cmpge_ps(edge[i], zero);
+
+            __m128 whole = _mm_and_ps(_mm_and_ps(inside[0], inside[1]), inside[2]);
+
+            __m128 covered = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int i = 0; i < 3; i++) {
+                __m128 in_neighbor = _mm_and_ps(_mm_cmpge_ps(edge[3 + i * 2], zero), _mm_cmpge_ps(edge[4 + i * 2], zero));
+                covered = _mm_and_ps(covered, _mm_or_ps(inside[i], in_neighbor));
+            }
+
+            if (_mm_movemask_ps(covered)) {
+                // Inside this triangle the plane is good; a pixel that takes
+                // in some of a neighbour only gets the farthest either reaches.
+                __m128 plane_depth = _mm_max_ps(depth, min_depth);
+                __m128 pixel_depth = _mm_or_ps(_mm_and_ps(whole, plane_depth), _mm_andnot_ps(whole, min_neighbor_depth));
+
+                __m128 old_depth = _mm_load_ps(row + x);
+                __m128 new_depth = _mm_max_ps(old_depth, pixel_depth);
+                _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(covered, new_depth), _mm_andnot_ps(covered, old_depth)));
+            }
+
+            for (int i = 0; i < NUM_EDGES; i++) edge[i] = _mm_add_ps(edge[i], edge_step[i]);
+            depth = _mm_add_ps(depth, depth_step);
+        }
+    }
+}
+
+struct Occlusion_Band {
+    int first_row;
+    int end_row;
+};
+
+static void rasterize_band_job_proc(void *data, int worker_index) {
+    Occlusion_Band *band = (Occlusion_Band *)data;
+
+    for (int i = 0; i < triangles.count; i++) {
+        Occluder_Triangle *tri = &triangles[i];
+        if (tri->max_y <= band->first_row || tri->min_y >= band->end_row) continue;
+
+        rasterize_triangle(tri, band->first_row, band->end_row);
+    }
+}
+
+void rasterize_occluders() {
+    if (!triangles.count) return;
+
+    // Bands share no pixels, so no locking is needed.
+    int num_bands = Min(get_num_job_workers() + 1, OCCLUSION_BUFFER_HEIGHT);
+    Occlusion_Band bands[MAX_JOB_WORKERS + 1];
+    for (int i = 0; i < num_bands; i++) {
+        bands[i].first_row = OCCLUSION_BUFFER_HEIGHT * i / num_bands;
+        bands[i].end_row = OCCLUSION_BUFFER_HEIGHT * (i + 1) / num_bands;
+    }
+
+    Job_Counter counter;
+    for (int i = 0; i < num_bands - 1; i++) {
+        add_job(rasterize_band_job_proc, &bands[i], &counter, JOB_PRIORITY_FRAME);
+    }
+
+    rasterize_band_job_proc(&bands[num_bands - 1], get_current_worker_index());
+    wait_for_counter(&counter);
+}
+
+//
+// Queries
+//
+
+bool is_box_occluded(Vector3 center, Vector3 extents) {
+    f32 min_x = (f32)OCCLUSION_BUFFER_WIDTH;
+    f32 min_y = (f32)OCCLUSION_BUFFER_HEIGHT;
+    f32 max_x = 0.0f;
+    f32 max_y = 0.0f;
+    f32 nearest = 0.0f;
+
+    for (int i = 0; i < 8; i++) {
+        Vector3 corner = center;
+        corner.x += (i & 1) ? extents.x : -extents.x;
+        corner.y += (i & 2) ? extents.y : -extents.y;
+        corner.z += (i & 4) ? extents.z : -extents.z;
+
+        Screen_Vertex v;
+        if (!project(corner, &v)) return false;
+
+        min_x = Min(min_x, v.x);
+        min_y = Min(min_y, v.y);
+        max_x = Max(max_x, v.x);
+        max_y = Max(max_y, v.y);
+        nearest = Max(nearest, v.z);
+    }
+
+    // Every pixel the box touches, even partly. Occluders only fill pixels
+    // they cover completely, so no border is needed.
+    int x0 = Max((int)floorf(min_x), 0);
+    int y0 = Max((int)floorf(min_y), 0);
+    int x1 = Min((int)ceilf(max_x), OCCLUSION_BUFFER_WIDTH);
+    int y1 = Min((int)ceilf(max_y), OCCLUSION_BUFFER_HEIGHT);
+
+    // Off screen; that's for the frustum test to decide.
+    if (min_x >= OCCLUSION_BUFFER_WIDTH || max_x <= 0.0f || min_y >= OCCLUSION_BUFFER_HEIGHT || max_y <= 0.0f) return false;
+
+    __m128 box_depth = _mm_set1_ps(nearest);
+    for (int y = y0; y < y1; y++) {
+        f32 *row = depth_buffer + y * OCCLUSION_BUFFER_WIDTH;
+
+        int x = x0;
+        for (; x + 4 <= x1; x += 4) {
+            // Any pixel not strictly nearer than the box lets it show.
+            if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + x), box_depth))) return false;
+        }
+        for (; x < x1; x++) {
+            if (row[x] <= nearest) return false;
+        }
+    }
+
+    return true;
+}
+
+Occlusion_Stats get_occlusion_stats() {
+    return stats;
+}
+
+f32 *get_occlusion_buffer() {
+    return depth_buffer;
+}
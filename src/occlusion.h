@@ -0,0 +1,59 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "geometry.h"
+
+// Software occlusion culling. Each frame, occluders are rasterized into a
+// small depth buffer on the CPU, and bounding boxes are tested against it
+// before anything is submitted. Occluders must be geometry that is certainly
+// solid and opaque, like the ground under the lowest point of each terrain
+// chunk (see add_terrain_occluders).
+//
+// Depth is stored as 1/w, which interpolates linearly across the screen.
+// Bigger is nearer, and 0 means nothing was drawn there. Everything errs
+// towards visible:
+// - Occluders only fill pixels they cover completely. Triangles from the same
+//   add_occluder_triangles call that share an edge cover the pixels along it
+//   together, so meshes don't crack along their seams.
+// - Each pixel gets the farthest depth the occluders reach inside it.
+// - A box counts as occluded only if every pixel it touches holds something
+//   nearer than the box's nearest corner.
+//
+// This is a plain per-pixel depth buffer rasterized in horizontal bands, one
+// per job worker plus one on the calling thread, four pixels at a time with
+// SSE; there's no tiling or coverage masks.
+
+const int OCCLUSION_BUFFER_WIDTH = 256; // Multiple of 4.
+const int OCCLUSION_BUFFER_HEIGHT = 128;
+
+// Occluder triangles with a vertex nearer than this, in w, are dropped rather
+// than clipped. Leaving an occluder out is always safe. Boxes reaching this
+// close are always visible.
+const f32 OCCLUSION_NEAR_W = 0.5f;
+
+struct Occlusion_Stats {
+    int num_triangles;            // Added this frame.
+    int num_triangles_rasterized; // Survived near and screen rejection.
+};
+
+// Clears the buffer and starts collecting occluders seen through
+// 'world_to_proj'.
+void begin_occlusion_frame(Matrix4 world_to_proj);
+
+// World space, three vertices per triangle. Either winding. Triangles that
+// share an edge must use bitwise identical vertices for it.
+void add_occluder_triangles(Vector3 *vertices, int num_triangles);
+
+// Returns once every occluder added since begin_occlusion_frame is in the
+// buffer. Main thread only.
+void rasterize_occluders();
+
+// True only if the box is certainly hidden behind occluders.
+bool is_box_occluded(Vector3 center, Vector3 extents);
+
+Occlusion_Stats get_occlusion_stats();
+
+// OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT values, bottom row first.
+f32 *get_occlusion_buffer();
+
+#endif
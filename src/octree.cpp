@@ -0,0 +1,374 @@
+#include "octree.h"
+
+#include "entities.h"
+#include "memory_tags.h"
+
+static Octree_Node *make_node(Octree *tree, Octree_Node *parent, Vector3 center, f32 half_size) {
+    Octree_Node *node = TAGGED_NEW(MEMORY_TAG_SCENE, Octree_Node);
+    node->entities = Array <Entity *>(make_tagged_allocator(MEMORY_TAG_SCENE));
+    node->center = center;
+    node->half_size = half_size;
+    node->depth = parent ? parent->depth + 1 : 0;
+    node->parent = parent;
+
+    tree->num_nodes++;
+    return node;
+}
+
+static void destroy_node(Octree_Node *node) {
+    for (int i = 0; i < 8; i++) {
+        if (node->children[i]) destroy_node(node->children[i]);
+    }
+
+    for (int i = 0; i < node->entities.count; i++) {
+        node->entities[i]->octree_node = nullptr;
+        node->entities[i]->octree_index = -1;
+    }
+
+    tagged_delete(node);
+}
+
+void init_octree(Octree *tree, Vector3 center, f32 half_size, int max_depth) {
+    tree->max_depth = max_depth;
+    tree->num_nodes = 0;
+    tree->root = make_node(tree, nullptr, center, half_size);
+}
+
+void destroy_octree(Octree *tree) {
+    if (tree->root) destroy_node(tree->root);
+    tree->root = nullptr;
+    tree->num_nodes = 0;
+}
+
+static inline f32 get_loose_half_size(Octree_Node *node) {
+    return node->half_size * 2.0f;
+}
+
+// Walks down through split nodes to the one the bounds belong in, making
+// children on the way.
+static Octree_Node *find_node_for(Octree *tree, Bounds *bounds) {
+    Octree_Node *node = tree->root;
+
+    Vector3 center = bounds->box_center;
+    Vector3 offset = center - node->center;
+    if (fabsf(offset.x) > node->half_size || fabsf(offset.y) > node->half_size || fabsf(offset.z) > node->half_size) {
+        return node;
+    }
+
+    f32 size = Max(bounds->box_extents.x, Max(bounds->box_extents.y, bounds->box_extents.z));
+
+    while (node->is_split) {
+        f32 child_half_size = node->half_size * 0.5f;
+        if (size > child_half_size) break;
+
+        int index = 0;
+        if (center.x >= node->center.x) index |= 1;
+        if (center.y >= node->center.y) index |= 2;
+        if (center.z >= node->center.z) index |= 4;
+
+        if (!node->children[index]) {
+            Vector3 child_center = node->center;
+            child_center.x += (index & 1) ? child_half_size : -child_half_size;
+            child_center.y += (index & 2) ? child_half_size : -child_half_size;
+            child_center.z += (index & 4) ? child_half_size : -child_half_size;
+
+            node->children[index] = make_node(tree, node, child_center, child_half_size);
+        }
+
+        node = node->children[index];
+    }
+
+    return node;
+}
+
+static void add_to_node(Octree *tree, Octree_Node *node, Entity *entity);
+
+// Pushes down whatever fits in the new children. Those can end up over the
+// limit themselves and split in turn.
+static void split_node(Octree *tree, Octree_Node *node) {
+    node->is_split = true;
+
+    // Backwards, so the swap in remove_from_octree only ever moves an entity
+    // that has already been looked at.
+    for (int i = node->entities.count - 1; i >= 0; i--) {
+        Entity *entity = node->entities[i];
+
+        Octree_Node *target = find_node_for(tree, &entity->bounds);
+        if (target == node) continue;
+
+        remove_from_octree(tree, entity);
+        add_to_node(tree, target, entity);
+    }
+}
+
+static void add_to_node(Octree *tree, Octree_Node *node, Entity *entity) {
+    entity->octree_node = node;
+    entity->octree_index = node->entities.count;
+    node->entities.add(entity);
+
+    for (Octree_Node *n = node; n; n = n->parent) n->num_entities_in_subtree++;
+
+    if (!node->is_split && node->depth < tree->max_depth && node->entities.count > OCTREE_SPLIT_THRESHOLD) {
+        split_node(tree, node);
+    }
+}
+
+void insert_into_octree(Octree *tree, Entity *entity) {
+    assert(!entity->octree_node);
+    add_to_node(tree, find_node_for(tree, &entity->bounds), entity);
+}
+
+void remove_from_octree(Octree *tree, Entity *entity) {
+    Octree_Node *node = entity->octree_node;
+    if (!node) return;
+
+    // Swap remove; whoever was last now has this entity's slot.
+    int index = entity->octree_index;
+    node->entities.remove_nth(index);
+    if (index < node->entities.count) node->entities[index]->octree_index = index;
+
+    for (Octree_Node *n = node; n; n = n->parent) n->num_entities_in_subtree--;
+
+    entity->octree_node = nullptr;
+    entity->octree_index = -1;
+}
+
+void update_in_octree(Octree *tree, Entity *entity) {
+    Octree_Node *node = find_node_for(tree, &entity->bounds);
+    if (node == entity->octree_node) return;
+
+    remove_from_octree(tree, entity);
+    add_to_node(tree, node, entity);
+}
+
+//
+// Frustum
+//
+
+struct Frustum_Query {
+    Frustum *frustum;
+    Array <Entity *> *results;
+
+    // Entities from nodes that straddle a plane, tested together at the end.
+    Cull_Batch batch;
+    Entity **candidates;
+};
+
+static void add_subtree(Octree_Node *node, Array <Entity *> *results) {
+    for (int i = 0; i < node->entities.count; i++) {
+        results->add(node->entities[i]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Octree_Node *child = node->children[i];
+        if (child && child->num_entities_in_subtree) add_subtree(child, results);
+    }
+}
+
+// 'plane_mask' has a bit for each plane the parent wasn't already entirely
+// inside of; those are the only ones worth testing further down.
+static void query_frustum_node(Octree_Node *node, Frustum_Query *query, u32 plane_mask) {
+    if (node->parent) {
+        f32 h = get_loose_half_size(node);
+
+        for (int p = 0; p < 6; p++) {
+            if (!(plane_mask & (1 << p))) continue;
+
+            Vector4 plane = query->frustum->planes[p];
+            f32 d = plane.x * node->center.x + plane.y * node->center.y + plane.z * node->center.z + plane.w;
+            f32 r = h * (fabsf(plane.x) + fabsf(plane.y) + fabsf(plane.z));
+
+            if (d + r < 0.0f) {
+                add_culling_stats(0, node->num_entities_in_subtree);
+                return;
+            }
+
+            if (d - r >= 0.0f) plane_mask &= ~(1 << p);
+        }
+
+        if (!plane_mask) {
+            add_culling_stats(node->num_entities_in_subtree, 0);
+            add_subtree(node, query->results);
+            return;
+        }
+    }
+
+    for (int i = 0; i < node->entities.count; i++) {
+        Entity *entity = node->entities[i];
+        query->candidates[add_to_cull_batch(&query->batch, entity->bounds)] = entity;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Octree_Node *child = node->children[i];
+        if (child && child->num_entities_in_subtree) query_frustum_node(child, query, plane_mask);
+    }
+}
+
+void query_octree_frustum(Octree *tree, Frustum *frustum, Array <Entity *> *results) {
+    if (!tree->root || !tree->root->num_entities_in_subtree) return;
+
+    // Scratch comes from the frame arena without a rewind, since 'results'
+    // may well be growing in it too.
+    int capacity = tree->root->num_entities_in_subtree;
+
+    Frustum_Query query;
+    query.frustum = frustum;
+    query.results = results;
+    query.candidates = (Entity **)arena_push(&frame_arena, capacity * sizeof(Entity *));
+    begin_cull_batch(&query.batch, capacity, &frame_arena);
+
+    query_frustum_node(tree->root, &query, (1 << 6) - 1);
+
+    u8 *visible = (u8 *)arena_push(&frame_arena, query.batch.count);
+    cull_batch(frustum, &query.batch, visible);
+
+    for (int i = 0; i < query.batch.count; i++) {
+        if (visible[i]) results->add(query.candidates[i]);
+    }
+}
+
+//
+// Overlap
+//
+
+static f32 get_distance_squared_to_box(Vector3 point, Vector3 center, Vector3 extents) {
+    f32 result = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        f32 d = fabsf(point.e[i] - center.e[i]) - extents.e[i];
+        if (d > 0.0f) result += d * d;
+    }
+
+    return result;
+}
+
+static bool boxes_overlap(Vector3 center_a, Vector3 extents_a, Vector3 center_b, Vector3 extents_b) {
+    for (int i = 0; i < 3; i++) {
+        if (fabsf(center_a.e[i] - center_b.e[i]) > extents_a.e[i] + extents_b.e[i]) return false;
+    }
+
+    return true;
+}
+
+static void query_sphere_node(Octree_Node *node, Vector3 center, f32 radius, Array <Entity *> *results) {
+    if (node->parent) {
+        f32 h = get_loose_half_size(node);
+        if (get_distance_squared_to_box(center, node->center, make_vector3(h, h, h)) > radius * radius) return;
+    }
+
+    for (int i = 0; i < node->entities.count; i++) {
+        Entity *entity = node->entities[i];
+        Bounds *bounds = &entity->bounds;
+
+        if (get_distance_squared_to_box(center, bounds->box_center, bounds->box_extents) > radius * radius) continue;
+
+        f32 reach = radius + bounds->sphere_radius;
+        if (get_length_squared(center - bounds->sphere_center) > reach * reach) continue;
+
+        results->add(entity);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Octree_Node *child = node->children[i];
+        if (child && child->num_entities_in_subtree) query_sphere_node(child, center, radius, results);
+    }
+}
+
+void query_octree_sphere(Octree *tree, Vector3 center, f32 radius, Array <Entity *> *results) {
+    if (!tree->root) return;
+    query_sphere_node(tree->root, center, radius, results);
+}
+
+static void query_box_node(Octree_Node *node, Vector3 center, Vector3 extents, Array <Entity *> *results) {
+    if (node->parent) {
+        f32 h = get_loose_half_size(node);
+        if (!boxes_overlap(center, extents, node->center, make_vector3(h, h, h))) return;
+    }
+
+    for (int i = 0; i < node->entities.count; i++) {
+        Entity *entity = node->entities[i];
+        Bounds *bounds = &entity->bounds;
+
+        if (!boxes_overlap(center, extents, bounds->box_center, bounds->box_extents)) continue;
+        if (get_distance_squared_to_box(bounds->sphere_center, center, extents) > bounds->sphere_radius * bounds->sphere_radius) continue;
+
+        results->add(entity);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Octree_Node *child = node->children[i];
+        if (child && child->num_entities_in_subtree) query_box_node(child, center, extents, results);
+    }
+}
+
+void query_octree_box(Octree *tree, Vector3 center, Vector3 extents, Array <Entity *> *results) {
+    if (!tree->root) return;
+    query_box_node(tree->root, center, extents, results);
+}
+
+//
+// Rays
+//
+
+struct Ray {
+    Vector3 origin;
+    Vector3 inverse_direction;
+};
+
+// Slab test. Returns the entry distance, or a negative number on a miss.
+static f32 intersect_ray_box(Ray *ray, Vector3 center, Vector3 extents, f32 max_distance) {
+    f32 t_min = 0.0f;
+    f32 t_max = max_distance;
+
+    for (int i = 0; i < 3; i++) {
+        // Axis-parallel rays have an infinite inverse here, which makes both
+        // t's infinite with the right signs.
+        f32 t0 = (center.e[i] - extents.e[i] - ray->origin.e[i]) * ray->inverse_direction.e[i];
+        f32 t1 = (center.e[i] + extents.e[i] - ray->origin.e[i]) * ray->inverse_direction.e[i];
+        if (t0 > t1) {
+            f32 t = t0;
+            t0 = t1;
+            t1 = t;
+        }
+
+        t_min = Max(t_min, t0);
+        t_max = Min(t_max, t1);
+        if (t_min > t_max) return -1.0f;
+    }
+
+    return t_min;
+}
+
+static void raycast_node(Octree_Node *node, Ray *ray, Octree_Ray_Hit *hit) {
+    if (node->parent) {
+        f32 h = get_loose_half_size(node);
+        if (intersect_ray_box(ray, node->center, make_vector3(h, h, h), hit->distance) < 0.0f) return;
+    }
+
+    for (int i = 0; i < node->entities.count; i++) {
+        Entity *entity = node->entities[i];
+
+        f32 t = intersect_ray_box(ray, entity->bounds.box_center, entity->bounds.box_extents, hit->distance);
+        if (t >= 0.0f && (!hit->entity || t < hit->distance)) {
+            hit->entity = entity;
+            hit->distance = t;
+        }
+    }
+
+    for (int i = 0; i < 8; i++) {
+        Octree_Node *child = node->children[i];
+        if (child && child->num_entities_in_subtree) raycast_node(child, ray, hit);
+    }
+}
+
+bool raycast_octree(Octree *tree, Vector3 origin, Vector3 direction, f32 max_distance, Octree_Ray_Hit *hit) {
+    hit->entity = nullptr;
+    hit->distance = max_distance;
+    if (!tree->root) return false;
+
+    Ray ray;
+    ray.origin = origin;
+    ray.inverse_direction = make_vector3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+    raycast_node(tree->root, &ray, hit);
+    return hit->entity != nullptr;
+}
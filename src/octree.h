@@ -0,0 +1,75 @@
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include "array.h"
+#include "geometry.h"
+#include "culling.h"
+
+struct Entity;
+
+// Loose octree over entity world bounds. Each node's cell is a cube, and its
+// loose bounds are twice the cell's size. An entity lives in the deepest node
+// whose cell holds its box center and whose half size is at least the
+// largest of its box extents. That keeps the box inside the node's loose
+// bounds, and each entity sits in exactly one node.
+//
+// Nodes only split once they hold more than OCTREE_SPLIT_THRESHOLD entities,
+// so sparse areas don't grow long chains of nearly empty nodes. Moving an
+// entity only re-files it when it crosses into another node, which is a walk
+// down from the root. Nodes are kept once they exist; queries skip subtrees
+// with nothing in them. Entities whose center is outside the root cell stay
+// in the root, which every query visits.
+
+const int OCTREE_DEFAULT_MAX_DEPTH = 8;
+const int OCTREE_SPLIT_THRESHOLD = 16;
+
+struct Octree_Node {
+    Vector3 center;
+    f32 half_size; // Of the cell. Loose bounds reach twice as far.
+    int depth;
+
+    Octree_Node *parent;
+    Octree_Node *children[8];
+
+    Array <Entity *> entities;
+    int num_entities_in_subtree;
+
+    // Once set, entities that fit go to the children instead.
+    bool is_split;
+};
+
+struct Octree {
+    Octree_Node *root = nullptr;
+    int max_depth = OCTREE_DEFAULT_MAX_DEPTH;
+    int num_nodes = 0;
+};
+
+struct Octree_Ray_Hit {
+    Entity *entity;
+    f32 distance;
+};
+
+void init_octree(Octree *tree, Vector3 center, f32 half_size, int max_depth = OCTREE_DEFAULT_MAX_DEPTH);
+void destroy_octree(Octree *tree);
+
+// These use entity->bounds, so refresh it first. update_in_octree inserts
+// entities that aren't in the tree yet.
+void insert_into_octree(Octree *tree, Entity *entity);
+void remove_from_octree(Octree *tree, Entity *entity);
+void update_in_octree(Octree *tree, Entity *entity);
+
+// Queries append to 'results'. An entity matches if its world box and sphere
+// both overlap the query volume.
+//
+// The frustum query rejects and accepts whole nodes where it can. Entities in
+// nodes that straddle a plane go through cull_batch, and every entity counts
+// towards the culling stats. Its scratch memory is pushed on frame_arena.
+void query_octree_frustum(Octree *tree, Frustum *frustum, Array <Entity *> *results);
+void query_octree_sphere(Octree *tree, Vector3 center, f32 radius, Array <Entity *> *results);
+void query_octree_box(Octree *tree, Vector3 center, Vector3 extents, Array <Entity *> *results);
+
+// Nearest entity whose world box the ray hits within max_distance. Tests boxes
+// only, not triangles. 'direction' must be normalized.
+bool raycast_octree(Octree *tree, Vector3 origin, Vector3 direction, f32 max_distance, Octree_Ray_Hit *hit);
+
+#endif
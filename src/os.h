@@ -15,9 +15,23 @@ Time os_get_local_time();
 double os_get_time();
 
 char *os_read_entire_file(char *filepath, s64 *out_length = nullptr);
+// Reads exactly 'size' bytes starting at 'offset'; false if the file is shorter.
+bool os_read_file_range(char *filepath, s64 offset, s64 size, void *dest);
 bool os_file_exists(char *filepath);
 void os_get_last_write_time(char *file_path, u64 *out_time);
 
+struct File_Info {
+    char *full_path; // Only valid during the callback.
+    s64 size;
+    u64 modification_time;
+};
+
+typedef void (*Visit_File_Proc)(File_Info *info, void *data);
+
+// Calls proc for every regular file under directory. Sizes and times come from
+// the directory enumeration itself, so there is no extra syscall per file.
+void os_visit_files(char *directory, Visit_File_Proc proc, void *data, bool recursive = true);
+
 void os_poll_events();
 
 char *os_get_path_to_executable();
@@ -28,4 +42,29 @@ void os_show_cursor();
 
 void os_get_mouse_pointer_position(int *x, int *y, bool flipped = true);
 
+struct Thread;
+struct Mutex;
+struct Semaphore;
+
+typedef void (*Thread_Proc)(void *data);
+
+Thread *os_create_thread(Thread_Proc proc, void *data);
+int os_get_processor_count();
+void os_sleep(u32 milliseconds);
+
+// Asks for os_sleep to be as close to millisecond accurate as the OS can
+// manage, for the rest of the run.
+void os_enable_fine_sleep();
+
+Mutex *os_create_mutex();
+void os_lock_mutex(Mutex *mutex);
+void os_unlock_mutex(Mutex *mutex);
+
+Semaphore *os_create_semaphore(int initial_count, int max_count);
+void os_wait_semaphore(Semaphore *semaphore);
+void os_signal_semaphore(Semaphore *semaphore, int count = 1);
+
+// Returns the value after the addition.
+s32 os_atomic_add(volatile s32 *value, s32 addend);
+
 #endif
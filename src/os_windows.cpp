@@ -87,6 +87,32 @@ char *os_read_entire_file(char *filepath, s64 *out_length) {
     return result;
 }
 
+bool os_read_file_range(char *filepath, s64 offset, s64 size, void *dest) {
+    wchar_t *wide_filepath = win32_utf8_to_utf16(filepath);
+    defer { delete [] wide_filepath; };
+
+    HANDLE file = CreateFileW(wide_filepath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    defer { CloseHandle(file); };
+
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    if (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN)) return false;
+
+    u8 *at = (u8 *)dest;
+    while (size > 0) {
+        DWORD chunk = (DWORD)Min(size, (s64)(1 << 30));
+        DWORD num_bytes_read = 0;
+        if (!ReadFile(file, at, chunk, &num_bytes_read, nullptr) || num_bytes_read != chunk) return false;
+
+        at += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
 void os_poll_events() {
     for (int i = 0; i < NUM_KEYS; i++) {
         key_infos[i].was_down = key_infos[i].is_down;
@@ -228,4 +254,121 @@ void os_get_last_write_time(char *file_path, u64 *out_time) {
     CloseHandle(file);
 }
 
+void os_visit_files(char *directory, Visit_File_Proc proc, void *data, bool recursive) {
+    char *pattern = mprintf("%s/*", directory);
+    defer { delete [] pattern; };
+
+    wchar_t *wide_pattern = win32_utf8_to_utf16(pattern);
+    defer { delete [] wide_pattern; };
+
+    WIN32_FIND_DATAW find_data;
+    HANDLE handle = FindFirstFileExW(wide_pattern, FindExInfoBasic, &find_data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    defer { FindClose(handle); };
+
+    do {
+        char *name = win32_utf16_to_utf8(find_data.cFileName);
+        defer { delete [] name; };
+
+        if (strings_match(name, ".") || strings_match(name, "..")) continue;
+
+        char *full_path = mprintf("%s/%s", directory, name);
+        defer { delete [] full_path; };
+
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (recursive) os_visit_files(full_path, proc, data, true);
+            continue;
+        }
+
+        ULARGE_INTEGER write_time;
+        write_time.LowPart = find_data.ftLastWriteTime.dwLowDateTime;
+        write_time.HighPart = find_data.ftLastWriteTime.dwHighDateTime;
+
+        File_Info info;
+        info.full_path = full_path;
+        info.size = ((s64)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+        info.modification_time = write_time.QuadPart;
+        proc(&info, data);
+    } while (FindNextFileW(handle, &find_data));
+}
+
+struct Thread {
+    HANDLE handle;
+    Thread_Proc proc;
+    void *data;
+};
+
+struct Mutex {
+    SRWLOCK lock;
+};
+
+struct Semaphore {
+    HANDLE handle;
+};
+
+static DWORD WINAPI win32_thread_proc(LPVOID parameter) {
+    Thread *thread = (Thread *)parameter;
+    thread->proc(thread->data);
+    return 0;
+}
+
+Thread *os_create_thread(Thread_Proc proc, void *data) {
+    Thread *result = new Thread();
+    result->proc = proc;
+    result->data = data;
+    result->handle = CreateThread(nullptr, 0, win32_thread_proc, result, 0, nullptr);
+    if (!result->handle) {
+        delete result;
+        return nullptr;
+    }
+    return result;
+}
+
+int os_get_processor_count() {
+    SYSTEM_INFO system_info = {};
+    GetSystemInfo(&system_info);
+    return (int)system_info.dwNumberOfProcessors;
+}
+
+void os_sleep(u32 milliseconds) {
+    Sleep(milliseconds);
+}
+
+void os_enable_fine_sleep() {
+    // Sleep otherwise rounds up to the default 15.6 ms timer tick.
+    timeBeginPeriod(1);
+}
+
+Mutex *os_create_mutex() {
+    Mutex *result = new Mutex();
+    InitializeSRWLock(&result->lock);
+    return result;
+}
+
+void os_lock_mutex(Mutex *mutex) {
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void os_unlock_mutex(Mutex *mutex) {
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+Semaphore *os_create_semaphore(int initial_count, int max_count) {
+    Semaphore *result = new Semaphore();
+    result->handle = CreateSemaphoreW(nullptr, initial_count, max_count, nullptr);
+    return result;
+}
+
+void os_wait_semaphore(Semaphore *semaphore) {
+    WaitForSingleObject(semaphore->handle, INFINITE);
+}
+
+void os_signal_semaphore(Semaphore *semaphore, int count) {
+    ReleaseSemaphore(semaphore->handle, count, nullptr);
+}
+
+s32 os_atomic_add(volatile s32 *value, s32 addend) {
+    return InterlockedAdd((volatile LONG *)value, addend);
+}
+
 #endif
@@ -0,0 +1,194 @@
+#include "pixel_convert.h"
+
+#include "jobs.h"
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static bool detect_ssse3() {
+    int info[4] = {};
+#ifdef _MSC_VER
+    __cpuid(info, 1);
+#else
+    __get_cpuid(1, (unsigned int *)&info[0], (unsigned int *)&info[1], (unsigned int *)&info[2], (unsigned int *)&info[3]);
+#endif
+    return (info[2] & (1 << 9)) != 0;
+}
+
+static bool has_ssse3() {
+    static bool result = detect_ssse3();
+    return result;
+}
+
+//
+// Kernels
+//
+
+// Spreads 16 packed 3-byte pixels (48 bytes) over four registers of four
+// 4-byte pixels, then lets 'mask' place the bytes within each pixel.
+static inline void expand_16_rgb_pixels(u8 *source, __m128i mask, __m128i out[4]) {
+    __m128i in0 = _mm_loadu_si128((__m128i *)(source + 0));
+    __m128i in1 = _mm_loadu_si128((__m128i *)(source + 16));
+    __m128i in2 = _mm_loadu_si128((__m128i *)(source + 32));
+
+    out[0] = _mm_shuffle_epi8(in0, mask);
+    out[1] = _mm_shuffle_epi8(_mm_alignr_epi8(in1, in0, 12), mask);
+    out[2] = _mm_shuffle_epi8(_mm_alignr_epi8(in2, in1, 8), mask);
+    out[3] = _mm_shuffle_epi8(_mm_srli_si128(in2, 4), mask);
+}
+
+static void convert_rgb_to_rgba_band(u8 *source, u8 *dest, s64 num_pixels, int channels) {
+    s64 i = 0;
+
+    if (has_ssse3()) {
+        const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+        for (; i + 16 <= num_pixels; i += 16) {
+            __m128i out[4];
+            expand_16_rgb_pixels(source + i * 3, mask, out);
+
+            for (int j = 0; j < 4; j++) {
+                _mm_storeu_si128((__m128i *)(dest + i * 4 + j * 16), _mm_or_si128(out[j], alpha));
+            }
+        }
+    }
+
+    for (; i < num_pixels; i++) {
+        dest[i * 4 + 0] = source[i * 3 + 0];
+        dest[i * 4 + 1] = source[i * 3 + 1];
+        dest[i * 4 + 2] = source[i * 3 + 2];
+        dest[i * 4 + 3] = 255;
+    }
+}
+
+static void convert_a8_to_rgba_band(u8 *source, u8 *dest, s64 num_pixels, int channels) {
+    s64 i = 0;
+
+    // Interleaving with all-ones twice turns each coverage byte a into
+    // ff ff ff a, no shuffles needed.
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (; i + 16 <= num_pixels; i += 16) {
+        __m128i coverage = _mm_loadu_si128((__m128i *)(source + i));
+        __m128i low = _mm_unpacklo_epi8(ones, coverage);
+        __m128i high = _mm_unpackhi_epi8(ones, coverage);
+
+        _mm_storeu_si128((__m128i *)(dest + i * 4 + 0),  _mm_unpacklo_epi16(ones, low));
+        _mm_storeu_si128((__m128i *)(dest + i * 4 + 16), _mm_unpackhi_epi16(ones, low));
+        _mm_storeu_si128((__m128i *)(dest + i * 4 + 32), _mm_unpacklo_epi16(ones, high));
+        _mm_storeu_si128((__m128i *)(dest + i * 4 + 48), _mm_unpackhi_epi16(ones, high));
+    }
+
+    for (; i < num_pixels; i++) {
+        dest[i * 4 + 0] = 255;
+        dest[i * 4 + 1] = 255;
+        dest[i * 4 + 2] = 255;
+        dest[i * 4 + 3] = source[i];
+    }
+}
+
+static void convert_to_packed_rgb_band(u8 *source, u8 *dest_bytes, s64 num_pixels, int channels) {
+    u32 *dest = (u32 *)dest_bytes;
+    s64 i = 0;
+
+    // Little endian, so 0x00RRGGBB is the bytes b g r 0.
+    if (has_ssse3()) {
+        if (channels == 3) {
+            const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+
+            for (; i + 16 <= num_pixels; i += 16) {
+                __m128i out[4];
+                expand_16_rgb_pixels(source + i * 3, mask, out);
+
+                for (int j = 0; j < 4; j++) {
+                    _mm_storeu_si128((__m128i *)(dest + i + j * 4), out[j]);
+                }
+            }
+        } else if (channels == 4) {
+            const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1);
+
+            for (; i + 4 <= num_pixels; i += 4) {
+                __m128i in = _mm_loadu_si128((__m128i *)(source + i * 4));
+                _mm_storeu_si128((__m128i *)(dest + i), _mm_shuffle_epi8(in, mask));
+            }
+        }
+    }
+
+    for (; i < num_pixels; i++) {
+        u8 *pixel = source + i * channels;
+        dest[i] = (pixel[0] << 16) | (pixel[1] << 8) | (pixel[2] << 0);
+    }
+}
+
+//
+// Banding
+//
+
+typedef void (*Convert_Band_Proc)(u8 *source, u8 *dest, s64 num_pixels, int channels);
+
+struct Convert_Band {
+    Convert_Band_Proc proc;
+    u8 *source;
+    u8 *dest;
+    s64 num_pixels;
+    int channels;
+};
+
+static void convert_band_job_proc(void *data, int worker_index) {
+    Convert_Band *band = (Convert_Band *)data;
+    band->proc(band->source, band->dest, band->num_pixels, band->channels);
+}
+
+static void run_conversion(Convert_Band_Proc proc, u8 *source, int source_pixel_size, u8 *dest, int dest_pixel_size, s64 num_pixels, int channels) {
+    int num_workers = get_num_job_workers();
+    if (num_pixels < PIXEL_CONVERT_PARALLEL_THRESHOLD || !num_workers) {
+        proc(source, dest, num_pixels, channels);
+        return;
+    }
+
+    // One band per worker plus one for this thread. Bands are whole multiples
+    // of 16 pixels so only the last one runs a scalar tail.
+    int num_bands = num_workers + 1;
+    s64 band_size = (num_pixels / num_bands + 15) & ~(s64)15;
+
+    Convert_Band bands[MAX_JOB_WORKERS + 1];
+    Job_Counter counter;
+
+    s64 first = 0;
+    int count = 0;
+    while (first < num_pixels) {
+        Convert_Band *band = &bands[count++];
+        band->proc = proc;
+        band->source = source + first * source_pixel_size;
+        band->dest = dest + first * dest_pixel_size;
+        band->num_pixels = Min(band_size, num_pixels - first);
+        band->channels = channels;
+        first += band->num_pixels;
+    }
+
+    for (int i = 0; i < count - 1; i++) {
+        add_job(convert_band_job_proc, &bands[i], &counter, JOB_PRIORITY_FRAME);
+    }
+
+    convert_band_job_proc(&bands[count - 1], get_current_worker_index());
+    wait_for_counter(&counter);
+}
+
+void convert_rgb_to_rgba(u8 *source, u8 *dest, s64 num_pixels) {
+    run_conversion(convert_rgb_to_rgba_band, source, 3, dest, 4, num_pixels, 3);
+}
+
+void convert_a8_to_rgba(u8 *source, u8 *dest, s64 num_pixels) {
+    run_conversion(convert_a8_to_rgba_band, source, 1, dest, 4, num_pixels, 1);
+}
+
+void convert_to_packed_rgb(u8 *source, int channels, u32 *dest, s64 num_pixels) {
+    assert(channels == 3 || channels == 4);
+    run_conversion(convert_to_packed_rgb_band, source, channels, (u8 *)dest, 4, num_pixels, channels);
+}
@@ -0,0 +1,25 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include "general.h"
+
+// Bulk pixel format conversions. Each one walks a contiguous run of pixels,
+// 16 at a time with SSSE3 shuffles (SSE2 where that's enough) and a scalar
+// tail. CPUs without SSSE3 get the scalar loop.
+//
+// Runs of at least PIXEL_CONVERT_PARALLEL_THRESHOLD pixels are split into
+// bands and spread over the job workers; the call still returns only once
+// everything is converted. Source and destination must not overlap.
+
+const s64 PIXEL_CONVERT_PARALLEL_THRESHOLD = 256 * 1024;
+
+// RGB8 -> RGBA8 with alpha 255.
+void convert_rgb_to_rgba(u8 *source, u8 *dest, s64 num_pixels);
+
+// A8 coverage -> white RGBA8 with that alpha, the way glyphs are stored.
+void convert_a8_to_rgba(u8 *source, u8 *dest, s64 num_pixels);
+
+// RGB8 or RGBA8 -> 0x00RRGGBB, the 24-bit value height maps are read as.
+void convert_to_packed_rgb(u8 *source, int channels, u32 *dest, s64 num_pixels);
+
+#endif
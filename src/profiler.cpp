@@ -0,0 +1,162 @@
+#include "profiler.h"
+
+#ifdef PROFILER_ENABLED
+
+#include "os.h"
+
+#include <stdio.h>
+
+struct Profile_Thread {
+    Profile_Event events[PROFILE_EVENTS_PER_THREAD];
+
+    // Count of events ever written; the newest is at (num_events - 1) mod the
+    // ring size. Bumped only once the event is complete, so a reader never
+    // sees half of one unless the writer has lapped it.
+    volatile s32 num_events;
+
+    int depth;
+};
+
+static Profile_Thread threads[MAX_PROFILE_THREADS];
+
+static u64 frame_starts[MAX_PROFILE_FRAMES];
+static u32 num_frames;
+
+static u64 calibration_ticks;
+static f64 calibration_time;
+static f64 ticks_per_second = 1.0;
+
+void init_profiler() {
+    // A short spin for a first estimate. begin_profile_frame refines it over
+    // a longer baseline once the game is running.
+    calibration_ticks = read_profile_clock();
+    calibration_time = os_get_time();
+
+    f64 time = calibration_time;
+    while (time - calibration_time < 0.01) time = os_get_time();
+
+    ticks_per_second = (f64)(read_profile_clock() - calibration_ticks) / (time - calibration_time);
+}
+
+Profile_Thread *begin_profile_scope() {
+    Profile_Thread *thread = &threads[get_current_worker_index()];
+    thread->depth++;
+    return thread;
+}
+
+void end_profile_scope(Profile_Thread *thread, char *name, u64 start) {
+    u64 end = read_profile_clock();
+    thread->depth--;
+
+    u32 index = (u32)thread->num_events;
+    Profile_Event *event = &thread->events[index & (PROFILE_EVENTS_PER_THREAD - 1)];
+    event->name = name;
+    event->start = start;
+    event->end = end;
+    event->depth = thread->depth;
+
+    os_atomic_add(&thread->num_events, 1);
+}
+
+void begin_profile_frame() {
+    u64 now = read_profile_clock();
+    frame_starts[num_frames & (MAX_PROFILE_FRAMES - 1)] = now;
+    num_frames++;
+
+    f64 elapsed = os_get_time() - calibration_time;
+    if (elapsed > 1.0) ticks_per_second = (f64)(now - calibration_ticks) / elapsed;
+}
+
+bool get_last_profile_frame(u64 *start, u64 *end) {
+    if (num_frames < 2) return false;
+
+    *start = frame_starts[(num_frames - 2) & (MAX_PROFILE_FRAMES - 1)];
+    *end = frame_starts[(num_frames - 1) & (MAX_PROFILE_FRAMES - 1)];
+    return true;
+}
+
+f64 get_profile_seconds(u64 ticks) {
+    return (f64)ticks / ticks_per_second;
+}
+
+// Workers keep writing while we read. Staying a quarter of the ring behind
+// the newest event leaves them that much room before they reach our slots.
+static u32 get_num_readable_events(u32 num_events) {
+    return Min(num_events, (u32)(PROFILE_EVENTS_PER_THREAD / 4 * 3));
+}
+
+int get_profile_events(int thread_index, u64 start, u64 end, Profile_Event *events, int max_events) {
+    assert(thread_index >= 0 && thread_index < MAX_PROFILE_THREADS);
+    Profile_Thread *thread = &threads[thread_index];
+
+    u32 num_events = (u32)thread->num_events;
+    u32 num_readable = get_num_readable_events(num_events);
+
+    int count = 0;
+    for (u32 i = 0; i < num_readable && count < max_events; i++) {
+        Profile_Event *event = &thread->events[(num_events - 1 - i) & (PROFILE_EVENTS_PER_THREAD - 1)];
+
+        // Events go in as they end, so everything older ended earlier still.
+        if (event->end <= start) break;
+        if (event->start >= end) continue;
+
+        events[count++] = *event;
+    }
+
+    return count;
+}
+
+static f64 get_trace_microseconds(u64 ticks) {
+    return (f64)((s64)(ticks - calibration_ticks)) / ticks_per_second * 1000000.0;
+}
+
+bool write_profile_trace_json(char *file_path) {
+    FILE *file = fopen(file_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s' for writing.\n", file_path);
+        return false;
+    }
+    defer { fclose(file); };
+
+    int main_thread_index = get_num_job_workers();
+
+    fprintf(file, "{\"traceEvents\": [\n");
+    fprintf(file, "    {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"tm3d\"}}");
+
+    for (int i = 0; i < MAX_PROFILE_THREADS; i++) {
+        Profile_Thread *thread = &threads[i];
+
+        u32 num_events = (u32)thread->num_events;
+        u32 num_readable = get_num_readable_events(num_events);
+        if (!num_readable) continue;
+
+        if (i == main_thread_index) {
+            fprintf(file, ",\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"Main thread\"}}", i);
+        } else {
+            fprintf(file, ",\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"Worker %d\"}}", i, i);
+        }
+
+        // Oldest first, the order the viewers like best.
+        for (u32 j = num_readable; j > 0; j--) {
+            Profile_Event *event = &thread->events[(num_events - j) & (PROFILE_EVENTS_PER_THREAD - 1)];
+
+            f64 start = get_trace_microseconds(event->start);
+            f64 duration = get_profile_seconds(event->end - event->start) * 1000000.0;
+            fprintf(file, ",\n    {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    event->name, i, start, duration);
+        }
+    }
+
+    u32 num_recorded_frames = Min(num_frames, (u32)MAX_PROFILE_FRAMES);
+    for (u32 i = num_recorded_frames; i > 0; i--) {
+        u64 frame_start = frame_starts[(num_frames - i) & (MAX_PROFILE_FRAMES - 1)];
+        fprintf(file, ",\n    {\"name\": \"Frame\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f}",
+                main_thread_index, get_trace_microseconds(frame_start));
+    }
+
+    fprintf(file, "\n]}\n");
+
+    return true;
+}
+
+#endif
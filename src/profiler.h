@@ -0,0 +1,94 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "general.h"
+#include "jobs.h"
+
+// Scoped CPU timing. PROFILE_SCOPE("name") times from that line to the end of
+// the enclosing block. Every job worker and the main thread write finished
+// scopes to their own ring buffer, indexed like the rest of the per-worker
+// state, so recording never takes a lock. Only the newest
+// PROFILE_EVENTS_PER_THREAD scopes of each thread are kept.
+//
+// Names are stored by pointer, so they must be string literals.
+//
+// Without PROFILER_ENABLED the macros expand to nothing and none of this is
+// compiled in. Debug builds turn it on here; define it on the command line to
+// profile a release build. Anything that checks it must include this first.
+
+#if defined(_DEBUG) && !defined(PROFILER_ENABLED)
+#define PROFILER_ENABLED
+#endif
+
+const int MAX_PROFILE_THREADS = MAX_JOB_WORKERS + 1;
+const int PROFILE_EVENTS_PER_THREAD = 16 * 1024; // Power of two.
+const int MAX_PROFILE_FRAMES = 256;              // Power of two.
+
+struct Profile_Event {
+    char *name;
+    u64 start;
+    u64 end;
+    int depth; // How many scopes were open around this one on its thread.
+};
+
+#ifdef PROFILER_ENABLED
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+inline u64 read_profile_clock() {
+    return __rdtsc();
+}
+
+struct Profile_Thread;
+Profile_Thread *begin_profile_scope();
+void end_profile_scope(Profile_Thread *thread, char *name, u64 start);
+
+struct Profile_Scope {
+    Profile_Thread *thread;
+    char *name;
+    u64 start;
+
+    Profile_Scope(char *scope_name) {
+        thread = begin_profile_scope();
+        name = scope_name;
+        start = read_profile_clock();
+    }
+
+    ~Profile_Scope() {
+        end_profile_scope(thread, name, start);
+    }
+};
+
+#define PROFILE_SCOPE(name) Profile_Scope CONCAT(profile_scope__, __LINE__)(name)
+
+// Measures the clock rate; call once at startup from the main thread.
+void init_profiler();
+
+// Marks the start of a frame. Main thread only.
+void begin_profile_frame();
+
+// The last whole frame, in clock ticks. False until two frames have begun.
+bool get_last_profile_frame(u64 *start, u64 *end);
+
+f64 get_profile_seconds(u64 ticks);
+
+// Copies the scopes of one thread that overlap [start, end), newest first,
+// and returns how many were copied. Main thread only. Scopes old enough that
+// their slots could be getting overwritten while we read are left out.
+int get_profile_events(int thread_index, u64 start, u64 end, Profile_Event *events, int max_events);
+
+// Writes everything still in the ring buffers in Chrome's trace event
+// format, for chrome://tracing or Perfetto.
+bool write_profile_trace_json(char *file_path);
+
+#else
+
+#define PROFILE_SCOPE(name)
+
+#endif
+
+#endif
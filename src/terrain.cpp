@@ -4,131 +4,460 @@
 #include "bitmap.h"
 #include "array.h"
 #include "loader.h"
+#include "memory_tags.h"
+#include "assets.h"
+#include "pixel_convert.h"
+#include "jobs.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "profiler.h"
+#include "catalog.h"
 
 #include <stb_image.h>
 
-static Array <Terrain *> loaded_terrains;
+static Array <Terrain *> loaded_terrains(make_tagged_allocator(MEMORY_TAG_TERRAIN));
 
-inline float get_terrain_height(int x, int z, Bitmap bitmap) {
-    if (x < 0 || x >= bitmap.height || z < 0 || z >= bitmap.height) {
-        return 0.0f;
+//
+// Texture pack
+//
+
+struct Terrain_Layer_Load {
+    char *full_path; // Null if there's no such asset.
+    Bitmap bitmap;
+};
+
+static void terrain_layer_load_job_proc(void *data, int worker_index) {
+    Terrain_Layer_Load *load = (Terrain_Layer_Load *)data;
+    if (!load->full_path) return;
+
+    PROFILE_SCOPE("Load terrain layer");
+
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    int channels;
+    load->bitmap.data = stbi_load(load->full_path, &load->bitmap.width, &load->bitmap.height, &channels, 4);
+    load->bitmap.channels = 4;
+    load->bitmap.format = TEXTURE_FORMAT_RGBA8;
+}
+
+// Bilinear, wrapping at the edges since the layers tile.
+static u8 *resize_layer(Bitmap source, int width, int height) {
+    u8 *result = TAGGED_NEW_ARRAY(MEMORY_TAG_TERRAIN, u8, (s64)width * height * 4);
+
+    float scale_x = static_cast <float>(source.width) / width;
+    float scale_y = static_cast <float>(source.height) / height;
+
+    for (int y = 0; y < height; y++) {
+        float source_y = (y + 0.5f) * scale_y - 0.5f;
+        int y0 = static_cast <int>(floorf(source_y));
+        float fy = source_y - y0;
+        u8 *row0 = source.data + (s64)((y0 + source.height) % source.height) * source.width * 4;
+        u8 *row1 = source.data + (s64)((y0 + 1) % source.height) * source.width * 4;
+
+        for (int x = 0; x < width; x++) {
+            float source_x = (x + 0.5f) * scale_x - 0.5f;
+            int x0 = static_cast <int>(floorf(source_x));
+            float fx = source_x - x0;
+            int column0 = ((x0 + source.width) % source.width) * 4;
+            int column1 = ((x0 + 1) % source.width) * 4;
+
+            u8 *dest = result + ((s64)y * width + x) * 4;
+            for (int c = 0; c < 4; c++) {
+                float top = row0[column0 + c] + (row0[column1 + c] - row0[column0 + c]) * fx;
+                float bottom = row1[column0 + c] + (row1[column1 + c] - row1[column0 + c]) * fx;
+                dest[c] = static_cast <u8>(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+
+    return result;
+}
+
+Terrain_Texture_Pack make_terrain_texture_pack(char *background_name, char *r_name, char *g_name, char *b_name) {
+    char *names[TERRAIN_NUM_LAYERS] = { background_name, r_name, g_name, b_name };
+
+    Terrain_Layer_Load loads[TERRAIN_NUM_LAYERS] = {};
+    Job_Counter counter;
+    for (int i = 0; i < TERRAIN_NUM_LAYERS; i++) {
+        Asset_Entry *asset = find_asset(ASSET_TEXTURE, names[i]);
+        if (asset) {
+            loads[i].full_path = asset->full_path;
+        } else {
+            fprintf(stderr, "No terrain texture named '%s'\n", names[i]);
+        }
+
+        add_job(terrain_layer_load_job_proc, &loads[i], &counter);
+    }
+    wait_for_counter(&counter);
+
+    int width = 1;
+    int height = 1;
+    for (int i = 0; i < TERRAIN_NUM_LAYERS; i++) {
+        if (!loads[i].bitmap.data) continue;
+
+        width = Max(width, loads[i].bitmap.width);
+        height = Max(height, loads[i].bitmap.height);
+    }
+
+    // Everything ends up the size of the largest layer. Layers that failed to
+    // load are plain white, same as a missing texture anywhere else.
+    Bitmap layers[TERRAIN_NUM_LAYERS];
+    for (int i = 0; i < TERRAIN_NUM_LAYERS; i++) {
+        Bitmap *source = &loads[i].bitmap;
+
+        layers[i].width = width;
+        layers[i].height = height;
+        layers[i].format = TEXTURE_FORMAT_RGBA8;
+        layers[i].channels = 4;
+
+        if (!source->data) {
+            fprintf(stderr, "Failed to load terrain texture '%s'\n", names[i]);
+
+            layers[i].data = TAGGED_NEW_ARRAY(MEMORY_TAG_TERRAIN, u8, (s64)width * height * 4);
+            memset(layers[i].data, 0xff, (s64)width * height * 4);
+        } else if (source->width != width || source->height != height) {
+            layers[i].data = resize_layer(*source, width, height);
+        } else {
+            layers[i].data = source->data;
+        }
+    }
+
+    Terrain_Texture_Pack result;
+    result.layers = create_texture_array(TERRAIN_NUM_LAYERS, layers);
+
+    for (int i = 0; i < TERRAIN_NUM_LAYERS; i++) {
+        if (layers[i].data != loads[i].bitmap.data) tagged_free(layers[i].data);
+        if (loads[i].bitmap.data) stbi_image_free(loads[i].bitmap.data);
+    }
+
+    return result;
+}
+
+//
+// Blend map
+//
+
+Terrain_Blend_Map load_terrain_blend_map(Atom name) {
+    PROFILE_SCOPE("load_terrain_blend_map");
+
+    // Null when there's no such asset; the terrain then draws without one.
+    Terrain_Blend_Map result = {};
+    result.map = find_or_create_data_texture(name);
+
+    if (result.map && result.map->full_path) result.bitmap.load_from_file(result.map->full_path);
+    if (!result.bitmap.data) {
+        fprintf(stderr, "Failed to read blend map '%s', terrain chunks will sample every layer\n", name.string);
+    }
+
+    return result;
+}
+
+void free_terrain_blend_map(Terrain_Blend_Map *blend_map) {
+    if (blend_map->bitmap.data) stbi_image_free(blend_map->bitmap.data);
+    blend_map->bitmap.data = nullptr;
+}
+
+//
+// Chunk layers
+//
+
+// Bilinear filtering reaches one texel past a chunk's edge and each mip
+// level doubles that; this covers the levels used up close. Further out a
+// chunk may lose a faint trace of a neighbour's layer, which isn't visible.
+const int BLEND_MAP_CHUNK_MARGIN = 4;
+
+// Bit i set means layer i shows somewhere in the given part of the blend map.
+// The sampler wraps, so the margin does too.
+static u32 get_blend_map_layer_mask(Bitmap blend_map, float u0, float u1, float v0, float v1) {
+    int x0 = static_cast <int>(floorf(u0 * blend_map.width)) - BLEND_MAP_CHUNK_MARGIN;
+    int x1 = static_cast <int>(ceilf(u1 * blend_map.width)) + BLEND_MAP_CHUNK_MARGIN;
+    int y0 = static_cast <int>(floorf(v0 * blend_map.height)) - BLEND_MAP_CHUNK_MARGIN;
+    int y1 = static_cast <int>(ceilf(v1 * blend_map.height)) + BLEND_MAP_CHUNK_MARGIN;
+
+    const u32 all_layers = (1 << TERRAIN_NUM_LAYERS) - 1;
+
+    u32 result = 0;
+    for (int y = y0; y < y1; y++) {
+        int row = (y % blend_map.height + blend_map.height) % blend_map.height;
+
+        for (int x = x0; x < x1; x++) {
+            int column = (x % blend_map.width + blend_map.width) % blend_map.width;
+            u8 *pixel = blend_map.data + ((s64)row * blend_map.width + column) * blend_map.channels;
+
+            int r = pixel[0];
+            int g = pixel[1];
+            int b = pixel[2];
+            int background = 255 - (r + g + b);
+
+            if (background > TERRAIN_LAYER_THRESHOLD) result |= 1 << 0;
+            if (r > TERRAIN_LAYER_THRESHOLD) result |= 1 << 1;
+            if (g > TERRAIN_LAYER_THRESHOLD) result |= 1 << 2;
+            if (b > TERRAIN_LAYER_THRESHOLD) result |= 1 << 3;
+        }
+
+        if (result == all_layers) break;
+    }
+
+    return result;
+}
+
+static void set_chunk_layers(Terrain_Chunk *chunk, u32 mask) {
+    chunk->num_layers = 0;
+    for (int layer = 0; layer < TERRAIN_NUM_LAYERS; layer++) {
+        if (!(mask & (1 << layer))) continue;
+
+        if (chunk->num_layers < ArrayCount(chunk->layers)) chunk->layers[chunk->num_layers] = layer;
+        chunk->num_layers++;
     }
 
-    double height = static_cast <double>(bitmap.get_rgb(x, z));
+    // Nothing over the threshold anywhere; the background is the best guess.
+    if (chunk->num_layers == 0) {
+        chunk->num_layers = 1;
+        chunk->layers[0] = 0;
+    }
+}
+
+inline float get_height_from_pixel(u32 packed_rgb) {
+    double height = static_cast <double>(packed_rgb);
     height /= TERRAIN_MAX_PIXEL_COLOR;
     height *= TERRAIN_MAX_HEIGHT;
     height -= TERRAIN_MAX_HEIGHT*0.5;
     return static_cast<float>(height);
 }
 
-inline Vector3 calculate_normal(int x, int z, Bitmap bitmap) {
+inline float get_terrain_height(int x, int z, float *heights, int size) {
+    if (x < 0 || x >= size || z < 0 || z >= size) {
+        return 0.0f;
+    }
+
+    return heights[z * size + x];
+}
+
+inline Vector3 calculate_normal(int x, int z, float *heights, int size) {
     float height_l = 0.0f;
     float height_r = 0.0f;
     float height_d = 0.0f;
     float height_u = 0.0f;
 
     if (x == 0) {
-        height_l = get_terrain_height(x-1 + bitmap.height, z, bitmap);
-        height_r = get_terrain_height(x+1, z, bitmap);
+        height_l = get_terrain_height(x-1 + size, z, heights, size);
+        height_r = get_terrain_height(x+1, z, heights, size);
     } else if (x == 1) {
-        height_l = get_terrain_height(x-1 + bitmap.height - 1, z, bitmap);
-        height_r = get_terrain_height(x+1, z, bitmap);
-    } else if (x == bitmap.height) {
-        height_r = get_terrain_height(x+1 - bitmap.height, z, bitmap);
-        height_l = get_terrain_height(x-1, z, bitmap);
-    } else if (x == bitmap.height - 1) {
-        height_r = get_terrain_height(x+1 - bitmap.height + 1, z, bitmap);
-        height_l = get_terrain_height(x-1, z, bitmap);
+        height_l = get_terrain_height(x-1 + size - 1, z, heights, size);
+        height_r = get_terrain_height(x+1, z, heights, size);
+    } else if (x == size) {
+        height_r = get_terrain_height(x+1 - size, z, heights, size);
+        height_l = get_terrain_height(x-1, z, heights, size);
+    } else if (x == size - 1) {
+        height_r = get_terrain_height(x+1 - size + 1, z, heights, size);
+        height_l = get_terrain_height(x-1, z, heights, size);
     } else {
-        height_l = get_terrain_height(x-1, z, bitmap);
-        height_r = get_terrain_height(x+1, z, bitmap);
+        height_l = get_terrain_height(x-1, z, heights, size);
+        height_r = get_terrain_height(x+1, z, heights, size);
     }
 
     if (z == 0) {
-        height_d = get_terrain_height(x, z-1 + bitmap.height, bitmap);
-        height_u = get_terrain_height(x, z+1, bitmap);
+        height_d = get_terrain_height(x, z-1 + size, heights, size);
+        height_u = get_terrain_height(x, z+1, heights, size);
     } else if (z == 1) {
-        height_d = get_terrain_height(x, z-1 + bitmap.height - 1, bitmap);
-        height_u = get_terrain_height(x, z+1, bitmap);
-    } else if (z == bitmap.height) {
-        height_d = get_terrain_height(x, z-1, bitmap);
-        height_u = get_terrain_height(x, z+1 - bitmap.height, bitmap);
-    } else if (z == bitmap.height - 1) {
-        height_d = get_terrain_height(x, z-1, bitmap);
-        height_u = get_terrain_height(x, z+1 - bitmap.height + 1, bitmap);
+        height_d = get_terrain_height(x, z-1 + size - 1, heights, size);
+        height_u = get_terrain_height(x, z+1, heights, size);
+    } else if (z == size) {
+        height_d = get_terrain_height(x, z-1, heights, size);
+        height_u = get_terrain_height(x, z+1 - size, heights, size);
+    } else if (z == size - 1) {
+        height_d = get_terrain_height(x, z-1, heights, size);
+        height_u = get_terrain_height(x, z+1 - size + 1, heights, size);
     } else {
-        height_d = get_terrain_height(x, z-1, bitmap);
-        height_u = get_terrain_height(x, z+1, bitmap);
+        height_d = get_terrain_height(x, z-1, heights, size);
+        height_u = get_terrain_height(x, z+1, heights, size);
     }
     
     return normalize_or_zero(make_vector3(height_l-height_r, 2.0f, height_d-height_u));
 }
 
-static Mesh *generate_terrain(char *height_map, Terrain *terrain) {
-    char *full_path = mprintf("data/textures/%s.png", height_map);
-    defer { delete [] full_path; };
+static void add_occluder_quad(Vector3 *vertices, int *count, Vector3 a, Vector3 b, Vector3 c, Vector3 d) {
+    Vector3 *v = vertices + *count * 3;
+    v[0] = a; v[1] = b; v[2] = c;
+    v[3] = a; v[4] = c; v[5] = d;
+    *count += 2;
+}
+
+// A chunk's surface is nowhere below its lowest vertex, so a flat quad at that
+// height is under the ground everywhere. The edge two chunks share is above
+// both of their lowest points, so a wall between those two heights along it
+// is under the ground too, and closes the gap between the flat tops.
+static void build_occluder_hull(Terrain *terrain, float *min_heights, u32 chunks_per_side, u32 chunk_quads, u32 num_quads) {
+    float cell_size = TERRAIN_SIZE / static_cast <float>(num_quads);
+
+    int max_triangles = chunks_per_side * chunks_per_side * 2 + chunks_per_side * (chunks_per_side - 1) * 4;
+    terrain->occluder_vertices = TAGGED_NEW_ARRAY(MEMORY_TAG_TERRAIN, Vector3, max_triangles * 3);
+    terrain->num_occluder_triangles = 0;
+
+    Vector3 *v = terrain->occluder_vertices;
+    int *count = &terrain->num_occluder_triangles;
+
+    for (u32 cz = 0; cz < chunks_per_side; cz++) {
+        for (u32 cx = 0; cx < chunks_per_side; cx++) {
+            float x0 = terrain->x - Min(cx * chunk_quads, num_quads) * cell_size;
+            float x1 = terrain->x - Min((cx + 1) * chunk_quads, num_quads) * cell_size;
+            float z0 = terrain->z - Min(cz * chunk_quads, num_quads) * cell_size;
+            float z1 = terrain->z - Min((cz + 1) * chunk_quads, num_quads) * cell_size;
+            float h = min_heights[cz * TERRAIN_CHUNKS_PER_SIDE + cx];
+
+            add_occluder_quad(v, count, make_vector3(x0, h, z0), make_vector3(x1, h, z0), make_vector3(x1, h, z1), make_vector3(x0, h, z1));
+
+            if (cx + 1 < chunks_per_side) {
+                float other = min_heights[cz * TERRAIN_CHUNKS_PER_SIDE + cx + 1];
+                float low = Min(h, other), high = Max(h, other);
+                if (high > low) {
+                    add_occluder_quad(v, count, make_vector3(x1, low, z0), make_vector3(x1, low, z1), make_vector3(x1, high, z1), make_vector3(x1, high, z0));
+                }
+            }
+
+            if (cz + 1 < chunks_per_side) {
+                float other = min_heights[(cz + 1) * TERRAIN_CHUNKS_PER_SIDE + cx];
+                float low = Min(h, other), high = Max(h, other);
+                if (high > low) {
+                    add_occluder_quad(v, count, make_vector3(x0, low, z1), make_vector3(x1, low, z1), make_vector3(x1, high, z1), make_vector3(x0, high, z1));
+                }
+            }
+        }
+    }
+}
+
+static Mesh *generate_terrain(char *height_map, Terrain_Blend_Map *blend_map, Terrain *terrain) {
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    Asset_Entry *asset = find_asset(ASSET_TEXTURE, height_map);
+    if (!asset) {
+        fprintf(stderr, "No height map named '%s'\n", height_map);
+        return nullptr;
+    }
+
     Bitmap bitmap;
-    bitmap.load_from_file(full_path);
+    bitmap.load_from_file(asset->full_path);
     defer { stbi_image_free(bitmap.data); };
 
     int TERRAIN_VERTEX_COUNT = static_cast <int>(bitmap.height);
     int count = TERRAIN_VERTEX_COUNT*TERRAIN_VERTEX_COUNT;
 
-    terrain->heights = new float[count];
+    terrain->heights = TAGGED_NEW_ARRAY(MEMORY_TAG_TERRAIN, float, count);
     terrain->num_heights = count;
 
-    Vector3 *vertices = new Vector3[count];
-    defer { delete [] vertices; };
-    Vector3 *normals = new Vector3[count];
-    defer { delete [] normals; };
-    Vector2 *uvs = new Vector2[count];
-    defer { delete [] uvs; };
+    // Each vertex reads five heights for its normal, so decode the map once up
+    // front instead of unpacking pixels on every lookup.
+    s64 num_pixels = static_cast <s64>(bitmap.width) * bitmap.height;
+    u32 *packed = (u32 *)arena_push(&frame_arena, num_pixels * sizeof(u32));
+    convert_to_packed_rgb(bitmap.data, bitmap.channels, packed, num_pixels);
+
+    for (int z = 0; z < TERRAIN_VERTEX_COUNT; z++) {
+        for (int x = 0; x < TERRAIN_VERTEX_COUNT; x++) {
+            terrain->heights[z * TERRAIN_VERTEX_COUNT + x] = get_height_from_pixel(packed[z * bitmap.width + x]);
+        }
+    }
 
-    u32 num_indices = 6*(TERRAIN_VERTEX_COUNT-1)*(TERRAIN_VERTEX_COUNT*1);
-    u32 *indices = new u32[num_indices];
-    defer { delete [] indices; };
+    Vector3 *vertices = (Vector3 *)arena_push(&frame_arena, count * sizeof(Vector3));
+    Vector3 *normals = (Vector3 *)arena_push(&frame_arena, count * sizeof(Vector3));
+    Vector2 *uvs = (Vector2 *)arena_push(&frame_arena, count * sizeof(Vector2));
+
+    u32 num_indices = 6*(TERRAIN_VERTEX_COUNT-1)*(TERRAIN_VERTEX_COUNT-1);
+    u32 *indices = (u32 *)arena_push(&frame_arena, num_indices * sizeof(u32));
 
     u32 vertex_pointer = 0;
     for (u32 i = 0; i < TERRAIN_VERTEX_COUNT; i++) {
         for (u32 j = 0; j < TERRAIN_VERTEX_COUNT; j++) {
             vertices[vertex_pointer].x = -static_cast <float>(j)/(static_cast <float>(TERRAIN_VERTEX_COUNT)-1)*TERRAIN_SIZE;
-            float height = get_terrain_height(j, i, bitmap);
-            terrain->heights[i * TERRAIN_VERTEX_COUNT + j] = height;
-            vertices[vertex_pointer].y = height;
+            vertices[vertex_pointer].y = terrain->heights[i * TERRAIN_VERTEX_COUNT + j];
             vertices[vertex_pointer].z = -static_cast <float>(i)/(static_cast <float>(TERRAIN_VERTEX_COUNT)-1)*TERRAIN_SIZE;
-            normals[vertex_pointer] = calculate_normal(j, i, bitmap);
+            normals[vertex_pointer] = calculate_normal(j, i, terrain->heights, TERRAIN_VERTEX_COUNT);
             uvs[vertex_pointer].x = static_cast <float>(j)/(static_cast <float>(TERRAIN_VERTEX_COUNT)-1);
             uvs[vertex_pointer].y = static_cast <float>(i)/(static_cast <float>(TERRAIN_VERTEX_COUNT)-1);
             vertex_pointer++;
         }
     }
 
+    Bitmap *blend_bitmap = blend_map ? &blend_map->bitmap : nullptr;
+
+    // Indices are laid out chunk by chunk so each one is a single range.
+    u32 num_quads = TERRAIN_VERTEX_COUNT - 1;
+    u32 chunk_quads = (num_quads + TERRAIN_CHUNKS_PER_SIDE - 1) / TERRAIN_CHUNKS_PER_SIDE;
+
+    float cell_size = TERRAIN_SIZE / static_cast <float>(num_quads);
+    float chunk_min_heights[TERRAIN_CHUNKS_PER_SIDE * TERRAIN_CHUNKS_PER_SIDE];
+    u32 chunks_per_side = 0;
+
     u32 pointer = 0;
-    for (u32 gz = 0; gz < TERRAIN_VERTEX_COUNT - 1; gz++) {
-        for (u32 gx = 0; gx < TERRAIN_VERTEX_COUNT - 1; gx++) {
-            u32 top_left = (gz*TERRAIN_VERTEX_COUNT)+gx;
-            u32 top_right = top_left+1;
-            u32 bottom_left = ((gz+1)*TERRAIN_VERTEX_COUNT)+gx;
-            u32 bottom_right = bottom_left+1;
-            indices[pointer++] = top_left;
-            indices[pointer++] = bottom_left;
-            indices[pointer++] = top_right;
-            indices[pointer++] = top_right;
-            indices[pointer++] = bottom_left;
-            indices[pointer++] = bottom_right;
+    terrain->num_chunks = 0;
+    for (u32 cz = 0; cz < TERRAIN_CHUNKS_PER_SIDE; cz++) {
+        for (u32 cx = 0; cx < TERRAIN_CHUNKS_PER_SIDE; cx++) {
+            u32 gx0 = cx * chunk_quads;
+            u32 gz0 = cz * chunk_quads;
+            u32 gx1 = Min(gx0 + chunk_quads, num_quads);
+            u32 gz1 = Min(gz0 + chunk_quads, num_quads);
+            if (gx0 >= gx1 || gz0 >= gz1) continue;
+
+            Terrain_Chunk *chunk = &terrain->chunks[terrain->num_chunks++];
+            chunk->first_index = pointer;
+
+            for (u32 gz = gz0; gz < gz1; gz++) {
+                for (u32 gx = gx0; gx < gx1; gx++) {
+                    u32 top_left = (gz*TERRAIN_VERTEX_COUNT)+gx;
+                    u32 top_right = top_left+1;
+                    u32 bottom_left = ((gz+1)*TERRAIN_VERTEX_COUNT)+gx;
+                    u32 bottom_right = bottom_left+1;
+                    indices[pointer++] = top_left;
+                    indices[pointer++] = bottom_left;
+                    indices[pointer++] = top_right;
+                    indices[pointer++] = top_right;
+                    indices[pointer++] = bottom_left;
+                    indices[pointer++] = bottom_right;
+                }
+            }
+
+            chunk->num_indices = pointer - chunk->first_index;
+
+            float min_height = terrain->heights[gz0 * TERRAIN_VERTEX_COUNT + gx0];
+            float max_height = min_height;
+            for (u32 gz = gz0; gz <= gz1; gz++) {
+                for (u32 gx = gx0; gx <= gx1; gx++) {
+                    float height = terrain->heights[gz * TERRAIN_VERTEX_COUNT + gx];
+                    min_height = Min(min_height, height);
+                    max_height = Max(max_height, height);
+                }
+            }
+
+            chunk_min_heights[cz * TERRAIN_CHUNKS_PER_SIDE + cx] = min_height;
+            chunks_per_side = Max(chunks_per_side, cx + 1);
+
+            // Vertices run towards negative x and z from the terrain's corner.
+            chunk->box_center = make_vector3(terrain->x - (gx0 + gx1) * 0.5f * cell_size, (min_height + max_height) * 0.5f, terrain->z - (gz0 + gz1) * 0.5f * cell_size);
+            chunk->box_extents = make_vector3((gx1 - gx0) * 0.5f * cell_size, (max_height - min_height) * 0.5f, (gz1 - gz0) * 0.5f * cell_size);
+
+            if (blend_bitmap && blend_bitmap->data && blend_bitmap->channels >= 3) {
+                float q = static_cast <float>(num_quads);
+                set_chunk_layers(chunk, get_blend_map_layer_mask(*blend_bitmap, gx0 / q, gx1 / q, gz0 / q, gz1 / q));
+            } else {
+                chunk->num_layers = TERRAIN_NUM_LAYERS;
+            }
         }
     }
 
+    build_occluder_hull(terrain, chunk_min_heights, chunks_per_side, chunk_quads, num_quads);
+
     return make_mesh(count, vertices, uvs, normals, num_indices, indices);
 }
 
-Terrain *make_terrain(int grid_x, int grid_z, Terrain_Texture_Pack texture_pack, Texture_Map *blend_map, char *height_map_name) {
-    Terrain *result = new Terrain();
+Terrain *make_terrain(int grid_x, int grid_z, Terrain_Texture_Pack texture_pack, Terrain_Blend_Map *blend_map, char *height_map_name) {
+    PROFILE_SCOPE("make_terrain");
+
+    Terrain *result = TAGGED_NEW(MEMORY_TAG_TERRAIN, Terrain);
     result->texture_pack = texture_pack;
-    result->blend_map = blend_map;
+    result->blend_map = blend_map ? blend_map->map : nullptr;
     result->x = grid_x * TERRAIN_SIZE;
     result->z = grid_z * TERRAIN_SIZE;
-    result->mesh = generate_terrain(height_map_name, result);
+    result->mesh = generate_terrain(height_map_name, blend_map, result);
     loaded_terrains.add(result);
     return result;
 }
@@ -180,14 +509,91 @@ Terrain *get_terrain_at(Vector3 world_pos) {
     return nullptr;
 }
 
-void draw_terrains() {
-    set_shader(shader_terrain);
-    
+static bool chunks_share_state(Terrain_Chunk *a, Terrain_Chunk *b) {
+    if (Min(a->num_layers, 3) != Min(b->num_layers, 3)) return false;
+    if (a->num_layers == 1) return a->layers[0] == b->layers[0];
+    if (a->num_layers == 2) return a->layers[0] == b->layers[0] && a->layers[1] == b->layers[1];
+    return true;
+}
+
+void record_terrains(Frustum *frustum, Command_List *list) {
+    PROFILE_SCOPE("record_terrains");
+
+    // Indexed by number of layers minus one; three or four use them all.
+    Shader *shaders[] = { shader_terrain_one_layer, shader_terrain_two_layers, shader_terrain };
+
+    for (int i = 0; i < loaded_terrains.count; i++) {
+        Terrain *terrain = loaded_terrains[i];
+        if (!terrain->mesh) continue;
+
+        u8 visible[TERRAIN_CHUNKS_PER_SIDE * TERRAIN_CHUNKS_PER_SIDE];
+        int num_visible;
+        {
+            Arena_Mark mark = get_arena_mark(&list->arena);
+            defer { rewind_arena(&list->arena, mark); };
+
+            Cull_Batch batch;
+            begin_cull_batch(&batch, terrain->num_chunks, &list->arena);
+            for (int j = 0; j < terrain->num_chunks; j++) {
+                Terrain_Chunk *chunk = &terrain->chunks[j];
+
+                Bounds bounds;
+                bounds.box_center = chunk->box_center;
+                bounds.box_extents = chunk->box_extents;
+                bounds.sphere_center = chunk->box_center;
+                bounds.sphere_radius = get_length(chunk->box_extents);
+                add_to_cull_batch(&batch, bounds);
+            }
+
+            num_visible = cull_batch(frustum, &batch, visible);
+        }
+
+        int num_occluded = 0;
+        for (int j = 0; j < terrain->num_chunks; j++) {
+            if (!visible[j]) continue;
+
+            Terrain_Chunk *chunk = &terrain->chunks[j];
+            if (is_box_occluded(chunk->box_center, chunk->box_extents)) {
+                visible[j] = 0;
+                num_occluded++;
+            }
+        }
+
+        add_occluded_stats(num_occluded);
+        if (num_visible == num_occluded) continue;
+
+        record_set_terrain_textures(list, terrain->texture_pack, terrain->blend_map);
+        record_bind_mesh(list, terrain->mesh, make_vector3(terrain->x, 0, terrain->z), make_vector3(0, 0, 0), 1);
+
+        // One pass per shader so each is set at most once per terrain.
+        // Neighbouring chunks that need the same state have neighbouring index
+        // ranges, so they go out as one draw.
+        for (int pass = 0; pass < ArrayCount(shaders); pass++) {
+            for (int j = 0; j < terrain->num_chunks; j++) {
+                Terrain_Chunk *chunk = &terrain->chunks[j];
+                if (!visible[j]) continue;
+                if (Min(chunk->num_layers, 3) - 1 != pass) continue;
+
+                u32 num_indices = chunk->num_indices;
+                while (j + 1 < terrain->num_chunks && visible[j + 1] && chunks_share_state(chunk, &terrain->chunks[j + 1])) {
+                    num_indices += terrain->chunks[++j].num_indices;
+                }
+
+                record_set_shader(list, shaders[pass]);
+                if (chunk->num_layers == 1) record_set_terrain_chunk_layers(list, chunk->layers[0], chunk->layers[0]);
+                if (chunk->num_layers == 2) record_set_terrain_chunk_layers(list, chunk->layers[0], chunk->layers[1]);
+
+                record_draw_mesh_indices(list, chunk->first_index, num_indices);
+            }
+        }
+    }
+}
+
+void add_terrain_occluders() {
     for (int i = 0; i < loaded_terrains.count; i++) {
         Terrain *terrain = loaded_terrains[i];
-        
-        set_terrain_textures(terrain->texture_pack);
+        if (!terrain->occluder_vertices) continue;
 
-        draw_mesh(terrain->mesh, make_vector3(terrain->x, 0, terrain->z), make_vector3(0, 0, 0), 1);
+        add_occluder_triangles(terrain->occluder_vertices, terrain->num_occluder_triangles);
     }
 }
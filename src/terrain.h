@@ -1,22 +1,61 @@
 #pragma once
 
 #include "geometry.h"
+#include "bitmap.h"
+#include "atom.h"
 
 const float TERRAIN_SIZE = 800.0f;
 const double TERRAIN_MAX_HEIGHT = 40.0;
 const u64 TERRAIN_MAX_PIXEL_COLOR = 256ULL * 256ULL * 256ULL;
+const float TERRAIN_TEXTURE_TILING = 100.0f; // Must match TEXTURE_TILING in terrain_common.hlsli.
+
+// Background, then the layers the blend map's r, g and b channels paint.
+const int TERRAIN_NUM_LAYERS = 4;
+
+// Each terrain is drawn in this many chunks per side, and each chunk uses the
+// cheapest shader that covers the layers its part of the blend map uses.
+const int TERRAIN_CHUNKS_PER_SIDE = 16;
+
+// Blend map weights at or under this (out of 255) don't count as a layer
+// being used; they're too faint to see.
+const int TERRAIN_LAYER_THRESHOLD = 4;
 
 struct Texture_Map;
 struct Mesh;
+struct Frustum;
+struct Command_List;
 
 struct Terrain_Texture_Pack {
-    Texture_Map *background_texture;
-    Texture_Map *r_texture;
-    Texture_Map *g_texture;
-    Texture_Map *b_texture;
+    Texture_Map *layers; // Texture array, TERRAIN_NUM_LAYERS slices.
 };
 
-Terrain_Texture_Pack make_terrain_texture_pack(Texture_Map *background_texture, Texture_Map *r_texture, Texture_Map *g_texture, Texture_Map *b_texture);
+// Names are texture assets. They're loaded right away and resized to the
+// largest of them, since the slices of an array all share one size.
+Terrain_Texture_Pack make_terrain_texture_pack(char *background_name, char *r_name, char *g_name, char *b_name);
+
+// The blend map's GPU copy comes from the catalog like any other texture.
+// make_terrain also reads its pixels to pick each chunk's shader, so they're
+// decoded once here and shared by every terrain that uses the map.
+struct Terrain_Blend_Map {
+    Texture_Map *map;
+    Bitmap bitmap; // Null data if it couldn't be read.
+};
+
+Terrain_Blend_Map load_terrain_blend_map(Atom name);
+void free_terrain_blend_map(Terrain_Blend_Map *blend_map);
+
+struct Terrain_Chunk {
+    u32 first_index;
+    u32 num_indices;
+
+    // Only meaningful up to two; anything more is drawn with every layer.
+    int num_layers;
+    int layers[2];
+
+    // World space box around the chunk's part of the surface.
+    Vector3 box_center;
+    Vector3 box_extents;
+};
 
 struct Terrain {
     float x, z;
@@ -25,9 +64,26 @@ struct Terrain {
     Texture_Map *blend_map;
     float *heights;
     int num_heights;
+
+    Terrain_Chunk chunks[TERRAIN_CHUNKS_PER_SIDE * TERRAIN_CHUNKS_PER_SIDE];
+    int num_chunks;
+
+    // World space triangles that are certainly under the surface: a flat top
+    // at each chunk's lowest height, and walls to close the steps between
+    // neighbouring chunks. Three vertices per triangle.
+    Vector3 *occluder_vertices;
+    int num_occluder_triangles;
 };
 
-Terrain *make_terrain(int grid_x, int grid_z, Terrain_Texture_Pack texture_pack, Texture_Map *blend_map, char *height_map_name);
+// Without blend map pixels every chunk falls back to sampling all the layers.
+Terrain *make_terrain(int grid_x, int grid_z, Terrain_Texture_Pack texture_pack, Terrain_Blend_Map *blend_map, char *height_map_name);
 float get_terrain_height_at(Terrain *terrain, float world_x, float world_z);
 Terrain *get_terrain_at(Vector3 world_pos);
-void draw_terrains();
+
+// Records the draws for every loaded terrain into 'list'. Chunks outside the
+// frustum or hidden behind occluders are skipped. Safe on a worker once this
+// frame's occluders are rasterized.
+void record_terrains(Frustum *frustum, Command_List *list);
+
+// Adds every terrain's occluder hull to this frame's occlusion buffer.
+void add_terrain_occluders();
@@ -0,0 +1,331 @@
+#include "texture_streamer.h"
+
+#include "draw.h"
+#include "os.h"
+#include "array.h"
+#include "jobs.h"
+#include "memory_tags.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct Stream_Load_Job {
+    Texture_Stream *stream;
+    int first_level;
+    s64 reserved_bytes; // Counted in pending_bytes until the load finishes.
+    u8 *data; // Null if the read failed.
+
+    Stream_Load_Job *next_finished;
+};
+
+static Array <Texture_Stream *> streams(make_tagged_allocator(MEMORY_TAG_TEXTURE));
+
+static Mutex *finished_loads_mutex;
+static Stream_Load_Job *first_finished_load;
+static Stream_Load_Job *last_finished_load;
+
+static s64 streaming_budget = DEFAULT_TEXTURE_STREAMING_BUDGET;
+static s64 resident_bytes;
+// What the loads in flight will add once they're uploaded. It counts against
+// the budget already, or every load started in a frame would claim the
+// same headroom.
+static s64 pending_bytes;
+static int num_loads_in_flight;
+static u64 current_frame = 1;
+
+static Texture_Streaming_Stats stats;
+
+// D3D11 wants the top level of a block compressed texture to be a whole
+// number of blocks, so only levels like that can be the finest one resident.
+static bool can_be_top_level(Texture_Stream *stream, int level) {
+    if (!is_block_compressed(stream->format)) return true;
+    return (stream->levels[level].width % 4) == 0 && (stream->levels[level].height % 4) == 0;
+}
+
+static s64 get_size_of_levels(Texture_Stream *stream, int first_level) {
+    s64 result = 0;
+    for (int i = first_level; i < stream->num_levels; i++) {
+        result += stream->levels[i].size;
+    }
+
+    return result;
+}
+
+Texture_Stream *create_texture_stream(Texture_Map *map, char *cooked_path, Cooked_Texture *cooked) {
+    Texture_Stream *stream = TAGGED_NEW(MEMORY_TAG_TEXTURE, Texture_Stream);
+    stream->map = map;
+    stream->cooked_path = copy_string(cooked_path);
+    stream->format = cooked->format;
+    stream->srgb = (cooked->flags & COOKED_TEXTURE_SRGB) != 0;
+    stream->num_levels = cooked->num_levels;
+    memcpy(stream->levels, cooked->levels, cooked->num_levels * sizeof(Cooked_Texture_Level));
+
+    // The finest level that still fits in the tail size. Level 0 is always a
+    // valid top level, the cooker makes sure of that.
+    stream->tail_level = 0;
+    for (int i = 0; i < stream->num_levels; i++) {
+        if (!can_be_top_level(stream, i)) continue;
+
+        stream->tail_level = i;
+        if (Max(stream->levels[i].width, stream->levels[i].height) <= (u32)TEXTURE_STREAMING_TAIL_SIZE) break;
+    }
+
+    stream->resident_level = stream->num_levels;
+    stream->requested_level = stream->tail_level;
+    stream->wanted_level = stream->tail_level;
+    return stream;
+}
+
+void destroy_texture_stream(Texture_Stream *stream) {
+    delete [] stream->cooked_path;
+    tagged_delete(stream);
+}
+
+u8 *read_texture_stream_levels(Texture_Stream *stream, int first_level) {
+    // Levels are stored largest first with nothing in between, so any
+    // level and everything coarser is a single read to the end of the file.
+    s64 offset = stream->levels[first_level].offset;
+    s64 size = get_size_of_levels(stream, first_level);
+
+    u8 *data = (u8 *)TAGGED_ALLOC(MEMORY_TAG_TEXTURE, size);
+    if (!os_read_file_range(stream->cooked_path, offset, size, data)) {
+        tagged_free(data);
+        return nullptr;
+    }
+
+    return data;
+}
+
+void upload_texture_stream_levels(Texture_Stream *stream, int first_level, u8 *data) {
+    Texture_Level levels[MAX_COOKED_TEXTURE_LEVELS];
+    int num_levels = stream->num_levels - first_level;
+
+    u64 base_offset = stream->levels[first_level].offset;
+    for (int i = 0; i < num_levels; i++) {
+        Cooked_Texture_Level *level = &stream->levels[first_level + i];
+        levels[i].width = level->width;
+        levels[i].height = level->height;
+        levels[i].data = data + (level->offset - base_offset);
+    }
+
+    init_texture_with_levels(stream->map, stream->format, stream->srgb, num_levels, levels);
+
+    s64 new_bytes = get_size_of_levels(stream, first_level);
+    resident_bytes += new_bytes - stream->resident_bytes;
+    stream->resident_bytes = new_bytes;
+    stream->resident_level = first_level;
+}
+
+void register_texture_stream(Texture_Stream *stream) {
+    if (!finished_loads_mutex) finished_loads_mutex = os_create_mutex();
+
+    stream->map->stream = stream;
+    stream->last_used_frame = current_frame;
+    streams.add(stream);
+}
+
+void note_texture_use(Texture_Map *map, f32 projected_pixels) {
+    Texture_Stream *stream = map->stream;
+    if (!stream) return;
+
+    stream->last_used_frame = current_frame;
+
+    // One level per halving of texels per pixel, the same choice the sampler
+    // makes. Anything at or under one texel per pixel wants level 0.
+    f32 texels = (f32)stream->levels[0].width;
+    int level = 0;
+    if (projected_pixels < texels) {
+        level = (int)floorf(log2f(texels / Max(projected_pixels, 1.0f)));
+    }
+    level = Min(level, stream->tail_level);
+
+    while (level > 0 && !can_be_top_level(stream, level)) level--;
+
+    stream->requested_level = Min(stream->requested_level, level);
+}
+
+//
+// Loads and evictions
+//
+
+static void stream_load_job_proc(void *data, int worker_index) {
+    Stream_Load_Job *job = (Stream_Load_Job *)data;
+    job->data = read_texture_stream_levels(job->stream, job->first_level);
+
+    os_lock_mutex(finished_loads_mutex);
+    if (last_finished_load) {
+        last_finished_load->next_finished = job;
+    } else {
+        first_finished_load = job;
+    }
+    last_finished_load = job;
+    os_unlock_mutex(finished_loads_mutex);
+}
+
+static Stream_Load_Job *pop_finished_load() {
+    os_lock_mutex(finished_loads_mutex);
+    Stream_Load_Job *job = first_finished_load;
+    if (job) {
+        first_finished_load = job->next_finished;
+        if (!first_finished_load) last_finished_load = nullptr;
+    }
+    os_unlock_mutex(finished_loads_mutex);
+
+    return job;
+}
+
+static void finish_load(Stream_Load_Job *job) {
+    Texture_Stream *stream = job->stream;
+    stream->is_loading = false;
+    num_loads_in_flight--;
+    pending_bytes -= job->reserved_bytes;
+
+    if (job->data) {
+        // Something coarser may have been evicted meanwhile, but the read
+        // covers everything from first_level down, so the upload is complete.
+        upload_texture_stream_levels(stream, job->first_level, job->data);
+        tagged_free(job->data);
+
+        stats.loads_last_frame++;
+        stats.total_loads++;
+    } else {
+        fprintf(stderr, "[streaming] Failed to read levels %d+ of '%s'.\n", job->first_level, stream->cooked_path);
+    }
+
+    tagged_delete(job);
+}
+
+static void start_load(Texture_Stream *stream, int first_level, s64 bytes_needed) {
+    Stream_Load_Job *job = TAGGED_NEW(MEMORY_TAG_TEXTURE, Stream_Load_Job);
+    job->stream = stream;
+    job->first_level = first_level;
+    job->reserved_bytes = bytes_needed;
+
+    stream->is_loading = true;
+    num_loads_in_flight++;
+    pending_bytes += bytes_needed;
+    add_job(stream_load_job_proc, job);
+}
+
+static void evict_levels(Texture_Stream *stream, int new_resident_level) {
+    s64 new_bytes = get_size_of_levels(stream, new_resident_level);
+
+    drop_texture_levels(stream->map, new_resident_level - stream->resident_level);
+
+    resident_bytes += new_bytes - stream->resident_bytes;
+    stream->resident_bytes = new_bytes;
+    stream->resident_level = new_resident_level;
+
+    stats.evictions_last_frame++;
+    stats.total_evictions++;
+}
+
+static int compare_least_recently_used(const void *a, const void *b) {
+    u64 frame_a = (*(Texture_Stream **)a)->last_used_frame;
+    u64 frame_b = (*(Texture_Stream **)b)->last_used_frame;
+    return (frame_a < frame_b) ? -1 : (frame_a > frame_b) ? 1 : 0;
+}
+
+// Drops levels nobody asked for last frame, least recently used texture
+// first, until 'bytes_needed' more fits in the budget alongside the loads in
+// flight. Never touches the tail and never goes coarser than what a texture
+// currently wants.
+static bool make_room(s64 bytes_needed) {
+    if (resident_bytes + pending_bytes + bytes_needed <= streaming_budget) return true;
+
+    Arena_Mark mark = get_arena_mark(&frame_arena);
+    defer { rewind_arena(&frame_arena, mark); };
+
+    Texture_Stream **candidates = (Texture_Stream **)arena_push(&frame_arena, streams.count * sizeof(Texture_Stream *));
+    int num_candidates = 0;
+    for (int i = 0; i < streams.count; i++) {
+        Texture_Stream *stream = streams[i];
+        if (stream->is_loading) continue;
+        if (stream->resident_level >= stream->wanted_level) continue;
+
+        candidates[num_candidates++] = stream;
+    }
+
+    qsort(candidates, num_candidates, sizeof(Texture_Stream *), compare_least_recently_used);
+
+    for (int i = 0; i < num_candidates; i++) {
+        Texture_Stream *stream = candidates[i];
+        evict_levels(stream, stream->wanted_level);
+
+        if (resident_bytes + pending_bytes + bytes_needed <= streaming_budget) return true;
+    }
+
+    return false;
+}
+
+void update_texture_streaming() {
+    PROFILE_SCOPE("update_texture_streaming");
+
+    stats.loads_last_frame = 0;
+    stats.evictions_last_frame = 0;
+    stats.misses_last_frame = 0;
+
+    if (!finished_loads_mutex) return;
+
+    while (Stream_Load_Job *job = pop_finished_load()) {
+        finish_load(job);
+    }
+
+    // Textures not drawn last frame fall back to wanting only their tail,
+    // which makes their extra levels the first to go.
+    for (int i = 0; i < streams.count; i++) {
+        Texture_Stream *stream = streams[i];
+        bool was_used = stream->last_used_frame == current_frame;
+
+        stream->wanted_level = was_used ? stream->requested_level : stream->tail_level;
+        stream->requested_level = stream->tail_level;
+
+        if (was_used && stream->resident_level > stream->wanted_level) {
+            stats.misses_last_frame++;
+            stats.total_misses++;
+        }
+    }
+
+    // A budget that was lowered, or textures that stopped being drawn, can
+    // leave us over; trim before loading anything new.
+    make_room(0);
+
+    for (int i = 0; i < streams.count; i++) {
+        if (num_loads_in_flight >= MAX_TEXTURE_STREAM_LOADS_IN_FLIGHT) break;
+
+        Texture_Stream *stream = streams[i];
+        if (stream->is_loading) continue;
+        if (stream->last_used_frame != current_frame) continue;
+        if (stream->resident_level <= stream->wanted_level) continue;
+
+        // If the wanted level doesn't fit even after evicting, settle for the
+        // finest one that does.
+        for (int level = stream->wanted_level; level < stream->resident_level; level++) {
+            if (!can_be_top_level(stream, level)) continue;
+
+            s64 bytes_needed = get_size_of_levels(stream, level) - stream->resident_bytes;
+            if (make_room(bytes_needed)) {
+                start_load(stream, level, bytes_needed);
+                break;
+            }
+        }
+    }
+
+    current_frame++;
+}
+
+void set_texture_streaming_budget(s64 bytes) {
+    streaming_budget = bytes;
+}
+
+Texture_Streaming_Stats get_texture_streaming_stats() {
+    Texture_Streaming_Stats result = stats;
+    result.budget = streaming_budget;
+    result.resident_bytes = resident_bytes;
+    result.pending_bytes = pending_bytes;
+    result.num_streams = streams.count;
+    result.num_loads_in_flight = num_loads_in_flight;
+    return result;
+}
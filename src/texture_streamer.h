@@ -0,0 +1,82 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "general.h"
+#include "cooked_texture.h"
+
+struct Texture_Map;
+
+// Cooked textures don't stay fully resident. The catalog uploads only the
+// small mip tail, and after that the streamer keeps whatever levels the draws
+// of the last frame asked for (see note_texture_use), as far as the budget
+// allows. Finer levels are read from the cooked file on the job workers. When
+// the budget is tight, levels that aren't needed are dropped from the least
+// recently used textures first. Uncooked textures are always fully resident
+// and don't count against the budget.
+
+const s64 DEFAULT_TEXTURE_STREAMING_BUDGET = 256 * 1024 * 1024;
+
+// Levels this size and smaller are loaded with the texture and never evicted.
+const int TEXTURE_STREAMING_TAIL_SIZE = 64;
+
+const int MAX_TEXTURE_STREAM_LOADS_IN_FLIGHT = 4;
+
+struct Texture_Stream {
+    Texture_Map *map;
+    char *cooked_path;
+
+    Texture_Format format;
+    bool srgb;
+    int num_levels;
+    Cooked_Texture_Level levels[MAX_COOKED_TEXTURE_LEVELS];
+
+    int resident_level = 0;  // Finest level on the GPU.
+    int tail_level = 0;      // This level and coarser are always resident.
+    int requested_level = 0; // Finest level asked for since the last update.
+    int wanted_level = 0;    // requested_level as of the last update.
+
+    u64 last_used_frame = 0;
+    s64 resident_bytes = 0;
+    bool is_loading = false;
+};
+
+struct Texture_Streaming_Stats {
+    s64 budget;
+    s64 resident_bytes;
+    s64 pending_bytes; // Reserved by loads still in flight.
+
+    int num_streams;
+    int num_loads_in_flight;
+
+    // Textures drawn last frame with less detail than they asked for,
+    // whether they're still loading or didn't fit in the budget.
+    int misses_last_frame;
+    int loads_last_frame;
+    int evictions_last_frame;
+
+    s64 total_misses;
+    s64 total_loads;
+    s64 total_evictions;
+};
+
+// Used by the catalog to bring in a cooked texture's tail. The first two are
+// safe on a worker; the rest are main thread only.
+Texture_Stream *create_texture_stream(Texture_Map *map, char *cooked_path, Cooked_Texture *cooked);
+u8 *read_texture_stream_levels(Texture_Stream *stream, int first_level);
+void upload_texture_stream_levels(Texture_Stream *stream, int first_level, u8 *data);
+void register_texture_stream(Texture_Stream *stream);
+void destroy_texture_stream(Texture_Stream *stream);
+
+// Called by the renderer for every streamed texture a draw uses.
+// 'projected_pixels' is roughly how many pixels across one repeat of the
+// texture covers on screen.
+void note_texture_use(Texture_Map *map, f32 projected_pixels);
+
+// Once per frame: applies finished loads, then starts new loads and evicts
+// against the budget based on the previous frame's draws.
+void update_texture_streaming();
+
+void set_texture_streaming_budget(s64 bytes);
+Texture_Streaming_Stats get_texture_streaming_stats();
+
+#endif
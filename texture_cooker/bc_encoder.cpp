@@ -0,0 +1,450 @@
+#include "bc_encoder.h"
+
+#include <emmintrin.h>
+#include <float.h>
+#include <math.h>
+
+// The expensive part of every encoder is matching 16 pixels against a palette,
+// so blocks are kept structure-of-arrays and the palette search runs on four
+// pixels per SSE register. Endpoint fitting is small and stays scalar.
+
+struct Block_SoA {
+    __m128 channels[4][4]; // [channel][group of four pixels]
+};
+
+static void load_block(const u8 *rgba, float pixels[16][4], Block_SoA *block) {
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            pixels[i][c] = (float)rgba[i * 4 + c];
+        }
+    }
+
+    for (int c = 0; c < 4; c++) {
+        for (int group = 0; group < 4; group++) {
+            int first = group * 4;
+            block->channels[c][group] = _mm_setr_ps(pixels[first + 0][c], pixels[first + 1][c], pixels[first + 2][c], pixels[first + 3][c]);
+        }
+    }
+}
+
+// Writes the nearest palette entry for each pixel and returns the total
+// squared error. Only the first num_channels channels are compared.
+static float find_nearest_indices(Block_SoA *block, const float palette[][4], int num_entries, int num_channels, int *indices) {
+    __m128 total_error = _mm_setzero_ps();
+
+    for (int group = 0; group < 4; group++) {
+        __m128 best_error = _mm_set1_ps(FLT_MAX);
+        __m128i best_index = _mm_setzero_si128();
+
+        for (int entry = 0; entry < num_entries; entry++) {
+            __m128 error = _mm_setzero_ps();
+            for (int c = 0; c < num_channels; c++) {
+                __m128 d = _mm_sub_ps(block->channels[c][group], _mm_set1_ps(palette[entry][c]));
+                error = _mm_add_ps(error, _mm_mul_ps(d, d));
+            }
+
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best_error));
+            best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(entry)), _mm_andnot_si128(closer, best_index));
+            best_error = _mm_min_ps(error, best_error);
+        }
+
+        _mm_storeu_si128((__m128i *)(indices + group * 4), best_index);
+        total_error = _mm_add_ps(total_error, best_error);
+    }
+
+    float errors[4];
+    _mm_storeu_ps(errors, total_error);
+    return errors[0] + errors[1] + errors[2] + errors[3];
+}
+
+static void compute_principal_axis(float pixels[16][4], int num_channels, float mean[4], float axis[4]) {
+    for (int c = 0; c < 4; c++) {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+    }
+
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < num_channels; c++) mean[c] += pixels[i][c];
+    }
+    for (int c = 0; c < num_channels; c++) mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < num_channels; a++) {
+            for (int b = 0; b < num_channels; b++) {
+                covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // Power iteration. Starting on the luminance-ish diagonal converges
+    // quickly for the usual albedo block.
+    for (int c = 0; c < num_channels; c++) axis[c] = 1.0f;
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        for (int a = 0; a < num_channels; a++) {
+            for (int b = 0; b < num_channels; b++) next[a] += covariance[a][b] * axis[b];
+        }
+
+        float length_squared = 0.0f;
+        for (int c = 0; c < num_channels; c++) length_squared += next[c] * next[c];
+        if (length_squared < 1e-12f) break; // Flat block, any axis will do.
+
+        float inverse_length = 1.0f / sqrtf(length_squared);
+        for (int c = 0; c < num_channels; c++) axis[c] = next[c] * inverse_length;
+    }
+}
+
+// Endpoints spanning the pixels' extent along the principal axis.
+static void fit_endpoints_to_axis(float pixels[16][4], int num_channels, float e0[4], float e1[4]) {
+    float mean[4], axis[4];
+    compute_principal_axis(pixels, num_channels, mean, axis);
+
+    float min_t = FLT_MAX;
+    float max_t = -FLT_MAX;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < num_channels; c++) t += (pixels[i][c] - mean[c]) * axis[c];
+
+        if (t < min_t) min_t = t;
+        if (t > max_t) max_t = t;
+    }
+
+    for (int c = 0; c < 4; c++) {
+        e0[c] = mean[c] + axis[c] * max_t;
+        e1[c] = mean[c] + axis[c] * min_t;
+    }
+}
+
+// Least-squares endpoints for fixed per-pixel weights, where pixel i is
+// modelled as (1 - t[i]) * e0 + t[i] * e1. Returns false if the weights
+// don't constrain both endpoints.
+static bool solve_endpoints_for_weights(float pixels[16][4], int num_channels, const float *t, float e0[4], float e1[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+
+    for (int i = 0; i < 16; i++) {
+        float alpha = 1.0f - t[i];
+        float beta = t[i];
+
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+
+        for (int c = 0; c < num_channels; c++) {
+            ax[c] += alpha * pixels[i][c];
+            bx[c] += beta * pixels[i][c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) return false;
+
+    float inverse = 1.0f / determinant;
+    for (int c = 0; c < num_channels; c++) {
+        e0[c] = (bb * ax[c] - ab * bx[c]) * inverse;
+        e1[c] = (aa * bx[c] - ab * ax[c]) * inverse;
+    }
+
+    return true;
+}
+
+static float clamp_to_byte(float value) {
+    if (value < 0.0f) return 0.0f;
+    if (value > 255.0f) return 255.0f;
+    return value;
+}
+
+//
+// BC1
+//
+
+static u16 pack_565(const float color[4]) {
+    int r = (int)(clamp_to_byte(color[0]) * (31.0f / 255.0f) + 0.5f);
+    int g = (int)(clamp_to_byte(color[1]) * (63.0f / 255.0f) + 0.5f);
+    int b = (int)(clamp_to_byte(color[2]) * (31.0f / 255.0f) + 0.5f);
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(u16 packed, float color[4]) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+
+    color[0] = (float)((r << 3) | (r >> 2));
+    color[1] = (float)((g << 2) | (g >> 4));
+    color[2] = (float)((b << 3) | (b >> 2));
+    color[3] = 255.0f;
+}
+
+// Position of each BC1 index along c0 -> c1 in four-color mode.
+static const float BC1_INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static float evaluate_bc1_endpoints(Block_SoA *block, u16 c0, u16 c1, int *indices) {
+    float palette[4][4];
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    return find_nearest_indices(block, palette, 4, 3, indices);
+}
+
+void encode_bc1_block(const u8 *rgba, u8 *out) {
+    float pixels[16][4];
+    Block_SoA block;
+    load_block(rgba, pixels, &block);
+
+    float e0[4], e1[4];
+    fit_endpoints_to_axis(pixels, 3, e0, e1);
+
+    // Pull the extremes in a little; the palette can't hit them exactly anyway
+    // and the interior pixels matter more.
+    for (int c = 0; c < 3; c++) {
+        float inset = (e0[c] - e1[c]) / 16.0f;
+        e0[c] -= inset;
+        e1[c] += inset;
+    }
+
+    u16 best_c0 = pack_565(e0);
+    u16 best_c1 = pack_565(e1);
+    int best_indices[16];
+    float best_error = evaluate_bc1_endpoints(&block, best_c0, best_c1, best_indices);
+
+    for (int iteration = 0; iteration < 2; iteration++) {
+        float t[16];
+        for (int i = 0; i < 16; i++) t[i] = BC1_INDEX_WEIGHTS[best_indices[i]];
+        if (!solve_endpoints_for_weights(pixels, 3, t, e0, e1)) break;
+
+        u16 c0 = pack_565(e0);
+        u16 c1 = pack_565(e1);
+        if (c0 == best_c0 && c1 == best_c1) break;
+
+        int indices[16];
+        float error = evaluate_bc1_endpoints(&block, c0, c1, indices);
+        if (error >= best_error) break;
+
+        best_error = error;
+        best_c0 = c0;
+        best_c1 = c1;
+        for (int i = 0; i < 16; i++) best_indices[i] = indices[i];
+    }
+
+    // Four-color mode needs c0 > c1. Swapping the endpoints flips every
+    // weight, which swaps indices 0 <-> 1 and 2 <-> 3.
+    if (best_c0 < best_c1) {
+        u16 swap = best_c0;
+        best_c0 = best_c1;
+        best_c1 = swap;
+        for (int i = 0; i < 16; i++) best_indices[i] ^= 1;
+    } else if (best_c0 == best_c1) {
+        for (int i = 0; i < 16; i++) best_indices[i] = 0;
+    }
+
+    u32 index_bits = 0;
+    for (int i = 0; i < 16; i++) index_bits |= (u32)best_indices[i] << (i * 2);
+
+    out[0] = (u8)(best_c0 & 0xff);
+    out[1] = (u8)(best_c0 >> 8);
+    out[2] = (u8)(best_c1 & 0xff);
+    out[3] = (u8)(best_c1 >> 8);
+    out[4] = (u8)(index_bits);
+    out[5] = (u8)(index_bits >> 8);
+    out[6] = (u8)(index_bits >> 16);
+    out[7] = (u8)(index_bits >> 24);
+}
+
+//
+// BC4, the building block of BC3 alpha and BC5
+//
+
+static void encode_bc4_channel(const u8 *rgba, int channel, u8 *out) {
+    int values[16];
+    int min_value = 255;
+    int max_value = 0;
+    for (int i = 0; i < 16; i++) {
+        values[i] = rgba[i * 4 + channel];
+        if (values[i] < min_value) min_value = values[i];
+        if (values[i] > max_value) max_value = values[i];
+    }
+
+    out[0] = (u8)max_value;
+    out[1] = (u8)min_value;
+
+    u64 index_bits = 0;
+    if (max_value != min_value) {
+        // a0 > a1 selects the eight-value mode: indices 0 and 1 are the
+        // endpoints, 2..7 step from a0 towards a1 in sevenths.
+        float palette[8];
+        palette[0] = (float)max_value;
+        palette[1] = (float)min_value;
+        for (int k = 1; k <= 6; k++) {
+            palette[k + 1] = ((7 - k) * max_value + k * min_value) / 7.0f;
+        }
+
+        for (int i = 0; i < 16; i++) {
+            int best_index = 0;
+            float best_error = FLT_MAX;
+            for (int k = 0; k < 8; k++) {
+                float d = values[i] - palette[k];
+                if (d * d < best_error) {
+                    best_error = d * d;
+                    best_index = k;
+                }
+            }
+
+            index_bits |= (u64)best_index << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (u8)(index_bits >> (i * 8));
+    }
+}
+
+void encode_bc3_block(const u8 *rgba, u8 *out) {
+    encode_bc4_channel(rgba, 3, out);
+    encode_bc1_block(rgba, out + 8);
+}
+
+void encode_bc5_block(const u8 *rgba, u8 *out) {
+    encode_bc4_channel(rgba, 0, out);
+    encode_bc4_channel(rgba, 1, out + 8);
+}
+
+//
+// BC7 mode 6
+//
+
+static const int BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7_Endpoint {
+    int quantized[4]; // 7 bits per channel.
+    int p_bit;
+};
+
+static void reconstruct_bc7_endpoint(Bc7_Endpoint *endpoint, int color[4]) {
+    for (int c = 0; c < 4; c++) color[c] = (endpoint->quantized[c] << 1) | endpoint->p_bit;
+}
+
+// Mode 6 endpoints are 7 bits per channel plus one p-bit shared by the four
+// channels, so try both p-bits and keep whichever lands closer.
+static Bc7_Endpoint quantize_bc7_endpoint(const float color[4]) {
+    Bc7_Endpoint best = {};
+    float best_error = FLT_MAX;
+
+    for (int p_bit = 0; p_bit < 2; p_bit++) {
+        Bc7_Endpoint candidate;
+        candidate.p_bit = p_bit;
+
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            int q = (int)((clamp_to_byte(color[c]) - p_bit) * 0.5f + 0.5f);
+            if (q < 0) q = 0;
+            if (q > 127) q = 127;
+            candidate.quantized[c] = q;
+
+            float d = (float)((q << 1) | p_bit) - color[c];
+            error += d * d;
+        }
+
+        if (error < best_error) {
+            best_error = error;
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+static float evaluate_bc7_endpoints(Block_SoA *block, Bc7_Endpoint *e0, Bc7_Endpoint *e1, int *indices) {
+    int color0[4], color1[4];
+    reconstruct_bc7_endpoint(e0, color0);
+    reconstruct_bc7_endpoint(e1, color1);
+
+    float palette[16][4];
+    for (int k = 0; k < 16; k++) {
+        int w = BC7_WEIGHTS_4[k];
+        for (int c = 0; c < 4; c++) {
+            palette[k][c] = (float)(((64 - w) * color0[c] + w * color1[c] + 32) >> 6);
+        }
+    }
+
+    return find_nearest_indices(block, palette, 16, 4, indices);
+}
+
+struct Bit_Writer {
+    u8 *out;
+    int bit;
+};
+
+static void write_bits(Bit_Writer *writer, u32 value, int count) {
+    for (int i = 0; i < count; i++) {
+        if ((value >> i) & 1) writer->out[writer->bit >> 3] |= (u8)(1 << (writer->bit & 7));
+        writer->bit++;
+    }
+}
+
+void encode_bc7_block(const u8 *rgba, u8 *out) {
+    float pixels[16][4];
+    Block_SoA block;
+    load_block(rgba, pixels, &block);
+
+    float e0[4], e1[4];
+    fit_endpoints_to_axis(pixels, 4, e0, e1);
+
+    Bc7_Endpoint best_e0 = quantize_bc7_endpoint(e0);
+    Bc7_Endpoint best_e1 = quantize_bc7_endpoint(e1);
+    int best_indices[16];
+    float best_error = evaluate_bc7_endpoints(&block, &best_e0, &best_e1, best_indices);
+
+    for (int iteration = 0; iteration < 2 && best_error > 0.0f; iteration++) {
+        float t[16];
+        for (int i = 0; i < 16; i++) t[i] = BC7_WEIGHTS_4[best_indices[i]] / 64.0f;
+        if (!solve_endpoints_for_weights(pixels, 4, t, e0, e1)) break;
+
+        Bc7_Endpoint q0 = quantize_bc7_endpoint(e0);
+        Bc7_Endpoint q1 = quantize_bc7_endpoint(e1);
+
+        int indices[16];
+        float error = evaluate_bc7_endpoints(&block, &q0, &q1, indices);
+        if (error >= best_error) break;
+
+        best_error = error;
+        best_e0 = q0;
+        best_e1 = q1;
+        for (int i = 0; i < 16; i++) best_indices[i] = indices[i];
+    }
+
+    // The first index is stored with its top bit implied zero. If it's set,
+    // swap the endpoints and mirror every index instead.
+    if (best_indices[0] & 8) {
+        Bc7_Endpoint swap = best_e0;
+        best_e0 = best_e1;
+        best_e1 = swap;
+        for (int i = 0; i < 16; i++) best_indices[i] = 15 - best_indices[i];
+    }
+
+    for (int i = 0; i < 16; i++) out[i] = 0;
+
+    Bit_Writer writer = { out, 0 };
+    write_bits(&writer, 1 << 6, 7); // Mode 6.
+
+    for (int c = 0; c < 4; c++) {
+        write_bits(&writer, best_e0.quantized[c], 7);
+        write_bits(&writer, best_e1.quantized[c], 7);
+    }
+
+    write_bits(&writer, best_e0.p_bit, 1);
+    write_bits(&writer, best_e1.p_bit, 1);
+
+    write_bits(&writer, best_indices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        write_bits(&writer, best_indices[i], 4);
+    }
+
+    assert(writer.bit == 128);
+}
@@ -0,0 +1,21 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include "../src/general.h"
+
+// Single-block encoders. Every block is 16 RGBA8 pixels in row order; the
+// single and two channel formats read from the channels noted below.
+
+// Opaque color, 8 bytes out. Alpha is ignored.
+void encode_bc1_block(const u8 *rgba, u8 *out);
+
+// Color plus interpolated alpha, 16 bytes out.
+void encode_bc3_block(const u8 *rgba, u8 *out);
+
+// Red and green as two independent channels, 16 bytes out.
+void encode_bc5_block(const u8 *rgba, u8 *out);
+
+// Mode 6 only: one subset, RGBA endpoints with 16 weights, 16 bytes out.
+void encode_bc7_block(const u8 *rgba, u8 *out);
+
+#endif
@@ -0,0 +1,416 @@
+// Cooks data/textures into block-compressed .tex files (see src/cooked_texture.h).
+//
+//     texture_cooker [-force] [-bc3] [-threads N] [source_dir] [output_dir]
+//
+// Run from run_tree; the defaults are data/textures and data/cooked. The game
+// picks cooked textures up through the asset registry and falls back to the
+// source images for anything that isn't cooked.
+//
+// Format choice:
+//   - names ending in _normal or _n become BC5
+//   - anything with non-opaque alpha becomes BC7, or BC3 with -bc3
+//   - everything else becomes BC1
+// Blend maps and height maps are data, not colour, and are skipped: the game
+// reads them as exact bytes (chunk classification, heights), which neither
+// sRGB nor block compression would keep.
+// D3D11 wants the top level of a BC texture to be a multiple of 4, so other
+// sizes are kept as RGBA8 (still with mips).
+//
+// This tool only needs the C++ standard library and stb_image, so it builds on
+// Linux too:
+//     g++ -O2 -std=c++14 -pthread -I../external/include main.cpp bc_encoder.cpp ../src/mipmap.cpp -o texture_cooker
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "../src/general.h"
+#include "../src/array.h"
+#include "../src/cooked_texture.h"
+#include "../src/mipmap.h"
+
+#include "bc_encoder.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#endif
+
+// general.h wants these from the game; the cooker has no frames to count.
+Arena frame_arena;
+void count_heap_allocation() {}
+
+struct Cook_Options {
+    bool force = false;
+    bool prefer_bc3 = false;
+    int num_threads = 0;
+};
+
+//
+// Files
+//
+
+static u64 get_modification_time(char *file_path) {
+    struct stat info;
+    if (stat(file_path, &info) != 0) return 0;
+    return (u64)info.st_mtime;
+}
+
+static void make_directory(char *path) {
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+// Creates every directory leading up to the file.
+static void make_directories_for_file(char *file_path) {
+    char *path = copy_string(file_path);
+    defer { delete [] path; };
+
+    for (char *at = path; *at; at++) {
+        if (*at != '/') continue;
+
+        *at = 0;
+        make_directory(path);
+        *at = '/';
+    }
+}
+
+// Relative paths (from the source directory) of every file under 'directory'.
+static void list_files(char *root, char *relative_directory, Array <char *> *files) {
+    char *directory = relative_directory ? mprintf("%s/%s", root, relative_directory) : copy_string(root);
+    defer { delete [] directory; };
+
+#ifdef _WIN32
+    char *pattern = mprintf("%s/*", directory);
+    defer { delete [] pattern; };
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE handle = FindFirstFileA(pattern, &find_data);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    defer { FindClose(handle); };
+
+    do {
+        char *name = find_data.cFileName;
+        bool is_directory = (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    DIR *dir = opendir(directory);
+    if (!dir) return;
+    defer { closedir(dir); };
+
+    while (dirent *entry = readdir(dir)) {
+        char *name = entry->d_name;
+
+        char *full_path = mprintf("%s/%s", directory, name);
+        struct stat info;
+        bool is_directory = stat(full_path, &info) == 0 && S_ISDIR(info.st_mode);
+        delete [] full_path;
+#endif
+
+        if (strings_match(name, ".") || strings_match(name, "..")) continue;
+
+        char *relative_path = relative_directory ? mprintf("%s/%s", relative_directory, name) : copy_string(name);
+        if (is_directory) {
+            list_files(root, relative_path, files);
+            delete [] relative_path;
+        } else {
+            files->add(relative_path);
+        }
+#ifdef _WIN32
+    } while (FindNextFileA(handle, &find_data));
+#else
+    }
+#endif
+}
+
+static bool is_source_image(char *file_path) {
+    char *dot = find_character_from_right(file_path, '.');
+    if (!dot) return false;
+
+    return strings_match(dot, ".png") || strings_match(dot, ".jpg") || strings_match(dot, ".bmp");
+}
+
+static bool is_normal_map(char *stem) {
+    char *underscore = find_character_from_right(stem, '_');
+    if (!underscore) return false;
+
+    return strings_match(underscore, "_normal") || strings_match(underscore, "_n");
+}
+
+// Anything with blendmap or heightmap in its name, in any case.
+static bool is_data_texture(char *stem) {
+    char *name = find_character_from_right(stem, '/');
+    name = name ? name + 1 : stem;
+
+    char lower[256];
+    int length = 0;
+    for (; name[length] && length < ArrayCount(lower) - 1; length++) {
+        lower[length] = (char)tolower((unsigned char)name[length]);
+    }
+    lower[length] = 0;
+
+    return strstr(lower, "blendmap") || strstr(lower, "heightmap");
+}
+
+//
+// Encoding
+//
+
+typedef void (*Encode_Block_Proc)(const u8 *rgba, u8 *out);
+
+static Encode_Block_Proc get_block_encoder(Texture_Format format) {
+    switch (format) {
+        case TEXTURE_FORMAT_BC1: return encode_bc1_block;
+        case TEXTURE_FORMAT_BC3: return encode_bc3_block;
+        case TEXTURE_FORMAT_BC5: return encode_bc5_block;
+        case TEXTURE_FORMAT_BC7: return encode_bc7_block;
+        default: return nullptr;
+    }
+}
+
+// Encodes one level into 'out', spreading rows of blocks across threads.
+static void encode_level(Bitmap *level, Texture_Format format, u8 *out, int num_threads) {
+    Encode_Block_Proc encode_block = get_block_encoder(format);
+    if (!encode_block) {
+        memcpy(out, level->data, (size_t)level->width * level->height * 4);
+        return;
+    }
+
+    int blocks_x = (level->width + 3) / 4;
+    int blocks_y = (level->height + 3) / 4;
+    int block_size = get_texture_format_unit_size(format);
+    std::atomic <int> next_row(0);
+
+    auto worker = [&]() {
+        u8 block[16 * 4];
+
+        while (true) {
+            int by = next_row.fetch_add(1);
+            if (by >= blocks_y) break;
+
+            for (int bx = 0; bx < blocks_x; bx++) {
+                // Blocks hanging off the edge repeat the last row/column.
+                for (int py = 0; py < 4; py++) {
+                    int y = Min(by * 4 + py, level->height - 1);
+                    for (int px = 0; px < 4; px++) {
+                        int x = Min(bx * 4 + px, level->width - 1);
+                        memcpy(&block[(py * 4 + px) * 4], &level->data[(y * level->width + x) * 4], 4);
+                    }
+                }
+
+                encode_block(block, out + ((s64)by * blocks_x + bx) * block_size);
+            }
+        }
+    };
+
+    int threads_to_use = Min(num_threads, blocks_y);
+    if (threads_to_use <= 1) {
+        worker();
+        return;
+    }
+
+    Array <std::thread *> threads;
+    for (int i = 0; i < threads_to_use - 1; i++) threads.add(new std::thread(worker));
+    worker();
+    for (int i = 0; i < threads.count; i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+}
+
+static char *get_format_name(Texture_Format format) {
+    switch (format) {
+        case TEXTURE_FORMAT_RGBA8: return "RGBA8";
+        case TEXTURE_FORMAT_RGB8:  return "RGB8";
+        case TEXTURE_FORMAT_BC1:   return "BC1";
+        case TEXTURE_FORMAT_BC3:   return "BC3";
+        case TEXTURE_FORMAT_BC5:   return "BC5";
+        case TEXTURE_FORMAT_BC7:   return "BC7";
+    }
+
+    return "?";
+}
+
+static bool cook_texture(char *source_path, char *output_path, char *stem, Cook_Options *options) {
+    auto start = std::chrono::steady_clock::now();
+
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    u8 *pixels = stbi_load(source_path, &width, &height, &channels, 4);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load '%s': %s\n", source_path, stbi_failure_reason());
+        return false;
+    }
+    defer { stbi_image_free(pixels); };
+
+    bool has_alpha = false;
+    for (int i = 0; i < width * height; i++) {
+        if (pixels[i * 4 + 3] != 255) {
+            has_alpha = true;
+            break;
+        }
+    }
+
+    Texture_Format format = TEXTURE_FORMAT_BC1;
+    u32 flags = COOKED_TEXTURE_SRGB;
+    if (is_normal_map(stem)) {
+        format = TEXTURE_FORMAT_BC5;
+        flags = 0;
+    } else if (has_alpha) {
+        format = options->prefer_bc3 ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC7;
+        flags |= COOKED_TEXTURE_HAS_ALPHA;
+    }
+
+    if ((width % 4) || (height % 4)) {
+        format = TEXTURE_FORMAT_RGBA8;
+    }
+
+    Bitmap base = {};
+    base.width = width;
+    base.height = height;
+    base.format = TEXTURE_FORMAT_RGBA8;
+    base.channels = 4;
+    base.data = pixels;
+
+    // Same filtering as create_texture, so cooked and uncooked textures match.
+    Mip_Options mip_options;
+    mip_options.srgb = (flags & COOKED_TEXTURE_SRGB) != 0;
+    if (has_alpha) mip_options.alpha_coverage_cutoff = 0.5f;
+
+    Mip_Chain chain;
+    build_mip_chain(base, &chain, mip_options);
+    defer { free_mip_chain(&chain); };
+
+    Bitmap *levels = chain.levels;
+    int num_levels = Min(chain.num_levels, MAX_COOKED_TEXTURE_LEVELS);
+
+    Cooked_Texture_Header header = {};
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.format = format;
+    header.flags = flags;
+    header.width = width;
+    header.height = height;
+    header.num_levels = num_levels;
+
+    Cooked_Texture_Level level_table[MAX_COOKED_TEXTURE_LEVELS] = {};
+    u64 offset = sizeof(Cooked_Texture_Header) + num_levels * sizeof(Cooked_Texture_Level);
+    for (int i = 0; i < num_levels; i++) {
+        level_table[i].width = levels[i].width;
+        level_table[i].height = levels[i].height;
+        level_table[i].offset = offset;
+        level_table[i].size = get_texture_level_size(format, levels[i].width, levels[i].height);
+        offset += level_table[i].size;
+    }
+
+    u64 total_size = offset;
+    u8 *file_data = new u8[total_size];
+    defer { delete [] file_data; };
+
+    memcpy(file_data, &header, sizeof(header));
+    memcpy(file_data + sizeof(header), level_table, num_levels * sizeof(Cooked_Texture_Level));
+    for (int i = 0; i < num_levels; i++) {
+        encode_level(&levels[i], format, file_data + level_table[i].offset, options->num_threads);
+    }
+
+    make_directories_for_file(output_path);
+    FILE *file = fopen(output_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Unable to open '%s' for writing\n", output_path);
+        return false;
+    }
+    fwrite(file_data, 1, total_size, file);
+    fclose(file);
+
+    double seconds = std::chrono::duration <double>(std::chrono::steady_clock::now() - start).count();
+    s64 uncompressed_size = (s64)width * height * 4 * 4 / 3;
+    printf("%-32s %4dx%-4d %-5s %8lld -> %8lld bytes (%.1fx) in %.2fs\n",
+           stem, width, height, get_format_name(format),
+           (long long)uncompressed_size, (long long)total_size, (double)uncompressed_size / total_size, seconds);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Cook_Options options;
+    char *source_directory = "data/textures";
+    char *output_directory = "data/cooked";
+
+    int num_positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strings_match(argv[i], "-force")) {
+            options.force = true;
+        } else if (strings_match(argv[i], "-bc3")) {
+            options.prefer_bc3 = true;
+        } else if (strings_match(argv[i], "-threads") && i + 1 < argc) {
+            options.num_threads = atoi(argv[++i]);
+        } else if (num_positional == 0) {
+            source_directory = argv[i];
+            num_positional++;
+        } else if (num_positional == 1) {
+            output_directory = argv[i];
+            num_positional++;
+        } else {
+            fprintf(stderr, "Unexpected argument '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (options.num_threads <= 0) {
+        options.num_threads = Max((int)std::thread::hardware_concurrency(), 1);
+    }
+
+    Array <char *> files;
+    list_files(source_directory, nullptr, &files);
+
+    int num_cooked = 0;
+    int num_skipped = 0;
+    int num_data = 0;
+    int num_failed = 0;
+    for (int i = 0; i < files.count; i++) {
+        char *relative_path = files[i];
+        defer { delete [] relative_path; };
+
+        if (!is_source_image(relative_path)) continue;
+
+        char *stem = copy_string(relative_path);
+        defer { delete [] stem; };
+        *find_character_from_right(stem, '.') = 0;
+
+        if (is_data_texture(stem)) {
+            num_data++;
+            continue;
+        }
+
+        char *source_path = mprintf("%s/%s", source_directory, relative_path);
+        defer { delete [] source_path; };
+        char *output_path = mprintf("%s/%s.tex", output_directory, stem);
+        defer { delete [] output_path; };
+
+        if (!options.force && get_modification_time(output_path) >= get_modification_time(source_path)) {
+            num_skipped++;
+            continue;
+        }
+
+        if (cook_texture(source_path, output_path, stem, &options)) {
+            num_cooked++;
+        } else {
+            num_failed++;
+        }
+    }
+
+    printf("Cooked %d textures, %d up to date, %d data textures left alone, %d failed.\n", num_cooked, num_skipped, num_data, num_failed);
+    return num_failed ? 1 : 0;
+}